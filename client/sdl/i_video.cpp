@@ -47,6 +47,7 @@
 
 #include "w_wad.h"
 #include "cmdlib.h"
+#include "cl_benchmark.h"
 
 // [Russell] - Just for windows, display the icon in the system menu and
 // alt-tab display
@@ -1089,6 +1090,33 @@ void I_FreeSurface(IWindowSurface* &surface)
 }
 
 
+//
+// IDummyWindow::setMode
+//
+// The headless window normally keeps its hardcoded 320x200x8 surface since
+// nothing is drawn to it. A benchmark does draw, so it gets the mode it asks
+// for.
+//
+bool IDummyWindow::setMode(const IVideoMode& video_mode)
+{
+	if (mPrimarySurface != NULL)
+	{
+		if (!CL_BenchmarkActive() || (video_mode.width == mVideoMode.width &&
+			video_mode.height == mVideoMode.height && video_mode.bpp == mVideoMode.bpp))
+			return true;
+
+		mVideoMode = IVideoMode(video_mode.width, video_mode.height, video_mode.bpp,
+		                        WINDOW_Windowed);
+		I_FreeSurface(mPrimarySurface);
+	}
+
+	// not I_AllocateSurface: primary_surface may still point at the old surface
+	mPixelFormat = mVideoMode.bpp == 8 ? *I_Get8bppPixelFormat() : *I_Get32bppPixelFormat();
+	mPrimarySurface = new IWindowSurface(mVideoMode.width, mVideoMode.height, &mPixelFormat);
+	return mPrimarySurface != NULL;
+}
+
+
 //
 // I_GetSurfaceWidth
 //
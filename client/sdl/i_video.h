@@ -570,15 +570,7 @@ public:
 	virtual const PixelFormat* getPixelFormat() const
 	{	return &mPixelFormat;	}
 
-	virtual bool setMode(const IVideoMode& video_mode)
-	{
-		if (mPrimarySurface == NULL)
-		{
-			// ignore the requested mode and setup the hardcoded mode
-			mPrimarySurface = I_AllocateSurface(mVideoMode.width, mVideoMode.height, mVideoMode.bpp);
-		}
-		return mPrimarySurface != NULL;
-	}
+	virtual bool setMode(const IVideoMode& video_mode);
 
 	virtual bool isFullScreen() const
 	{	return mVideoMode.isFullScreen();	}
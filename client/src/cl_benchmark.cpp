@@ -0,0 +1,371 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Rendering benchmark.
+//
+//	novadoom -benchmark DEMO [-benchres WxH,...] [-benchopt none,sse2,...]
+//	         [-benchjson FILE]
+//
+//	Plays DEMO once for every combination of resolution and r_optimize
+//	setting as fast as possible, timing each frame and the main stages of
+//	the renderer. Combined with -novideo the frames are drawn to an
+//	offscreen surface, so no window or GPU is needed. When every run is
+//	done, per-frame percentiles are printed and optionally written out as
+//	JSON, then the client quits.
+//
+//-----------------------------------------------------------------------------
+
+
+#include "novadoom.h"
+
+#include <algorithm>
+#include <json/json.h>
+
+#include "cl_benchmark.h"
+#include "cmdlib.h"
+#include "c_cvars.h"
+#include "doomstat.h"
+#include "g_game.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_fileio.h"
+#include "r_defs.h"
+#include "v_video.h"
+
+EXTERN_CVAR(vid_defwidth)
+EXTERN_CVAR(vid_defheight)
+EXTERN_CVAR(vid_32bpp)
+EXTERN_CVAR(r_optimize)
+
+static const char* stagenames[NUM_BENCHSTAGES] = {
+	"bsp", "planes", "sprites", "masked", "blit"
+};
+
+struct benchframe_t
+{
+	dtime_t total;
+	dtime_t stages[NUM_BENCHSTAGES];
+};
+
+struct benchrun_t
+{
+	int width;
+	int height;
+	std::string optimize;		// as requested
+	std::string effective;		// what r_optimize settled on
+	std::vector<benchframe_t> frames;
+	dtime_t elapsed;
+};
+
+static struct
+{
+	bool active;
+	std::string demoname;
+	std::string jsonfile;
+	std::vector<benchrun_t> runs;
+	size_t current;
+
+	// archived cvars changed by the runs, put back before quitting so the
+	// benchmark does not end up in the saved config
+	std::string defwidth;
+	std::string defheight;
+	std::string optimize;
+
+	dtime_t runstart;
+	dtime_t framestart;
+	dtime_t stagestart[NUM_BENCHSTAGES];
+	benchframe_t frame;
+	bool inframe;
+} bench;
+
+
+//
+// CL_BenchmarkActive
+//
+bool CL_BenchmarkActive()
+{
+	return bench.active;
+}
+
+//
+// CL_BenchmarkApplyRun
+//
+// Switches the video mode and drawers to those of the current run and
+// starts the demo.
+//
+static void CL_BenchmarkApplyRun()
+{
+	benchrun_t& run = bench.runs[bench.current];
+
+	if (run.width != vid_defwidth.asInt() || run.height != vid_defheight.asInt())
+	{
+		vid_defwidth.Set(float(run.width));
+		vid_defheight.Set(float(run.height));
+		V_ForceVideoModeAdjustment();
+	}
+
+	if (!run.optimize.empty())
+		r_optimize.Set(run.optimize.c_str());
+	run.effective = r_optimize.cstring();
+
+	PrintFmt(PRINT_HIGH, "benchmark: run {} of {}: {}x{}x{} r_optimize {}\n",
+	         bench.current + 1, bench.runs.size(), run.width, run.height,
+	         vid_32bpp ? 32 : 8, run.effective);
+
+	bench.inframe = false;
+	bench.runstart = I_GetTime();
+	G_TimeDemo(bench.demoname.c_str());
+}
+
+//
+// CL_BenchmarkStart
+//
+// Sets up the run matrix from the command line and starts the first run.
+//
+void CL_BenchmarkStart(const char* demoname)
+{
+	std::vector<std::pair<int, int> > resolutions;
+	if (const char* value = Args.CheckValue("-benchres"))
+	{
+		const StringTokens tokens = TokenizeString(value, ",");
+		for (const std::string& token : tokens)
+		{
+			int width, height;
+			if (sscanf(token.c_str(), "%dx%d", &width, &height) == 2 &&
+			    width >= 320 && width <= MAXWIDTH && height >= 200 && height <= MAXHEIGHT)
+				resolutions.push_back(std::make_pair(width, height));
+			else
+				PrintFmt(PRINT_WARNING, "benchmark: ignoring resolution \"{}\"\n", token);
+		}
+	}
+	if (resolutions.empty())
+		resolutions.push_back(std::make_pair(vid_defwidth.asInt(), vid_defheight.asInt()));
+
+	StringTokens optimizations;
+	if (const char* value = Args.CheckValue("-benchopt"))
+		optimizations = TokenizeString(value, ",");
+	if (optimizations.empty())
+		optimizations.push_back("");		// leave r_optimize alone
+
+	bench.runs.clear();
+	for (const auto& [width, height] : resolutions)
+	{
+		for (const std::string& optimize : optimizations)
+		{
+			benchrun_t run;
+			run.width = width;
+			run.height = height;
+			run.optimize = optimize;
+			run.elapsed = 0;
+			bench.runs.push_back(run);
+		}
+	}
+
+	const char* jsonfile = Args.CheckValue("-benchjson");
+	bench.jsonfile = jsonfile ? jsonfile : "";
+	bench.demoname = demoname;
+	bench.current = 0;
+	bench.active = true;
+
+	bench.defwidth = vid_defwidth.cstring();
+	bench.defheight = vid_defheight.cstring();
+	bench.optimize = r_optimize.cstring();
+
+	singledemo = true;
+	CL_BenchmarkApplyRun();
+}
+
+
+//
+// CL_BenchmarkBeginFrame
+//
+void CL_BenchmarkBeginFrame()
+{
+	if (!bench.active)
+		return;
+
+	bench.inframe = true;
+	bench.frame = benchframe_t();
+	bench.framestart = I_GetTime();
+}
+
+//
+// CL_BenchmarkEndFrame
+//
+void CL_BenchmarkEndFrame()
+{
+	if (!bench.active || !bench.inframe)
+		return;
+
+	bench.frame.total = I_GetTime() - bench.framestart;
+	bench.runs[bench.current].frames.push_back(bench.frame);
+	bench.inframe = false;
+}
+
+//
+// CL_BenchmarkClock
+//
+void CL_BenchmarkClock(benchstage_t stage)
+{
+	if (bench.inframe)
+		bench.stagestart[stage] = I_GetTime();
+}
+
+//
+// CL_BenchmarkUnclock
+//
+void CL_BenchmarkUnclock(benchstage_t stage)
+{
+	if (bench.inframe)
+		bench.frame.stages[stage] += I_GetTime() - bench.stagestart[stage];
+}
+
+
+//
+// CL_Percentile
+//
+// Nearest-rank percentile of an already sorted list, in milliseconds.
+//
+static double CL_Percentile(const std::vector<dtime_t>& sorted, int percent)
+{
+	if (sorted.empty())
+		return 0.0;
+
+	size_t rank = (sorted.size() * percent + 99) / 100;
+	rank = clamp<size_t>(rank, 1, sorted.size());
+	return sorted[rank - 1] / 1e6;
+}
+
+//
+// CL_SummarizeTimes
+//
+// Adds mean and p50/p95/p99 of the given frame times to a JSON object.
+//
+static Json::Value CL_SummarizeTimes(std::vector<dtime_t> times)
+{
+	std::sort(times.begin(), times.end());
+
+	double sum = 0.0;
+	for (dtime_t time : times)
+		sum += time;
+
+	Json::Value summary(Json::objectValue);
+	summary["mean"] = times.empty() ? 0.0 : sum / times.size() / 1e6;
+	summary["p50"] = CL_Percentile(times, 50);
+	summary["p95"] = CL_Percentile(times, 95);
+	summary["p99"] = CL_Percentile(times, 99);
+	return summary;
+}
+
+//
+// CL_BenchmarkReport
+//
+// Prints a summary of every run and writes the JSON report.
+//
+static void CL_BenchmarkReport()
+{
+	Json::Value report(Json::objectValue);
+	report["demo"] = bench.demoname;
+	report["bpp"] = vid_32bpp ? 32 : 8;
+	report["units"] = "ms";
+	report["runs"] = Json::Value(Json::arrayValue);
+
+	for (const benchrun_t& run : bench.runs)
+	{
+		std::vector<dtime_t> totals;
+		std::vector<dtime_t> stages[NUM_BENCHSTAGES];
+		for (const benchframe_t& frame : run.frames)
+		{
+			totals.push_back(frame.total);
+			for (int i = 0; i < NUM_BENCHSTAGES; i++)
+				stages[i].push_back(frame.stages[i]);
+		}
+
+		const double seconds = run.elapsed / 1e9;
+		const double fps = seconds > 0.0 ? run.frames.size() / seconds : 0.0;
+
+		Json::Value entry(Json::objectValue);
+		entry["width"] = run.width;
+		entry["height"] = run.height;
+		entry["r_optimize"] = run.effective;
+		entry["frames"] = Json::UInt64(run.frames.size());
+		entry["seconds"] = seconds;
+		entry["fps"] = fps;
+		entry["frame"] = CL_SummarizeTimes(totals);
+		for (int i = 0; i < NUM_BENCHSTAGES; i++)
+			entry["stages"][stagenames[i]] = CL_SummarizeTimes(stages[i]);
+		report["runs"].append(entry);
+
+		const Json::Value& frame = entry["frame"];
+		PrintFmt(PRINT_HIGH, "benchmark: {}x{} {}: {} frames, {:.1f} fps, "
+		         "frame p50 {:.2f}ms p95 {:.2f}ms p99 {:.2f}ms\n",
+		         run.width, run.height, run.effective, run.frames.size(), fps,
+		         frame["p50"].asDouble(), frame["p95"].asDouble(), frame["p99"].asDouble());
+
+		std::string breakdown;
+		for (int i = 0; i < NUM_BENCHSTAGES; i++)
+			breakdown += fmt::format(" {} {:.2f}ms", stagenames[i],
+			                         entry["stages"][stagenames[i]]["mean"].asDouble());
+		PrintFmt(PRINT_HIGH, "benchmark:   mean{}\n", breakdown);
+	}
+
+	if (bench.jsonfile.empty())
+		return;
+
+	const std::string json = Json::StyledWriter().write(report);
+	if (!M_WriteFile(bench.jsonfile, (void*)json.data(), json.size()))
+	{
+		PrintFmt(PRINT_WARNING, "benchmark: could not write \"{}\"\n", bench.jsonfile);
+		return;
+	}
+
+	PrintFmt(PRINT_HIGH, "benchmark: report written to \"{}\"\n", bench.jsonfile);
+}
+
+//
+// CL_BenchmarkNextRun
+//
+// Called when the demo of the current run has ended. Starts the next run
+// and returns true, or reports the results and returns false once all
+// runs are done.
+//
+bool CL_BenchmarkNextRun()
+{
+	if (!bench.active)
+		return false;
+
+	bench.runs[bench.current].elapsed = I_GetTime() - bench.runstart;
+	bench.inframe = false;
+
+	if (++bench.current < bench.runs.size())
+	{
+		CL_BenchmarkApplyRun();
+		return true;
+	}
+
+	vid_defwidth.Set(bench.defwidth.c_str());
+	vid_defheight.Set(bench.defheight.c_str());
+	r_optimize.Set(bench.optimize.c_str());
+
+	CL_BenchmarkReport();
+	bench.active = false;
+	return false;
+}
+
+VERSION_CONTROL (cl_benchmark_cpp, "$Id$")
@@ -0,0 +1,46 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Rendering benchmark: times every frame of a demo, optionally over a
+//	matrix of resolutions and r_optimize settings.
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+enum benchstage_t
+{
+	BENCH_BSP,			// R_RenderBSPNode: clipping and wall drawing
+	BENCH_PLANES,		// floors, ceilings and sky boxes
+	BENCH_SPRITES,		// things and player sprites
+	BENCH_MASKED,		// masked mid textures
+	BENCH_BLIT,			// presenting the finished frame
+
+	NUM_BENCHSTAGES
+};
+
+bool CL_BenchmarkActive();
+void CL_BenchmarkStart(const char* demoname);
+bool CL_BenchmarkNextRun();
+
+void CL_BenchmarkBeginFrame();
+void CL_BenchmarkEndFrame();
+
+void CL_BenchmarkClock(benchstage_t stage);
+void CL_BenchmarkUnclock(benchstage_t stage);
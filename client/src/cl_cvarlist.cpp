@@ -788,6 +788,12 @@ CVAR_RANGE(		r_drawplayersprites, "1", "Weapon Transparency",
 CVAR(			r_particles, "1", "Draw particles",
 				CVARTYPE_BOOL, CVAR_CLIENTARCHIVE)
 
+CVAR_RANGE(		r_threads, "1", "Number of threads drawing walls, sprites, floors and ceilings (0 - one per CPU core, 1 - draw on the main thread only)",
+				CVARTYPE_BYTE, CVAR_CLIENTARCHIVE | CVAR_NOENABLEDISABLE, 0.0f, 32.0f)
+
+CVAR(			r_columnbatch, "0", "Draw walls and sprites four columns at a time on 32-bit surfaces",
+				CVARTYPE_BOOL, CVAR_CLIENTARCHIVE)
+
 CVAR_RANGE_FUNC_DECL(r_stretchsky, "2", "Stretch sky textures. (0 - always off, 1 - always on, 2 - auto)",
 				CVARTYPE_BYTE, CVAR_CLIENTARCHIVE | CVAR_NOENABLEDISABLE, 0.0f, 2.0f)
 
@@ -868,7 +874,7 @@ CVAR_FUNC_DECL(	vid_filter, "", "Set render scale quality setting for SDL 2.0, o
 				CVARTYPE_STRING, CVAR_CLIENTARCHIVE | CVAR_NOENABLEDISABLE)
 
 // Optimize rendering functions based on CPU vectorization support
-// Can be of "detect" or "none" or "mmx","sse2","altivec" depending on availability; case-insensitive.
+// Can be of "detect" or "none" or "mmx","sse2","avx2","altivec" depending on availability; case-insensitive.
 CVAR_FUNC_DECL(	r_optimize, "detect", "Rendering optimizations",
 				CVARTYPE_STRING, CVAR_CLIENTARCHIVE | CVAR_NOENABLEDISABLE)
 
@@ -0,0 +1,549 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Demo sync testing.
+//
+//	novadoom +demotest DEMO -demotrace FILE [-recordtrace]
+//
+//	Hashes the play simulation after every tic and compares it against
+//	the trace in FILE, stopping at the first tic that differs. If FILE
+//	does not exist yet (or -recordtrace is given) the trace is written
+//	instead.
+//
+//	novadoom -demolist LIST [-jobs N] [-tracedir DIR] [-retrace]
+//
+//	Runs +demotest for every demo in LIST, N at a time in child
+//	processes, and reports the result and tics per second of each one.
+//	Traces are kept in DIR, or next to LIST, as IWAD_DEMO.trace, with a
+//	hash of the PWAD list added to the name when the demo has one.
+//	LIST has the same format as tests/DEMOLIST:
+//
+//	DOOM2.WAD {PWAD.WAD DEH.DEH ...} DEMOLUMP.LMP {15eb4720 3ccc7a1 3fc7e27 800000}
+//
+//-----------------------------------------------------------------------------
+
+
+#include "novadoom.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "cl_demotest.h"
+#include "cmdlib.h"
+#include "doomstat.h"
+#include "d_player.h"
+#include "g_game.h"
+#include "g_level.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_fileio.h"
+#include "m_misc.h"
+
+namespace fs = std::filesystem;
+
+extern unsigned char prndindex;
+
+
+// ============================================================================
+//
+// Per-tic trace, in the +demotest process
+//
+// ============================================================================
+
+static struct
+{
+	bool started;
+	bool recording;
+	std::string filename;
+	std::vector<uint32_t> expected;
+	std::vector<uint32_t> hashes;
+	int desynctic;
+	dtime_t starttime;
+} trace;
+
+//
+// CL_HashValue
+//
+// FNV-1a over the bytes of a value, so the hash does not depend on the
+// byte order of the machine.
+//
+static inline void CL_HashValue(uint32_t& hash, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		hash ^= (value >> (i * 8)) & 0xFF;
+		hash *= 16777619u;
+	}
+}
+
+//
+// CL_DemoStateHash
+//
+// Hashes the parts of the play simulation a desync shows up in first.
+//
+static uint32_t CL_DemoStateHash()
+{
+	uint32_t hash = 2166136261u;
+
+	CL_HashValue(hash, gamestate);
+	CL_HashValue(hash, level.time);
+	CL_HashValue(hash, prndindex);
+
+	TThinkerIterator<AActor> iterator;
+	AActor* mo;
+	while ((mo = iterator.Next()))
+	{
+		CL_HashValue(hash, mo->type);
+		CL_HashValue(hash, mo->x);
+		CL_HashValue(hash, mo->y);
+		CL_HashValue(hash, mo->z);
+		CL_HashValue(hash, mo->angle);
+		CL_HashValue(hash, mo->momx);
+		CL_HashValue(hash, mo->momy);
+		CL_HashValue(hash, mo->momz);
+		CL_HashValue(hash, mo->health);
+		CL_HashValue(hash, mo->flags);
+	}
+
+	for (const player_t& player : players)
+	{
+		if (!player.ingame())
+			continue;
+
+		CL_HashValue(hash, player.health);
+		CL_HashValue(hash, player.armorpoints);
+		CL_HashValue(hash, player.readyweapon);
+	}
+
+	return hash;
+}
+
+//
+// CL_DemoTraceStart
+//
+static void CL_DemoTraceStart()
+{
+	trace.started = true;
+	trace.desynctic = -1;
+	trace.starttime = I_GetTime();
+
+	const char* filename = Args.CheckValue("-demotrace");
+	if (filename == NULL)
+		return;
+
+	trace.filename = filename;
+	trace.recording = Args.CheckParm("-recordtrace") || !M_FileExists(trace.filename);
+	if (trace.recording)
+		return;
+
+	std::ifstream in(trace.filename.c_str());
+	std::string line;
+	while (std::getline(in, line))
+		trace.expected.push_back(strtoul(line.c_str(), NULL, 16));
+}
+
+//
+// CL_DemoTraceTic
+//
+// Called after every tic of +demotest playback.
+//
+void CL_DemoTraceTic()
+{
+	if (!trace.started)
+		CL_DemoTraceStart();
+
+	const uint32_t hash = CL_DemoStateHash();
+	const size_t tic = trace.hashes.size();
+	trace.hashes.push_back(hash);
+
+	if (trace.filename.empty() || trace.recording)
+		return;
+
+	if (tic >= trace.expected.size() || trace.expected[tic] != hash)
+	{
+		trace.desynctic = static_cast<int>(tic);
+		PrintFmt(PRINT_WARNING, "Demo desynced at tic {}\n", tic);
+
+		// nothing after the first desync can be compared, so stop here
+		G_CheckDemoStatus();
+	}
+}
+
+//
+// CL_DemoTraceFinish
+//
+// Called when +demotest playback ends. Saves the trace when recording
+// and prints a line for -demolist to pick up:
+//
+// demotrace:<tics> <first desynced tic or -1> <nanoseconds> <recorded>
+//
+void CL_DemoTraceFinish()
+{
+	const dtime_t elapsed = trace.started ? I_GetTime() - trace.starttime : 0;
+
+	// a demo that ends early desyncs on the first tic it is missing
+	if (!trace.filename.empty() && !trace.recording && trace.desynctic < 0 &&
+	    trace.hashes.size() < trace.expected.size())
+		trace.desynctic = static_cast<int>(trace.hashes.size());
+
+	if (!trace.filename.empty() && trace.recording)
+	{
+		std::string out;
+		for (uint32_t hash : trace.hashes)
+			out += fmt::format("{:08x}\n", hash);
+
+		if (!M_WriteFile(trace.filename, (void*)out.data(), out.size()))
+			PrintFmt(PRINT_WARNING, "Could not write demo trace {}\n", trace.filename);
+	}
+
+	PrintFmt(PRINT_HIGH, "demotrace:{} {} {} {}\n", trace.hashes.size(), trace.desynctic,
+	         elapsed, trace.recording ? 1 : 0);
+}
+
+
+// ============================================================================
+//
+// -demolist runner
+//
+// ============================================================================
+
+struct demoentry_t
+{
+	std::string iwad;
+	std::vector<std::string> files;		// pwads and dehacked patches
+	std::string demo;
+	std::string expected;				// final demotest: line, may be empty
+	std::string tracefile;
+	std::string logfile;
+
+	// read back from the log of the child process
+	std::string result;
+	size_t tics;
+	int desynctic;
+	double seconds;
+	bool recorded;
+};
+
+//
+// CL_SplitListLine
+//
+// Splits a DEMOLIST line into its fields, keeping {braced} lists whole.
+//
+static std::vector<std::string> CL_SplitListLine(const std::string& line)
+{
+	std::vector<std::string> fields;
+	size_t pos = 0;
+
+	while (pos < line.size())
+	{
+		if (isspace(static_cast<unsigned char>(line[pos])))
+		{
+			pos++;
+			continue;
+		}
+
+		size_t end;
+		if (line[pos] == '{')
+		{
+			end = line.find('}', pos);
+			if (end == std::string::npos)
+				end = line.size();
+			fields.push_back(line.substr(pos + 1, end - pos - 1));
+			pos = end + 1;
+		}
+		else
+		{
+			end = pos;
+			while (end < line.size() && !isspace(static_cast<unsigned char>(line[end])))
+				end++;
+			fields.push_back(line.substr(pos, end - pos));
+			pos = end;
+		}
+	}
+
+	return fields;
+}
+
+//
+// CL_SplitWords
+//
+static std::vector<std::string> CL_SplitWords(const std::string& str)
+{
+	std::vector<std::string> words;
+	std::istringstream in(str);
+	std::string word;
+	while (in >> word)
+		words.push_back(word);
+	return words;
+}
+
+//
+// CL_ResolveListFile
+//
+// Files in a demo list are looked up next to the list first.
+//
+static std::string CL_ResolveListFile(const std::string& dir, const std::string& name)
+{
+	const std::string path = M_JoinPath(dir, name);
+	return M_FileExists(path) ? path : name;
+}
+
+//
+// CL_ShellQuote
+//
+static std::string CL_ShellQuote(const std::string& arg)
+{
+#ifdef _WIN32
+	return "\"" + arg + "\"";
+#else
+	std::string quoted = "'";
+	for (char c : arg)
+	{
+		if (c == '\'')
+			quoted += "'\\''";
+		else
+			quoted += c;
+	}
+	return quoted + "'";
+#endif
+}
+
+//
+// CL_DemoTestCommand
+//
+// Builds the command line of the +demotest process for one demo.
+//
+static std::string CL_DemoTestCommand(const demoentry_t& entry, const std::string& config,
+                                      bool retrace)
+{
+	std::string command = CL_ShellQuote(Args.GetArg(0));
+	command += " -nosound -novideo -iwad " + CL_ShellQuote(entry.iwad);
+
+	for (const std::string& file : entry.files)
+	{
+		std::string ext;
+		M_ExtractFileExtension(file, ext);
+		command += iequals(ext, ".deh") ? " -deh " : " -file ";
+		command += CL_ShellQuote(file);
+	}
+
+	command += " +demotest " + CL_ShellQuote(entry.demo);
+	command += " -demotrace " + CL_ShellQuote(entry.tracefile);
+	if (retrace)
+		command += " -recordtrace";
+	if (!config.empty())
+		command += " -config " + CL_ShellQuote(config);
+	command += " +logfile " + CL_ShellQuote(entry.logfile);
+
+#ifdef _WIN32
+	// cmd.exe strips the outer quotes when the command starts with one
+	return "\"" + command + " >NUL 2>&1\"";
+#else
+	return command + " >/dev/null 2>&1";
+#endif
+}
+
+//
+// CL_ReadDemoTestLog
+//
+static void CL_ReadDemoTestLog(demoentry_t& entry)
+{
+	std::ifstream log(entry.logfile.c_str());
+	std::string line;
+
+	while (std::getline(log, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.compare(0, 9, "demotest:") == 0)
+		{
+			entry.result = line.substr(9);
+		}
+		else if (line.compare(0, 10, "demotrace:") == 0)
+		{
+			std::istringstream in(line.substr(10));
+			dtime_t elapsed = 0;
+			int recorded = 0;
+			in >> entry.tics >> entry.desynctic >> elapsed >> recorded;
+			entry.seconds = elapsed / 1e9;
+			entry.recorded = recorded != 0;
+		}
+	}
+}
+
+//
+// CL_RunDemoList
+//
+bool CL_RunDemoList(const char* listfile)
+{
+	std::ifstream list(listfile);
+	if (!list)
+	{
+		PrintFmt(PRINT_WARNING, "demolist: could not open {}\n", listfile);
+		return false;
+	}
+
+	std::string listdir;
+	M_ExtractFilePath(listfile, listdir);
+
+	const char* tracedir = Args.CheckValue("-tracedir");
+	const std::string tracepath = tracedir ? tracedir : listdir;
+	const std::string workdir = M_JoinPath(M_GetWriteDir(), "demotest");
+
+	std::error_code ec;
+	fs::create_directories(workdir, ec);
+	if (!tracepath.empty())
+		fs::create_directories(tracepath, ec);
+
+	std::vector<demoentry_t> entries;
+	std::string line;
+	while (std::getline(list, line))
+	{
+		const std::vector<std::string> fields = CL_SplitListLine(line);
+		if (fields.empty())
+			continue;	// ignore blank lines
+
+		if (fields.size() < 3)
+		{
+			PrintFmt(PRINT_WARNING, "demolist: ignoring \"{}\"\n", line);
+			continue;
+		}
+
+		demoentry_t entry;
+		entry.iwad = CL_ResolveListFile(listdir, fields[0]);
+
+		// the same demo lump plays back differently with other PWADs, so the
+		// PWAD list is part of the trace name
+		uint32_t fileshash = 2166136261u;
+		for (const std::string& file : CL_SplitWords(fields[1]))
+		{
+			if (file == ".")
+				continue;
+
+			entry.files.push_back(CL_ResolveListFile(listdir, file));
+			for (const char ch : file + " ")
+			{
+				fileshash ^= static_cast<unsigned char>(ch);
+				fileshash *= 16777619u;
+			}
+		}
+		entry.demo = CL_ResolveListFile(listdir, fields[2]);
+		if (fields.size() > 3)
+			entry.expected = JoinStrings(CL_SplitWords(fields[3]), " ");
+
+		std::string iwadbase, demobase;
+		M_ExtractFileBase(fields[0], iwadbase);
+		M_ExtractFileBase(fields[2], demobase);
+		const std::string tracename =
+		    entry.files.empty()
+		        ? fmt::format("{}_{}.trace", iwadbase, demobase)
+		        : fmt::format("{}_{:08x}_{}.trace", iwadbase, fileshash, demobase);
+		entry.tracefile = M_JoinPath(tracepath, tracename);
+		entry.logfile = M_JoinPath(workdir, fmt::format("{}.log", entries.size()));
+
+		entry.tics = 0;
+		entry.desynctic = -1;
+		entry.seconds = 0.0;
+		entry.recorded = false;
+		entries.push_back(entry);
+	}
+
+	if (entries.empty())
+	{
+		PrintFmt(PRINT_WARNING, "demolist: no demos in {}\n", listfile);
+		return false;
+	}
+
+	int jobs = static_cast<int>(std::thread::hardware_concurrency());
+	if (const char* value = Args.CheckValue("-jobs"))
+		jobs = atoi(value);
+	jobs = clamp<int>(jobs, 1, entries.size());
+
+	const bool retrace = Args.CheckParm("-retrace");
+
+	// every child gets its own copy of the config, since they all save it
+	// when they quit
+	const std::string config = M_GetConfigPath();
+
+	PrintFmt(PRINT_HIGH, "demolist: running {} demos, {} at a time\n", entries.size(), jobs);
+
+	const dtime_t starttime = I_GetTime();
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+
+	for (int i = 0; i < jobs; i++)
+	{
+		workers.emplace_back([&, i]() {
+			const std::string workconfig = M_JoinPath(workdir, fmt::format("{}.cfg", i));
+			std::error_code copyec;
+			if (!fs::copy_file(config, workconfig, fs::copy_options::overwrite_existing, copyec))
+				fs::remove(workconfig, copyec);
+
+			for (size_t index; (index = next++) < entries.size(); )
+			{
+				demoentry_t& entry = entries[index];
+				fs::remove(entry.logfile, copyec);
+				std::system(CL_DemoTestCommand(entry, workconfig, retrace).c_str());
+			}
+		});
+	}
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	const double seconds = (I_GetTime() - starttime) / 1e9;
+
+	size_t passed = 0, totaltics = 0;
+	for (demoentry_t& entry : entries)
+	{
+		CL_ReadDemoTestLog(entry);
+		totaltics += entry.tics;
+
+		std::string status, detail;
+		if (entry.result.empty())
+			status = "CRASHED";
+		else if (entry.desynctic >= 0)
+			status = "FAIL", detail = fmt::format(" desync at tic {},", entry.desynctic);
+		else if (!entry.expected.empty() && entry.result != entry.expected)
+			status = "FAIL";
+		else
+			status = entry.recorded ? "RECORDED" : "PASS";
+
+		const bool ok = status == "PASS" || status == "RECORDED";
+		if (ok)
+			passed++;
+
+		const double ticrate = entry.seconds > 0.0 ? entry.tics / entry.seconds : 0.0;
+		PrintFmt(ok ? PRINT_HIGH : PRINT_WARNING, "{} {} [{}]{} {} tics, {:.0f} tics/s\n",
+		         M_ExtractFileName(entry.iwad), M_ExtractFileName(entry.demo), status, detail,
+		         entry.tics, ticrate);
+	}
+
+	PrintFmt(PRINT_HIGH, "demolist: {} of {} demos passed in {:.2f}s, {:.0f} tics/s\n",
+	         passed, entries.size(), seconds, seconds > 0.0 ? totaltics / seconds : 0.0);
+
+	return passed == entries.size();
+}
+
+VERSION_CONTROL (cl_demotest_cpp, "$Id$")
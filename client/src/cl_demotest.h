@@ -0,0 +1,32 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Demo sync testing: per-tic state traces for +demotest and a runner
+//	that plays a whole list of demos in parallel child processes.
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+// +demotest side, only active when -demotrace is given
+void CL_DemoTraceTic();
+void CL_DemoTraceFinish();
+
+// -demolist side, returns true if every demo passed
+bool CL_RunDemoList(const char* listfile);
@@ -34,10 +34,13 @@
 #include "c_dispatch.h"
 #include "cl_main.h"
 #include "cmdlib.h"
+#include "crc32.h"
+#include "i_net.h"
 #include "i_system.h"
 #include "m_argv.h"
 #include "m_fileio.h"
 #include "w_ident.h"
+#include "w_wad.h"
 #include "m_random.h"
 
 EXTERN_CVAR(cl_waddownloaddir)
@@ -48,7 +51,41 @@ enum States
 	STATE_SHUTDOWN,
 	STATE_READY,
 	STATE_CHECKING,
-	STATE_DOWNLOADING
+	STATE_DOWNLOADING,
+	STATE_SERVERDOWNLOAD
+};
+
+/**
+ * @brief A file being downloaded from the game server rather than a website.
+ */
+struct ServerTransfer
+{
+	netadr_t address;
+	DWORD token;
+	bool hastoken;
+	FILE* part;
+	std::string dest;
+	std::string partname;
+	uint32_t filesize;
+	uint32_t received;
+	uint32_t acked;
+	dtime_t lastsent;
+	dtime_t lastrecv;
+	dtime_t lastresend;
+	int retries;
+
+	ServerTransfer()
+	    : token(0), hastoken(false), part(NULL), dest(""), partname(""), filesize(0),
+	      received(0), acked(0), lastsent(0), lastrecv(0), lastresend(0), retries(0)
+	{
+		memset(&address, 0, sizeof(address));
+	}
+	void Close()
+	{
+		if (this->part != NULL)
+			fclose(this->part);
+		*this = ServerTransfer();
+	}
 };
 
 static struct DownloadState
@@ -68,6 +105,7 @@ static struct DownloadState
 	size_t checkurlidx;
 	std::string checkfilename;
 	int checkfails;
+	ServerTransfer server;
 	DownloadState()
 	    : state(STATE_SHUTDOWN), check(NULL), transfer(NULL), url(""), filename(""),
 	      hash(), flags(0), checkurls(), checkurlidx(0), checkfilename(""),
@@ -89,6 +127,7 @@ static struct DownloadState
 		this->checkurlidx = 0;
 		this->checkfilename = "";
 		this->checkfails = 0;
+		this->server.Close();
 	}
 } dlstate;
 
@@ -117,6 +156,7 @@ void CL_DownloadShutdown()
 	::dlstate.check = NULL;
 	delete ::dlstate.transfer;
 	::dlstate.transfer = NULL;
+	::dlstate.server.Close();
 
 	curl_global_cleanup();
 	::dlstate.state = STATE_SHUTDOWN;
@@ -129,7 +169,44 @@ void CL_DownloadShutdown()
  */
 bool CL_IsDownloading()
 {
-	return ::dlstate.state == STATE_CHECKING || ::dlstate.state == STATE_DOWNLOADING;
+	return ::dlstate.state == STATE_CHECKING || ::dlstate.state == STATE_DOWNLOADING ||
+	       ::dlstate.state == STATE_SERVERDOWNLOAD;
+}
+
+/**
+ * @brief Check if a file is being downloaded from a game server, whose
+ *        replies should be handed to CL_ServerDownloadPacket.
+ */
+bool CL_IsServerDownloading()
+{
+	return ::dlstate.state == STATE_SERVERDOWNLOAD;
+}
+
+/**
+ * @brief Refuse to download commercial WADs, whatever they are called.
+ *
+ * @return true if the file must not be downloaded.
+ */
+static bool IsCommercialFile(const OWantFile& filename)
+{
+	if (W_IsFilenameCommercialWAD(filename.getBasename()))
+	{
+		PrintFmt(PRINT_WARNING, "{} is a commercial WAD file and cannot be downloaded by Odamex.\n"
+		                        "A copy can be obtained through purchasing DOOM + DOOM II from Steam or GOG.\n",
+		                        filename.getBasename());
+		return true;
+	}
+
+	if (W_IsFilehashCommercialWAD(filename.getWantedMD5()))
+	{
+		const fileIdentifier_t* id = W_GameInfo(filename.getWantedMD5());
+		PrintFmt(PRINT_WARNING, "{} is a renamed commercial wad file containing {}.\n"
+		                        "A copy of {} can be obtained through purchasing DOOM + DOOM II from Steam or GOG.\n",
+		                        filename.getBasename(), id->mNiceName, id->mFilename);
+		return true;
+	}
+
+	return false;
 }
 
 /**
@@ -175,22 +252,8 @@ bool CL_StartDownload(const Websites& urls, const OWantFile& filename, unsigned
 		return false;
 	}
 
-	if (W_IsFilenameCommercialWAD(filename.getBasename()))
-	{
-		PrintFmt(PRINT_WARNING, "{} is a commercial WAD file and cannot be downloaded by Odamex.\n"
-		                        "A copy can be obtained through purchasing DOOM + DOOM II from Steam or GOG.\n",
-		                        filename.getBasename());
+	if (IsCommercialFile(filename))
 		return false;
-	}
-
-	if (W_IsFilehashCommercialWAD(filename.getWantedMD5()))
-	{
-		const fileIdentifier_t* id = W_GameInfo(filename.getWantedMD5());
-		PrintFmt(PRINT_WARNING, "{} is a renamed commercial wad file containing {}.\n"
-		                        "A copy of {} can be obtained through purchasing DOOM + DOOM II from Steam or GOG.\n",
-		                        filename.getBasename(), id->mNiceName, id->mFilename);
-		return false;
-	}
 
 	// Add a slash to the end of the base sites.
 	::dlstate.checkurls = checkurls;
@@ -437,6 +500,350 @@ static void TickDownload()
 	}
 }
 
+//
+// Downloading from the game server itself, for setups where clients can't
+// reach a website.  The protocol is described in sv_download.cpp.
+//
+
+// Acknowledge progress at least this often while chunks are arriving.
+static const uint32_t SERVER_ACK_BYTES = 8 * 1024;
+
+// Send a request at least this often, in case ours or the server's
+// replies were lost.
+static const dtime_t SERVER_REQUEST_INTERVAL = 250;
+
+// Don't ask for the same gap to be filled more often than this.
+static const dtime_t SERVER_RESEND_HOLDOFF = 100;
+
+// Start over with a fresh token if the server has been silent this long.
+static const dtime_t SERVER_SILENCE_TIMEOUT = 3000;
+
+// Give up after starting over this many times in a row.
+static const int SERVER_MAX_RETRIES = 5;
+
+/**
+ * @brief Ask the server for more of the file, or for a token to do so with.
+ *
+ * @param resend True if chunks went missing and should be sent again.
+ */
+static void SendServerRequest(bool resend)
+{
+	ServerTransfer& server = ::dlstate.server;
+	const dtime_t now = I_MSTime();
+
+	if (resend)
+	{
+		if (now - server.lastresend < SERVER_RESEND_HOLDOFF)
+			return;
+		server.lastresend = now;
+	}
+
+	SZ_Clear(&net_buffer);
+	if (!server.hastoken)
+	{
+		// The launcher reply carries the token that requests must present.
+		MSG_WriteLong(&net_buffer, LAUNCHER_CHALLENGE);
+	}
+	else
+	{
+		MSG_WriteLong(&net_buffer, DOWNLOAD_CHALLENGE);
+		MSG_WriteLong(&net_buffer, server.token);
+		MSG_WriteString(&net_buffer, ::dlstate.hash.getHexCStr());
+		MSG_WriteLong(&net_buffer, server.received);
+		MSG_WriteByte(&net_buffer, resend ? 1 : 0);
+		server.acked = server.received;
+	}
+	NET_SendPacket(net_buffer, server.address);
+	SZ_Clear(&net_buffer);
+
+	server.lastsent = now;
+}
+
+/**
+ * @brief Open the partial file in the first download directory that will
+ *        take it, picking up where an earlier attempt left off.
+ */
+static bool OpenServerPart()
+{
+	ServerTransfer& server = ::dlstate.server;
+
+	StringTokens dirs = GetDownloadDirs();
+	for (const auto& dir : dirs)
+	{
+		// Ensure no path-traversal shenanegins are going on.
+		std::string dest = M_CleanPath(dir + PATHSEP + ::dlstate.filename);
+		if (dest.find(dir) != 0)
+		{
+			TransferError("Saved file tried to escape download directory.\n");
+			return false;
+		}
+
+		const std::string partname = dest + ".part";
+		FILE* part = fopen(partname.c_str(), "r+b");
+		if (part == NULL)
+			part = fopen(partname.c_str(), "w+b");
+		if (part == NULL)
+		{
+			PrintFmt(PRINT_WARNING, "Could not save to {} ({})\n", dest, strerror(errno));
+			continue;
+		}
+
+		const SDWORD length = M_FileLength(part);
+		server.part = part;
+		server.dest = dest;
+		server.partname = partname;
+		server.received = length > 0 ? length : 0;
+		return true;
+	}
+
+	TransferError("No safe place to save file.\n");
+	return false;
+}
+
+/**
+ * @brief Start downloading a file from a game server.
+ *
+ * @param address Server to download from.
+ * @param filename File to download, which must have a known hash.
+ * @param flags DL_* flags to set for the download process.
+ */
+bool CL_StartServerDownload(const netadr_t& address, const OWantFile& filename,
+                            unsigned flags)
+{
+	if (::dlstate.state != STATE_READY)
+	{
+		PrintFmt(PRINT_WARNING, "Can't start download when download state is not ready.\n");
+		return false;
+	}
+
+	if (filename.getWantedMD5().empty())
+	{
+		PrintFmt(PRINT_WARNING, "Can't download {} from the server without its hash.\n",
+		         filename.getBasename());
+		return false;
+	}
+
+	if (IsCommercialFile(filename))
+		return false;
+
+	::dlstate.filename = filename.getBasename();
+	::dlstate.hash = filename.getWantedMD5();
+	::dlstate.flags = flags;
+
+	if (!OpenServerPart())
+	{
+		::dlstate.Ready();
+		return false;
+	}
+
+	ServerTransfer& server = ::dlstate.server;
+	server.address = address;
+	server.lastrecv = I_MSTime();
+
+	if (server.received > 0)
+	{
+		std::string bytes;
+		StrFormatBytes(bytes, server.received);
+		PrintFmt("Resuming download of {} from the server after {}...\n",
+		         ::dlstate.filename, bytes);
+	}
+	else
+	{
+		PrintFmt("Downloading {} from the server...\n", ::dlstate.filename);
+	}
+
+	::dlstate.state = STATE_SERVERDOWNLOAD;
+	SendServerRequest(false);
+	return true;
+}
+
+/**
+ * @brief Verify and keep a file that has been received in full.
+ */
+static void FinishServerDownload()
+{
+	ServerTransfer& server = ::dlstate.server;
+
+	// Let the server know we're done rather than have it time us out.
+	SendServerRequest(false);
+
+	fclose(server.part);
+	server.part = NULL;
+
+	// Verify that the file is what the server wants and is not a renamed
+	// commercial WAD.
+	OMD5Hash actualHash = W_MD5(server.partname);
+	if (W_IsFilehashCommercialWAD(actualHash))
+	{
+		remove(server.partname.c_str());
+		TransferError("Accidentally downloaded a commercial WAD - file removed");
+		::dlstate.Ready();
+		return;
+	}
+	else if (actualHash != ::dlstate.hash)
+	{
+		remove(server.partname.c_str());
+		TransferError("Downloaded file is not the same as the server's file - file removed");
+		::dlstate.Ready();
+		return;
+	}
+
+	if (rename(server.partname.c_str(), server.dest.c_str()) != 0)
+	{
+		// See if we can write a file with a partial hash.
+		std::string path, base, ext, fallback;
+		M_ExtractFilePath(server.dest, path);
+		M_ExtractFileBase(server.dest, base);
+		M_ExtractFileExtension(server.dest, ext);
+		fallback = fmt::sprintf("%s%s%s.%s%s", path, PATHSEP, base,
+		                        actualHash.getHexStr().substr(0, 6), ext);
+
+		if (rename(server.partname.c_str(), fallback.c_str()) != 0)
+		{
+			std::string buf = fmt::sprintf("File %s could not be renamed to %s - %s",
+			                               server.partname, server.dest, strerror(errno));
+			TransferError(buf.c_str());
+			::dlstate.Ready();
+			return;
+		}
+
+		PrintFmt("Saved to fallback location \"{}\".\n", fallback);
+	}
+	else
+	{
+		PrintFmt("Saved to location \"{}\".\n", server.dest);
+	}
+
+	PrintFmt("Download completed.\n");
+
+	const unsigned flags = ::dlstate.flags;
+	::dlstate.Ready();
+
+	if (flags & DL_RECONNECT)
+		CL_Reconnect();
+}
+
+/**
+ * @brief Handle a connectionless packet that arrived while downloading from
+ *        a game server.  Anything not from that server is dropped.
+ */
+void CL_ServerDownloadPacket()
+{
+	ServerTransfer& server = ::dlstate.server;
+	if (::dlstate.state != STATE_SERVERDOWNLOAD || !NET_CompareAdr(server.address, net_from))
+		return;
+
+	const int type = MSG_ReadLong();
+	if (type == MSG_CHALLENGE)
+	{
+		// Launcher reply, the rest of it is of no interest.
+		server.token = MSG_ReadLong();
+		server.hastoken = true;
+		server.lastrecv = I_MSTime();
+		SendServerRequest(false);
+		return;
+	}
+
+	if (type != DOWNLOAD_CHALLENGE)
+		return;
+
+	const int offset = MSG_ReadLong();
+	if (offset == -1)
+	{
+		TransferError(MSG_ReadString());
+		::dlstate.Ready();
+		return;
+	}
+
+	const uint32_t filesize = MSG_ReadLong();
+	const uint32_t crc = MSG_ReadLong();
+	const size_t len = static_cast<unsigned short>(MSG_ReadShort());
+	const void* data = MSG_ReadChunk(len);
+	if (data == NULL && len > 0)
+		return;
+
+	server.lastrecv = I_MSTime();
+	server.retries = 0;
+	server.filesize = filesize;
+
+	if (server.received > filesize)
+	{
+		// Left over from some other file, start over.
+		fclose(server.part);
+		server.part = fopen(server.partname.c_str(), "w+b");
+		if (server.part == NULL)
+		{
+			TransferError("Could not truncate partial file");
+			::dlstate.Ready();
+			return;
+		}
+		server.received = 0;
+		SendServerRequest(true);
+		return;
+	}
+
+	if (static_cast<uint32_t>(offset) != server.received)
+	{
+		// Ahead of us means something in between went missing.
+		if (static_cast<uint32_t>(offset) > server.received)
+			SendServerRequest(true);
+		return;
+	}
+
+	if (crc32_fast(data, len) != crc)
+	{
+		SendServerRequest(true);
+		return;
+	}
+
+	if (len > 0)
+	{
+		if (fseek(server.part, server.received, SEEK_SET) != 0 ||
+		    fwrite(data, 1, len, server.part) != len)
+		{
+			TransferError("Could not write to partial file");
+			::dlstate.Ready();
+			return;
+		}
+		server.received += len;
+	}
+
+	if (server.received == server.filesize)
+	{
+		FinishServerDownload();
+		return;
+	}
+
+	if (server.received - server.acked >= SERVER_ACK_BYTES)
+		SendServerRequest(false);
+}
+
+static void TickServerDownload()
+{
+	ServerTransfer& server = ::dlstate.server;
+	const dtime_t now = I_MSTime();
+
+	if (now - server.lastrecv >= SERVER_SILENCE_TIMEOUT)
+	{
+		// Our token may have expired, get a new one and carry on from what
+		// we have.
+		server.retries += 1;
+		if (server.retries > SERVER_MAX_RETRIES)
+		{
+			TransferError("Server stopped responding, partial file kept for next time");
+			::dlstate.Ready();
+			return;
+		}
+
+		server.hastoken = false;
+		server.lastrecv = now;
+		server.lastsent = 0;
+	}
+
+	if (now - server.lastsent >= SERVER_REQUEST_INTERVAL)
+		SendServerRequest(false);
+}
+
 /**
  * @brief Service the download per-tick.
  */
@@ -454,6 +861,9 @@ void CL_DownloadTick()
 		::dlstate.check = NULL;
 		TickDownload();
 		break;
+	case STATE_SERVERDOWNLOAD:
+		TickServerDownload();
+		break;
 	default:
 		delete ::dlstate.check;
 		::dlstate.check = NULL;
@@ -470,6 +880,9 @@ void CL_DownloadTick()
  */
 std::string CL_DownloadFilename()
 {
+	if (::dlstate.state == STATE_SERVERDOWNLOAD)
+		return ::dlstate.server.dest;
+
 	if (::dlstate.state != STATE_DOWNLOADING)
 		return std::string("");
 
@@ -486,6 +899,14 @@ std::string CL_DownloadFilename()
  */
 OTransferProgress CL_DownloadProgress()
 {
+	if (::dlstate.state == STATE_SERVERDOWNLOAD)
+	{
+		OTransferProgress progress;
+		progress.dltotal = ::dlstate.server.filesize;
+		progress.dlnow = ::dlstate.server.received;
+		return progress;
+	}
+
 	if (::dlstate.state != STATE_DOWNLOADING)
 		return OTransferProgress();
 
@@ -26,6 +26,7 @@
 
 #include "otransfer.h"
 #include "m_resfile.h"
+#include "i_net.h"
 
 /**
  * @brief Set if the client should reconnect to the last server upon completion
@@ -38,7 +39,11 @@ typedef std::vector<std::string> Websites;
 void CL_DownloadInit();
 void CL_DownloadShutdown();
 bool CL_IsDownloading();
+bool CL_IsServerDownloading();
 bool CL_StartDownload(const Websites& urls, const OWantFile& filename, unsigned flags);
+bool CL_StartServerDownload(const netadr_t& address, const OWantFile& filename,
+                            unsigned flags);
+void CL_ServerDownloadPacket();
 bool CL_StopDownload();
 void CL_DownloadTick();
 std::string CL_DownloadFilename();
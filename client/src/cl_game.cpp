@@ -59,8 +59,11 @@
 #include "r_interp.h"
 #include "g_game.h"
 #include "cl_main.h"
+#include "cl_benchmark.h"
 #include "cl_demo.h"
+#include "cl_demotest.h"
 #include "cl_replay.h"
+#include "cl_download.h"
 #include "gi.h"
 #include "hu_mousegraph.h"
 #include "g_spawninv.h"
@@ -89,6 +92,7 @@ bool	C_DoNetDemoKey(event_t *ev);
 bool	C_DoSpectatorKey(event_t *ev);
 
 void	CL_QuitCommand();
+void	STACK_ARGS call_terms();
 
 fixed_t P_TickWeaponBobX();
 fixed_t P_TickWeaponBobY();
@@ -1051,6 +1055,12 @@ void G_Ticker (void)
 		if (gametic - last_received > 65)
 			noservermsgs = true;
 	}
+	else if (CL_IsServerDownloading() && !simulated_connection)
+	{
+		// Take every chunk that has arrived, not just one per tic.
+		while (NET_GetPacket())
+			CL_ServerDownloadPacket();
+	}
 	else if (NET_GetPacket() && !simulated_connection)
 	{
 		// denis - don't accept candy from strangers
@@ -1198,6 +1208,10 @@ void G_Ticker (void)
 	default:
 		break;
 	}
+
+	extern bool demotest;
+	if (demotest && demoplayback)
+		CL_DemoTraceTic();
 }
 
 
@@ -2139,6 +2153,8 @@ bool G_CheckDemoStatus (void)
 		extern bool demotest;
 		if (demotest)
 		{
+			CL_DemoTraceFinish();
+
 			AActor *mo = idplayer(1).mo;
 
 			if (mo)
@@ -2169,7 +2185,18 @@ bool G_CheckDemoStatus (void)
 				PrintFmt(PRINT_HIGH, "timed {} gametics in {} realtics ({:.1f} fps)\n",
 				         gametic, realtics, fps);
 
-				// exit the application
+				// a benchmark plays the demo again with its next setup
+				if (CL_BenchmarkNextRun())
+					return true;
+
+				// exit the application, with an error if -columnbatchtest
+				// found frames that differ
+				if (!R_ColumnBatchTestPassed())
+				{
+					call_terms();
+					exit(EXIT_FAILURE);
+				}
+
 				CL_QuitCommand();
 				return false;
 			}
@@ -122,6 +122,7 @@ static int packetseq[256];
 std::string digest;
 
 std::string server_host = "";	// hostname of server
+static bool server_waddownload = false;	// server hands out its own WAD files
 
 // [SL] 2011-06-27 - Class to record and playback network recordings
 NetDemo netdemo;
@@ -887,8 +888,7 @@ BEGIN_COMMAND (serverinfo)
     // Data
 	for (const auto& varname : server_cvars)
 	{
-		cvar_t *dummy;
-		Cvar = cvar_t::FindCVar(varname.c_str(), &dummy);
+		Cvar = cvar_t::FindCVar(varname.c_str());
 
 		PrintFmt("{1:>{0}} - {2}\n",
 			     MaxFieldLength,
@@ -1510,6 +1510,19 @@ void CL_QuitAndTryDownload(const OWantFile& missing_file)
 
 	if (sv_downloadsites.str().empty() && cl_downloadsites.str().empty())
 	{
+		if (::server_waddownload)
+		{
+			// No websites, but the server hands out its own files.
+			const netadr_t address = ::serveraddr;
+
+			PrintFmt(PRINT_HIGH, "Need to download \"{}\", disconnecting from server...\n",
+			         missing_file.getBasename());
+			CL_QuitNetGame(NQ_SILENT);
+
+			CL_StartServerDownload(address, missing_file, DL_RECONNECT);
+			return;
+		}
+
 		// Nobody has any download sites configured.
 		PrintFmt("Unable to find \"{}\".  Both your client and the server have no "
 		         "download sites configured.\n",
@@ -1556,6 +1569,7 @@ bool CL_PrepareConnect()
 
 	bool recv_teamplay_stats = 0;
 	gameversiontosend = 0;
+	::server_waddownload = false;
 
 	byte playercount = MSG_ReadByte(); // players
 	MSG_ReadByte(); // max_players
@@ -1640,7 +1654,10 @@ bool CL_PrepareConnect()
 
 		for (l = 0; l < 3; l++)
 			MSG_ReadShort();
-		for (l = 0; l < 14; l++)
+		for (l = 0; l < 10; l++)
+			MSG_ReadBool();
+		::server_waddownload = MSG_ReadBool();
+		for (l = 0; l < 3; l++)
 			MSG_ReadBool();
 		for (l = 0; l < playercount; l++)
 		{
@@ -1864,7 +1881,7 @@ void CL_TryToConnect(DWORD server_token)
 		MSG_WriteLong(&net_buffer, PROTO_CHALLENGE); // send challenge
 		MSG_WriteLong(&net_buffer, server_token); // confirm server token
 		MSG_WriteShort(&net_buffer, version); // send client version
-		MSG_WriteByte(&net_buffer, 0); // send type of connection (play/spectate/rcon/download)
+		MSG_WriteByte(&net_buffer, CONNECT_SNAPSHOTS); // optional protocol features we support
 
 		// GhostlyDeath -- Send more version info
 		if (gameversiontosend)
@@ -60,6 +60,7 @@
 #include "s_sound.h"
 #include "st_stuff.h"
 #include "svc_map.h"
+#include "svc_snapshot.h"
 #include "v_textcolors.h"
 #include "p_mapformat.h"
 #include "infomap.h"
@@ -101,6 +102,7 @@ extern std::set<byte> teleported_players;
 void CL_CheckDisplayPlayer(void);
 void CL_ClearPlayerJustTeleported(player_t* player);
 void CL_ClearSectorSnapshots();
+static void CL_ClearWorldSnapshots();
 player_t& CL_FindPlayer(size_t id);
 std::string CL_GenerateNetDemoFileName(
     const std::string& filename = cl_netdemoname.str());
@@ -867,6 +869,7 @@ static void CL_LoadMap(const odaproto::svc::LoadMap* msg)
 	CL_ClearSectorSnapshots();
 	for (auto& player : players)
 		player.snapshots.clearSnapshots();
+	CL_ClearWorldSnapshots();
 
 	// reset the world_index (force it to sync)
 	CL_ResyncWorldIndex();
@@ -2075,12 +2078,12 @@ static void CL_SecretEvent(const odaproto::svc::SecretEvent* msg)
 
 static void CL_ServerSettings(const odaproto::svc::ServerSettings* msg)
 {
-	cvar_t *var = NULL, *prev = NULL;
+	cvar_t *var = NULL;
 
 	std::string CvarKey = msg->key();
 	std::string CvarValue = msg->value();
 
-	var = cvar_t::FindCVar(CvarKey.c_str(), &prev);
+	var = cvar_t::FindCVar(CvarKey.c_str());
 
 	// GhostlyDeath <June 19, 2008> -- Read CVAR or dump it
 	if (var)
@@ -2873,6 +2876,118 @@ static void CL_HordeInfo(const odaproto::svc::HordeInfo* msg)
 	P_SetHordeInfo(info);
 }
 
+// World snapshots received from the server, kept to decode later snapshots
+// that are deltas against them.
+static const size_t WORLD_SNAPSHOT_HISTORY = 32;
+static WorldSnapshot worldSnapshots[WORLD_SNAPSHOT_HISTORY];
+static size_t worldSnapshotNext = 0;
+static WorldSnapshot worldSnapshotApplied;
+static bool worldSnapshotsReset = true;
+
+static void CL_ClearWorldSnapshots()
+{
+	for (WorldSnapshot& snap : worldSnapshots)
+		snap.clear();
+	worldSnapshotNext = 0;
+	worldSnapshotApplied.clear();
+	worldSnapshotsReset = true;
+}
+
+/**
+ * @brief Apply one actor's state from a world snapshot, exactly as if the
+ *        server had sent every field in an svc_updatemobj.
+ */
+static void CL_ApplyWorldSnapshotEntry(const WorldSnapshot::Entry& entry)
+{
+	odaproto::svc::UpdateMobj update;
+	update.set_flags(baseline_t::POSX | baseline_t::POSY | baseline_t::POSZ |
+	                 baseline_t::ANGLE | baseline_t::MOVEDIR | baseline_t::MOVECOUNT |
+	                 baseline_t::RNDINDEX | baseline_t::TARGET | baseline_t::TRACER |
+	                 baseline_t::MOMX | baseline_t::MOMY | baseline_t::MOMZ);
+
+	odaproto::Actor* act = update.mutable_actor();
+	act->set_netid(entry.netid);
+	act->mutable_pos()->set_x(entry.state.pos.x);
+	act->mutable_pos()->set_y(entry.state.pos.y);
+	act->mutable_pos()->set_z(entry.state.pos.z);
+	act->set_angle(entry.state.angle);
+	act->set_movedir(entry.state.movedir);
+	act->set_movecount(entry.state.movecount);
+	act->set_rndindex(entry.state.rndindex);
+	act->set_targetid(entry.state.targetid);
+	act->set_tracerid(entry.state.tracerid);
+	act->mutable_mom()->set_x(entry.state.mom.x);
+	act->mutable_mom()->set_y(entry.state.mom.y);
+	act->mutable_mom()->set_z(entry.state.mom.z);
+
+	CL_UpdateMobj(&update);
+}
+
+static void CL_WorldSnapshot(const odaproto::svc::WorldSnapshot* msg)
+{
+	static const WorldSnapshot empty;
+	const WorldSnapshot* base = &empty;
+
+	if (msg->base_tic() != 0)
+	{
+		// Anything but a fresh snapshot right after a map load is a leftover
+		// from the previous map.
+		if (worldSnapshotsReset)
+			return;
+
+		base = NULL;
+		for (const WorldSnapshot& snap : worldSnapshots)
+		{
+			if (snap.tic == msg->base_tic())
+			{
+				base = &snap;
+				break;
+			}
+		}
+
+		if (base == NULL)
+		{
+			DPrintFmt("World snapshot {} has unknown base {}.\n", msg->tic(),
+			          msg->base_tic());
+			return;
+		}
+	}
+
+	static WorldSnapshot decoded;
+	if (!SVC_DecodeWorldSnapshot(*msg, *base, decoded))
+	{
+		DPrintFmt("World snapshot {} is malformed.\n", msg->tic());
+		return;
+	}
+
+	worldSnapshots[worldSnapshotNext] = decoded;
+	worldSnapshotNext = (worldSnapshotNext + 1) % WORLD_SNAPSHOT_HISTORY;
+	worldSnapshotsReset = false;
+
+	// A snapshot that arrived late is still useful as a delta base, but the
+	// world has already moved past it.
+	if (decoded.tic < worldSnapshotApplied.tic)
+		return;
+
+	// Only touch actors whose state differs from what we last applied.
+	// Snapshots against an empty base refresh everything, which corrects
+	// any drift in actors the server considers unchanged.
+	auto last = worldSnapshotApplied.actors.begin();
+	for (const WorldSnapshot::Entry& entry : decoded.actors)
+	{
+		while (last != worldSnapshotApplied.actors.end() && last->netid < entry.netid)
+			++last;
+
+		if (msg->base_tic() == 0 || last == worldSnapshotApplied.actors.end() ||
+		    last->netid != entry.netid || last->state != entry.state)
+		{
+			CL_ApplyWorldSnapshotEntry(entry);
+		}
+	}
+
+	worldSnapshotApplied = decoded;
+}
+
 static void CL_NetdemoCap(const odaproto::svc::NetdemoCap* msg)
 {
 	player_t* clientPlayer = &consoleplayer();
@@ -3111,6 +3226,7 @@ parseError_e CL_ParseCommand()
 		SV_MSG(svc_maplist_index, CL_MaplistIndex, odaproto::svc::MaplistIndex);
 		SV_MSG(svc_toast, CL_Toast, odaproto::svc::Toast);
 		SV_MSG(svc_hordeinfo, CL_HordeInfo, odaproto::svc::HordeInfo);
+		SV_MSG(svc_worldsnapshot, CL_WorldSnapshot, odaproto::svc::WorldSnapshot);
 		SV_MSG(svc_netdemocap, CL_NetdemoCap, odaproto::svc::NetdemoCap);
 		SV_MSG(svc_netdemostop, CL_NetDemoStop, odaproto::svc::NetDemoStop);
 		SV_MSG(svc_netdemoloadsnap, CL_NetDemoLoadSnap, odaproto::svc::NetDemoLoadSnap);
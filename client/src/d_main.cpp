@@ -76,6 +76,8 @@
 #include "r_sky.h"
 #include "d_main.h"
 #include "d_dehacked.h"
+#include "cl_benchmark.h"
+#include "cl_demotest.h"
 #include "cl_download.h"
 #include "gi.h"
 #include "stats.h"
@@ -101,6 +103,7 @@ extern bool gameisdead;
 extern bool M_DemoNoPlay;	// [RH] if true, then skip any demos in the loop
 extern DThinker ThinkerCap;
 extern dyncolormap_t NormalLight;
+void STACK_ARGS call_terms();
 
 bool devparm;				// started game with -devparm
 const char *D_DrawIcon;			// [RH] Patch name of icon to draw on next refresh
@@ -222,7 +225,8 @@ void D_DisplayTicker()
 //
 void D_Display()
 {
-	if (nodrawers || I_IsHeadless())
+	// headless clients only draw when a benchmark wants the frames timed
+	if (nodrawers || (I_IsHeadless() && !CL_BenchmarkActive()))
 		return; 				// for comparative timing / profiling
 
 	BEGIN_STAT(D_Display);
@@ -230,6 +234,8 @@ void D_Display()
 	// video mode must be changed before surfaces are locked in I_BeginUpdate
 	V_AdjustVideoMode();
 
+	CL_BenchmarkBeginFrame();
+
 	I_BeginUpdate();
 
 	// [RH] Allow temporarily disabling wipes
@@ -272,7 +278,11 @@ void D_Display()
 			ST_Drawer();
 
 			if (I_GetEmulatedSurface())
+			{
+				CL_BenchmarkClock(BENCH_BLIT);
 				I_BlitEmulatedSurface();
+				CL_BenchmarkUnclock(BENCH_BLIT);
+			}
 
 			if (AM_ClassicAutomapVisible() || AM_OverlayAutomapVisible())
 				AM_Drawer();
@@ -334,7 +344,12 @@ void D_Display()
 	C_DrawConsole();	// draw console
 	C_DisplayTicker(); // Display console tic
 	M_Drawer();			// menu is drawn even on top of everything
+
+	CL_BenchmarkClock(BENCH_BLIT);
 	I_FinishUpdate();	// page flip or blit buffer
+	CL_BenchmarkUnclock(BENCH_BLIT);
+
+	CL_BenchmarkEndFrame();
 
 	END_STAT(D_Display);
 }
@@ -825,6 +840,14 @@ void D_DoomMain()
 
 	C_ExecCmdLineParams(true, false);	// [RH] do all +set commands on the command line
 
+	// play a whole list of demos in +demotest child processes and quit
+	if (const char* demolist = Args.CheckValue("-demolist"))
+	{
+		const bool passed = CL_RunDemoList(demolist);
+		call_terms();
+		exit(passed ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
 	std::string iwad;
 	std::vector<std::string> pwads;
 	const char* iwadParam = Args.CheckValue("-iwad");
@@ -838,6 +861,7 @@ void D_DoomMain()
 		const char* skipParams[] = {
 		    "+connect", "+demotest", "+map",      "+netplay",  "+playdemo",
 		    "-connect", "-file",     "-playdemo", "-timedemo", "-warp",
+		    "-benchmark",
 		};
 
 		bool shouldSkip = std::any_of(std::begin(skipParams), std::end(skipParams), [](const auto& param){ return ::Args.CheckValue(param); });
@@ -1035,6 +1059,12 @@ void D_DoomMain()
 		G_TimeDemo(Args.GetArg(p + 1));
 	}
 
+	// time every frame of a demo, possibly at several resolutions and
+	// r_optimize settings in a row
+	p = Args.CheckParm("-benchmark");
+	if (p && p < Args.NumArgs() - 1)
+		CL_BenchmarkStart(Args.GetArg(p + 1));
+
 	// denis - this will run a demo and quit
 	p = Args.CheckParm("+demotest");
 	if (p && p < Args.NumArgs() - 1)
@@ -63,8 +63,8 @@ extern IWindowSurface* scaled_screenblocks_surface;
 //
 
 extern "C" {
-drawcolumn_t dcol;
-drawspan_t dspan;
+thread_local drawcolumn_t dcol;
+thread_local drawspan_t dspan;
 }
 
 byte*			viewimage;
@@ -94,6 +94,9 @@ void (*R_FillSpan)(void);
 void (*R_FillTranslucentSpan)(void);
 
 // Possibly vectorized functions:
+void (*R_DrawColumnD)(void);
+void (*R_DrawTranslucentColumnD)(void);
+void (*R_DrawTlatedLucentColumnD)(void);
 void (*R_DrawSpanD)(void);
 void (*R_DrawSlopeSpanD)(void);
 void (*r_dimpatchD)(IWindowSurface* surface, argb_t color, int alpha, int x1, int y1, int w, int h);
@@ -124,6 +127,16 @@ public:
 		pos = (pos + 3) % FuzzTable::size;
 	}
 
+	int getPosition() const
+	{
+		return pos;
+	}
+
+	void setPosition(int newpos)
+	{
+		pos = newpos;
+	}
+
 	forceinline int getValue() const
 	{
 		// [SL] quickly convert the table value (-1 or 1) into (-pitch or pitch).
@@ -151,7 +164,38 @@ constexpr int FuzzTable::table[FuzzTable::size] = {
 	   -1, 1, 1,-1, 1, 1,-1, 1 };
 
 
-static FuzzTable fuzztable;
+static thread_local FuzzTable fuzztable;
+
+//
+// R_GetFuzzPosition / R_SetFuzzPosition
+//
+// Lets a frame be rendered twice with the same fuzz pattern.
+//
+int R_GetFuzzPosition()
+{
+	return fuzztable.getPosition();
+}
+
+void R_SetFuzzPosition(int pos)
+{
+	fuzztable.setPosition(pos);
+}
+
+//
+// R_SkipFuzzColumn
+//
+// Steps the fuzz position past the column described by dcol exactly as
+// R_DrawFuzzColumn would, without drawing it.
+//
+void R_SkipFuzzColumn()
+{
+	const int yl = MAX(dcol.yl, 1);
+	const int yh = MIN(dcol.yh, viewheight - 2);
+
+	for (int y = yl; y <= yh; y++)
+		fuzztable.incrementRow();
+	fuzztable.incrementColumn();
+}
 
 // ============================================================================
 //
@@ -1474,7 +1518,7 @@ void R_FillColumnD()
 // Renders a column to the 32bpp ARGB8888 screen buffer from the source buffer
 // dcol.source and scaled by dcol.iscale. Shading is performed using dcol.colormap.
 //
-void R_DrawColumnD()
+void R_DrawColumnD_c()
 {
 	R_DrawColumnGeneric<argb_t, DirectColormapFunc>(FB_COLDEST_D, dcol);
 }
@@ -1506,7 +1550,7 @@ void R_DrawFuzzColumnD()
 // translucency is controlled by dcol.translevel. Shading is performed using
 // dcol.colormap.
 //
-void R_DrawTranslucentColumnD()
+void R_DrawTranslucentColumnD_c()
 {
 	R_DrawColumnGeneric<argb_t, DirectTranslucentColormapFunc>(FB_COLDEST_D, dcol);
 }
@@ -1532,7 +1576,7 @@ void R_DrawTranslatedColumnD()
 // translucency is controlled by dcol.translevel. Shading is performed using
 // dcol.colormap.
 //
-void R_DrawTlatedLucentColumnD()
+void R_DrawTlatedLucentColumnD_c()
 {
 	R_DrawColumnGeneric<argb_t, DirectTranslatedTranslucentColormapFunc>(FB_COLDEST_D, dcol);
 }
@@ -1550,6 +1594,323 @@ void R_DrawSkyForegroundColumnD()
 	R_DrawColumnGeneric<argb_t, DirectSkyForegroundColormapFunc>(FB_COLDEST_D, dcol);
 }
 
+// ----------------------------------------------------------------------------
+//
+// 32bpp column batching
+//
+// With r_columnbatch enabled, R_RenderColumnRange queues the columns it
+// would otherwise draw one at a time and draws groups of four adjacent
+// columns together, a row at a time. The four destination pixels of a row
+// are contiguous, which is much kinder to the cache than walking four
+// separate columns at the pitch of the surface. The rows above and below
+// the span shared by all four columns are drawn a column at a time.
+//
+// Each column is still textured and shaded by exactly the same steps as
+// R_DrawColumnGeneric, in the same top-to-bottom order, so the output is
+// identical to drawing the columns one by one.
+//
+// ----------------------------------------------------------------------------
+
+EXTERN_CVAR(r_columnbatch)
+
+enum columnbatchkind_t
+{
+	BATCH_NONE,
+	BATCH_COLORMAP,
+	BATCH_TRANSLUCENT,
+	BATCH_TRANSLATED,
+	BATCH_TLATEDLUCENT,
+	BATCH_SKYFOREGROUND
+};
+
+static constexpr int BATCH_WIDTH = 4;
+static constexpr int BATCH_MAXSPANS = 8;		// posts queued per column
+
+struct batchslot_t
+{
+	int				count;
+	drawcolumn_t	spans[BATCH_MAXSPANS];
+};
+
+// per thread, since deferred columns are batched by each render slice
+static thread_local batchslot_t batchslots[BATCH_WIDTH];
+static thread_local int batchnumslots;
+static thread_local int batchnumspans;
+static thread_local columnbatchkind_t batchkind = BATCH_NONE;
+static int batchmode = -1;
+
+//
+// BatchColumnState
+//
+// Texture stepping of a single column, split out of R_DrawColumnGeneric so
+// that several columns can be advanced in lockstep.
+//
+class BatchColumnState
+{
+public:
+	BatchColumnState(const drawcolumn_t& drawcolumn) :
+		source(drawcolumn.source), frac(drawcolumn.texturefrac),
+		fracstep(drawcolumn.iscale), texheight(drawcolumn.textureheight),
+		mask((drawcolumn.textureheight >> FRACBITS) - 1),
+		pow2(!(drawcolumn.textureheight & (drawcolumn.textureheight - 1)))
+	{
+		// [SL] Properly tile textures whose heights are not a power-of-2
+		if (!pow2)
+		{
+			if (frac < 0)
+				while ((frac += texheight) < 0);
+			else
+				while (frac >= texheight)
+					frac -= texheight;
+		}
+	}
+
+	forceinline byte texel() const
+	{
+		return pow2 ? source[(frac >> FRACBITS) & mask] : source[frac >> FRACBITS];
+	}
+
+	forceinline void advance()
+	{
+		frac += fracstep;
+		if (!pow2 && frac >= texheight)
+			frac -= texheight;
+	}
+
+private:
+	const palindex_t*	source;
+	fixed_t				frac;
+	const fixed_t		fracstep;
+	const fixed_t		texheight;
+	const int			mask;
+	const bool			pow2;
+};
+
+//
+// R_DrawColumnQuad
+//
+// Draws four adjacent columns, each with a single span. Returns false
+// without drawing anything if the spans share no rows.
+//
+template<typename COLORFUNC>
+static bool R_DrawColumnQuad(const drawcolumn_t* cols[BATCH_WIDTH])
+{
+	int top = cols[0]->yl, bottom = cols[0]->yh;
+	for (int i = 1; i < BATCH_WIDTH; i++)
+	{
+		top = MAX(top, cols[i]->yl);
+		bottom = MIN(bottom, cols[i]->yh);
+	}
+
+	if (top > bottom)
+		return false;
+
+	const int pitch = cols[0]->pitch_in_pixels;
+	argb_t* const base = (argb_t*)cols[0]->destination + cols[0]->x;
+
+	BatchColumnState state0(*cols[0]), state1(*cols[1]), state2(*cols[2]), state3(*cols[3]);
+	BatchColumnState* states[BATCH_WIDTH] = { &state0, &state1, &state2, &state3 };
+
+	COLORFUNC func0(*cols[0]), func1(*cols[1]), func2(*cols[2]), func3(*cols[3]);
+	COLORFUNC* funcs[BATCH_WIDTH] = { &func0, &func1, &func2, &func3 };
+
+	// the rows of each column above the shared span
+	for (int i = 0; i < BATCH_WIDTH; i++)
+	{
+		argb_t* dest = base + cols[i]->yl * pitch + i;
+		for (int y = cols[i]->yl; y < top; y++, dest += pitch)
+		{
+			(*funcs[i])(states[i]->texel(), dest);
+			states[i]->advance();
+		}
+	}
+
+	// the shared span, four pixels per row
+	argb_t* dest = base + top * pitch;
+	for (int y = top; y <= bottom; y++, dest += pitch)
+	{
+		func0(state0.texel(), dest + 0);
+		func1(state1.texel(), dest + 1);
+		func2(state2.texel(), dest + 2);
+		func3(state3.texel(), dest + 3);
+		state0.advance();
+		state1.advance();
+		state2.advance();
+		state3.advance();
+	}
+
+	// the rows of each column below the shared span
+	for (int i = 0; i < BATCH_WIDTH; i++)
+	{
+		argb_t* dest = base + (bottom + 1) * pitch + i;
+		for (int y = bottom + 1; y <= cols[i]->yh; y++, dest += pitch)
+		{
+			(*funcs[i])(states[i]->texel(), dest);
+			states[i]->advance();
+		}
+	}
+
+	return true;
+}
+
+//
+// R_DrawColumnBatch
+//
+template<typename COLORFUNC>
+static void R_DrawColumnBatch()
+{
+	bool quad = batchnumslots == BATCH_WIDTH;
+	for (int i = 0; i < batchnumslots; i++)
+		quad = quad && batchslots[i].count == 1;
+
+	if (quad)
+	{
+		const drawcolumn_t* cols[BATCH_WIDTH];
+		for (int i = 0; i < BATCH_WIDTH; i++)
+			cols[i] = &batchslots[i].spans[0];
+
+		if (R_DrawColumnQuad<COLORFUNC>(cols))
+			return;
+	}
+
+	for (int i = 0; i < batchnumslots; i++)
+	{
+		for (int j = 0; j < batchslots[i].count; j++)
+		{
+			const drawcolumn_t& col = batchslots[i].spans[j];
+			argb_t* dest = (argb_t*)col.destination + col.yl * col.pitch_in_pixels + col.x;
+			R_DrawColumnGeneric<argb_t, COLORFUNC>(dest, col);
+		}
+	}
+}
+
+//
+// R_FlushColumnBatch
+//
+static void R_FlushColumnBatch()
+{
+	if (batchnumslots == 0)
+		return;
+
+	switch (batchkind)
+	{
+	case BATCH_COLORMAP:
+		R_DrawColumnBatch<DirectColormapFunc>();
+		break;
+	case BATCH_TRANSLUCENT:
+		R_DrawColumnBatch<DirectTranslucentColormapFunc>();
+		break;
+	case BATCH_TRANSLATED:
+		R_DrawColumnBatch<DirectTranslatedColormapFunc>();
+		break;
+	case BATCH_TLATEDLUCENT:
+		R_DrawColumnBatch<DirectTranslatedTranslucentColormapFunc>();
+		break;
+	case BATCH_SKYFOREGROUND:
+		R_DrawColumnBatch<DirectSkyForegroundColormapFunc>();
+		break;
+	case BATCH_NONE:
+	default:
+		break;
+	}
+
+	batchnumslots = 0;
+	batchnumspans = 0;
+}
+
+//
+// R_SetColumnBatchMode
+//
+// Overrides r_columnbatch: 0 never batches, 1 always batches and -1 goes
+// back to following the cvar.
+//
+void R_SetColumnBatchMode(int mode)
+{
+	batchmode = mode;
+}
+
+//
+// R_BeginColumnBatch
+//
+// Starts queueing columns for the given column drawer. Returns false if
+// batching is disabled or the drawer cannot be batched, in which case the
+// caller should keep calling the drawer directly.
+//
+bool R_BeginColumnBatch(void (*drawfunc)())
+{
+	const bool enabled = batchmode == -1 ? r_columnbatch.asInt() != 0 : batchmode != 0;
+	if (!enabled)
+		return false;
+
+	// Only the 32bpp drawers are batched. The fuzz drawer reads the rows it
+	// has just written and the fill drawers are trivial, so neither is
+	// worth queueing.
+	if (drawfunc == R_DrawColumnD)
+		batchkind = BATCH_COLORMAP;
+	else if (drawfunc == R_DrawTranslucentColumnD)
+		batchkind = BATCH_TRANSLUCENT;
+	else if (drawfunc == R_DrawTranslatedColumnD)
+		batchkind = BATCH_TRANSLATED;
+	else if (drawfunc == R_DrawTlatedLucentColumnD)
+		batchkind = BATCH_TLATEDLUCENT;
+	else if (drawfunc == R_DrawSkyForegroundColumnD)
+		batchkind = BATCH_SKYFOREGROUND;
+	else
+		return false;
+
+	batchnumslots = 0;
+	batchnumspans = 0;
+	return true;
+}
+
+//
+// R_BatchColumn
+//
+// Queues the column described by dcol. Stands in for colfunc between
+// R_BeginColumnBatch and R_EndColumnBatch. The caller must keep dcol.source
+// valid until the column has been drawn, which is no later than the
+// COLUMNBATCH_MAXQUEUED-th span queued after it.
+//
+void R_BatchColumn()
+{
+	bool queued = false;
+
+	if (batchnumslots > 0)
+	{
+		batchslot_t& last = batchslots[batchnumslots - 1];
+		if (last.spans[0].x == dcol.x && last.count < BATCH_MAXSPANS)
+		{
+			last.spans[last.count++] = dcol;
+			queued = true;
+		}
+		else if (batchnumslots == BATCH_WIDTH || last.spans[0].x + 1 != dcol.x)
+		{
+			R_FlushColumnBatch();
+		}
+	}
+
+	if (!queued)
+	{
+		batchslot_t& slot = batchslots[batchnumslots++];
+		slot.spans[0] = dcol;
+		slot.count = 1;
+	}
+
+	if (++batchnumspans >= COLUMNBATCH_MAXQUEUED)
+		R_FlushColumnBatch();
+}
+
+//
+// R_EndColumnBatch
+//
+// Draws any columns still queued.
+//
+void R_EndColumnBatch()
+{
+	R_FlushColumnBatch();
+	batchkind = BATCH_NONE;
+}
+
 // ----------------------------------------------------------------------------
 //
 // 32bpp color span drawing wrappers
@@ -1742,7 +2103,8 @@ enum r_optimize_kind {
 	OPTIMIZE_NONE,
 	OPTIMIZE_SSE2,
 	OPTIMIZE_MMX,
-	OPTIMIZE_ALTIVEC
+	OPTIMIZE_ALTIVEC,
+	OPTIMIZE_AVX2
 };
 
 static r_optimize_kind optimize_kind = OPTIMIZE_NONE;
@@ -1755,6 +2117,7 @@ static const char *get_optimization_name(r_optimize_kind kind)
 		case OPTIMIZE_SSE2:    return "sse2";
 		case OPTIMIZE_MMX:     return "mmx";
 		case OPTIMIZE_ALTIVEC: return "altivec";
+		case OPTIMIZE_AVX2:    return "avx2";
 		case OPTIMIZE_NONE:
 		default:
 			return "none";
@@ -1801,6 +2164,10 @@ static bool detect_optimizations()
 	if (SDL_HasSSE2())
 		optimizations_available.push_back(OPTIMIZE_SSE2);
 	#endif
+	#if defined(NOVADOOM_AVX2) && defined(__SSE2__) && !defined(SDL12)
+	if (SDL_HasAVX2())
+		optimizations_available.push_back(OPTIMIZE_AVX2);
+	#endif
 	#ifdef __ALTIVEC__
 	if (SDL_HasAltiVec())
 		optimizations_available.push_back(OPTIMIZE_ALTIVEC);
@@ -1839,6 +2206,8 @@ CVAR_FUNC_IMPL(r_optimize)
 		optimize_kind = OPTIMIZE_MMX;
 	else if (stricmp(val, "altivec") == 0 && R_IsOptimizationAvailable(OPTIMIZE_ALTIVEC))
 		optimize_kind = OPTIMIZE_ALTIVEC;
+	else if (stricmp(val, "avx2") == 0 && R_IsOptimizationAvailable(OPTIMIZE_AVX2))
+		optimize_kind = OPTIMIZE_AVX2;
 	else if (stricmp(val, "detect") == 0)
 		// Default to the most preferred:
 		optimize_kind = optimizations_available.back();
@@ -1876,15 +2245,31 @@ CVAR_FUNC_IMPL(r_optimize)
 //
 void R_InitVectorizedDrawers()
 {
+	// [SL] set defaults to non-vectorized drawers
+	R_DrawColumnD			= R_DrawColumnD_c;
+	R_DrawTranslucentColumnD = R_DrawTranslucentColumnD_c;
+	R_DrawTlatedLucentColumnD = R_DrawTlatedLucentColumnD_c;
+
 	if (optimize_kind == OPTIMIZE_NONE)
 	{
-		// [SL] set defaults to non-vectorized drawers
 		R_DrawSpanD				= R_DrawSpanD_c;
 		R_DrawSlopeSpanD		= R_DrawSlopeSpanD_c;
 		r_dimpatchD             = r_dimpatchD_c;
 	}
+	#if defined(NOVADOOM_AVX2) && defined(__SSE2__)
+	else if (optimize_kind == OPTIMIZE_AVX2)
+	{
+		R_DrawColumnD			= R_DrawColumnD_AVX2;
+		R_DrawTranslucentColumnD = R_DrawTranslucentColumnD_AVX2;
+		R_DrawTlatedLucentColumnD = R_DrawTlatedLucentColumnD_AVX2;
+		R_DrawSpanD				= R_DrawSpanD_AVX2;
+		// AVX2 implies SSE2; the sloped span and dimming drawers are shared
+		R_DrawSlopeSpanD		= R_DrawSlopeSpanD_SSE2;
+		r_dimpatchD             = r_dimpatchD_SSE2;
+	}
+	#endif
 	#ifdef __SSE2__
-	if (optimize_kind == OPTIMIZE_SSE2)
+	else if (optimize_kind == OPTIMIZE_SSE2)
 	{
 		R_DrawSpanD				= R_DrawSpanD_SSE2;
 		R_DrawSlopeSpanD		= R_DrawSlopeSpanD_SSE2;
@@ -1909,6 +2294,9 @@ void R_InitVectorizedDrawers()
 	#endif
 
 	// Check that all pointers are definitely assigned!
+	assert(R_DrawColumnD != NULL);
+	assert(R_DrawTranslucentColumnD != NULL);
+	assert(R_DrawTlatedLucentColumnD != NULL);
 	assert(R_DrawSpanD != NULL);
 	assert(R_DrawSlopeSpanD != NULL);
 	assert(r_dimpatchD != NULL);
@@ -0,0 +1,381 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	AVX2 column and span drawers for 32-bit rendering.
+//	Only the functions marked AVX2_TARGET are compiled with AVX2 code
+//	generation, so that inline functions from the headers are not, and
+//	none of them may be called unless SDL_HasAVX2() says so.
+//
+//-----------------------------------------------------------------------------
+
+
+#include "novadoom.h"
+
+#ifdef NOVADOOM_AVX2
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#define AVX2_ALIGNED(x) _CRT_ALIGN(32) x
+#define AVX2_TARGET
+#else
+#define AVX2_ALIGNED(x) x __attribute__((aligned(32)))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#include "r_defs.h"
+#include "r_draw.h"
+#include "r_state.h"
+#include "v_video.h"
+
+// ----------------------------------------------------------------------------
+//
+// AVX2 color remapping functors
+//
+// Each functor maps a source texel to its palette index (texel), shades a
+// single pixel for the unvectorized head and tail of a column (operator()
+// taking a byte), and shades eight pixels at once from eight palette indices
+// and the eight destination pixels beneath them (operator() taking vectors).
+// All of them produce exactly the same pixels as the C functors in r_draw.cpp.
+//
+// ----------------------------------------------------------------------------
+
+//
+// R_GatherShades
+//
+// Looks up eight palette indices in a shademap with a single gather.
+//
+static forceinline AVX2_TARGET __m256i R_GatherShades(const argb_t* shademap, __m256i indices)
+{
+	return _mm256_i32gather_epi32((const int*)shademap, indices, 4);
+}
+
+//
+// R_BlendAVX2
+//
+// Vector equivalent of alphablend2a(bg, bga, fg, fga) for eight pixels.
+//
+static forceinline AVX2_TARGET __m256i R_BlendAVX2(__m256i bg, __m256i vbga, __m256i fg, __m256i vfga, __m256i alphamask)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	const __m256i bglo = _mm256_unpacklo_epi8(bg, zero);
+	const __m256i bghi = _mm256_unpackhi_epi8(bg, zero);
+	const __m256i fglo = _mm256_unpacklo_epi8(fg, zero);
+	const __m256i fghi = _mm256_unpackhi_epi8(fg, zero);
+
+	// (bg * bga + fg * fga) >> 8 never exceeds 16 bits since bga + fga == 255
+	const __m256i lo = _mm256_srli_epi16(_mm256_add_epi16(
+			_mm256_mullo_epi16(bglo, vbga), _mm256_mullo_epi16(fglo, vfga)), 8);
+	const __m256i hi = _mm256_srli_epi16(_mm256_add_epi16(
+			_mm256_mullo_epi16(bghi, vbga), _mm256_mullo_epi16(fghi, vfga)), 8);
+
+	// alphablend2a always produces an opaque pixel
+	return _mm256_or_si256(_mm256_packus_epi16(lo, hi), alphamask);
+}
+
+class AVX2ColormapFunc
+{
+public:
+	static const bool readsdest = false;
+
+	AVX2_TARGET AVX2ColormapFunc(const drawcolumn_t& drawcolumn) :
+			colormap(drawcolumn.colormap), shademap(drawcolumn.colormap.m_shademap) { }
+
+	forceinline AVX2_TARGET byte texel(byte c) const
+	{
+		return c;
+	}
+
+	forceinline AVX2_TARGET void operator()(byte c, argb_t* dest) const
+	{
+		*dest = colormap.shade(c);
+	}
+
+	forceinline AVX2_TARGET __m256i operator()(__m256i indices, __m256i bg) const
+	{
+		return R_GatherShades(shademap, indices);
+	}
+
+private:
+	const shaderef_t& colormap;
+	const argb_t* shademap;
+};
+
+class AVX2TranslucentColormapFunc
+{
+public:
+	static const bool readsdest = true;
+
+	AVX2_TARGET AVX2TranslucentColormapFunc(const drawcolumn_t& drawcolumn) :
+			colormap(drawcolumn.colormap), shademap(drawcolumn.colormap.m_shademap)
+	{
+		fga = (drawcolumn.translevel & ~0x03FF) >> 8;
+		fga = fga > 255 ? 255 : fga;
+		bga = 255 - fga;
+
+		vfga = _mm256_set1_epi16(fga);
+		vbga = _mm256_set1_epi16(bga);
+		alphamask = _mm256_set1_epi32(argb_t(255, 0, 0, 0));
+	}
+
+	forceinline AVX2_TARGET byte texel(byte c) const
+	{
+		return c;
+	}
+
+	forceinline AVX2_TARGET void operator()(byte c, argb_t* dest) const
+	{
+		*dest = alphablend2a(*dest, bga, colormap.shade(c), fga);
+	}
+
+	forceinline AVX2_TARGET __m256i operator()(__m256i indices, __m256i bg) const
+	{
+		return R_BlendAVX2(bg, vbga, R_GatherShades(shademap, indices), vfga, alphamask);
+	}
+
+private:
+	const shaderef_t& colormap;
+	const argb_t* shademap;
+	int fga, bga;
+	__m256i vfga, vbga, alphamask;
+};
+
+class AVX2TranslatedTranslucentColormapFunc
+{
+public:
+	static const bool readsdest = true;
+
+	AVX2_TARGET AVX2TranslatedTranslucentColormapFunc(const drawcolumn_t& drawcolumn) :
+			lucentfunc(drawcolumn), table(drawcolumn.translation.getTable()) { }
+
+	forceinline AVX2_TARGET byte texel(byte c) const
+	{
+		return table[c];
+	}
+
+	forceinline AVX2_TARGET void operator()(byte c, argb_t* dest) const
+	{
+		lucentfunc(table[c], dest);
+	}
+
+	forceinline AVX2_TARGET __m256i operator()(__m256i indices, __m256i bg) const
+	{
+		return lucentfunc(indices, bg);
+	}
+
+private:
+	AVX2TranslucentColormapFunc lucentfunc;
+	const byte* table;
+};
+
+
+//
+// R_DrawColumnAVX2Generic
+//
+// AVX2 counterpart of R_DrawColumnGeneric. Eight rows are textured, shaded
+// and (if needed) blended per iteration. Palette indices are read from the
+// column one at a time because a 32-bit gather could read past the end of
+// the column data; the shademap lookups and destination reads are gathers.
+// Non-power-of-2 textures wrap on every row and are drawn one pixel at a time.
+//
+template<typename COLORFUNC>
+static forceinline AVX2_TARGET void R_DrawColumnAVX2Generic(argb_t* dest, const drawcolumn_t& drawcolumn)
+{
+#ifdef RANGECHECK
+	if (drawcolumn.x < 0 || drawcolumn.x >= viewwidth || drawcolumn.yl < 0 || drawcolumn.yh >= viewheight)
+	{
+		PrintFmt(PRINT_HIGH, "R_DrawColumn: {} to {} at {}\n", drawcolumn.yl, drawcolumn.yh, drawcolumn.x);
+		return;
+	}
+#endif
+
+	const palindex_t* source = drawcolumn.source;
+	const int pitch = drawcolumn.pitch_in_pixels;
+	int count = drawcolumn.yh - drawcolumn.yl + 1;
+	if (count <= 0)
+		return;
+
+	const fixed_t fracstep = drawcolumn.iscale;
+	fixed_t frac = drawcolumn.texturefrac;
+
+	const int texheight = drawcolumn.textureheight;
+	const int mask = (texheight >> FRACBITS) - 1;
+
+	COLORFUNC colorfunc(drawcolumn);
+
+	if (texheight & (texheight - 1))
+	{
+		// texture height is NOT a power-of-2
+		if (frac < 0)
+			while ((frac += texheight) < 0);
+		else
+			while (frac >= texheight)
+				frac -= texheight;
+
+		while (count--)
+		{
+			colorfunc(source[frac >> FRACBITS], dest);
+			dest += pitch;
+			if ((frac += fracstep) >= texheight)
+				frac -= texheight;
+		}
+		return;
+	}
+
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i fracsteps = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(fracstep));
+	const __m256i rowoffsets = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(pitch));
+	const __m256i vmask = _mm256_set1_epi32(mask);
+
+	AVX2_ALIGNED(int spots[8]);
+	AVX2_ALIGNED(argb_t colors[8]);
+
+	while (count >= 8)
+	{
+		// spot[i] = ((frac + fracstep * i) >> FRACBITS) & mask
+		const __m256i fracs = _mm256_add_epi32(_mm256_set1_epi32(frac), fracsteps);
+		_mm256_store_si256((__m256i*)spots,
+				_mm256_and_si256(_mm256_srai_epi32(fracs, FRACBITS), vmask));
+
+		const __m256i indices = _mm256_setr_epi32(
+				colorfunc.texel(source[spots[0]]), colorfunc.texel(source[spots[1]]),
+				colorfunc.texel(source[spots[2]]), colorfunc.texel(source[spots[3]]),
+				colorfunc.texel(source[spots[4]]), colorfunc.texel(source[spots[5]]),
+				colorfunc.texel(source[spots[6]]), colorfunc.texel(source[spots[7]]));
+
+		__m256i bg = _mm256_setzero_si256();
+		if (COLORFUNC::readsdest)
+			bg = _mm256_i32gather_epi32((const int*)dest, rowoffsets, 4);
+
+		_mm256_store_si256((__m256i*)colors, colorfunc(indices, bg));
+
+		for (int i = 0; i < 8; i++, dest += pitch)
+			*dest = colors[i];
+
+		frac += fracstep * 8;
+		count -= 8;
+	}
+
+	while (count--)
+	{
+		colorfunc(source[(frac >> FRACBITS) & mask], dest);
+		dest += pitch;
+		frac += fracstep;
+	}
+}
+
+#define FB_COLDEST_D ((argb_t*)dcol.destination + dcol.yl * dcol.pitch_in_pixels + dcol.x)
+
+AVX2_TARGET void R_DrawColumnD_AVX2()
+{
+	R_DrawColumnAVX2Generic<AVX2ColormapFunc>(FB_COLDEST_D, dcol);
+}
+
+AVX2_TARGET void R_DrawTranslucentColumnD_AVX2()
+{
+	R_DrawColumnAVX2Generic<AVX2TranslucentColormapFunc>(FB_COLDEST_D, dcol);
+}
+
+AVX2_TARGET void R_DrawTlatedLucentColumnD_AVX2()
+{
+	R_DrawColumnAVX2Generic<AVX2TranslatedTranslucentColormapFunc>(FB_COLDEST_D, dcol);
+}
+
+
+//
+// R_DrawSpanD_AVX2
+//
+// Same as R_DrawSpanD_SSE2 (see the notes there on the u/v layout) but eight
+// pixels wide, with the shademap lookups done by a gather and unaligned
+// stores into the span.
+//
+AVX2_TARGET void R_DrawSpanD_AVX2()
+{
+#ifdef RANGECHECK
+	if (dspan.x2 < dspan.x1 || dspan.x1 < 0 || dspan.x2 >= viewwidth ||
+		dspan.y >= viewheight || dspan.y < 0)
+	{
+		PrintFmt(PRINT_HIGH, "R_DrawLevelSpan: {} to {} at {}", dspan.x1, dspan.x2, dspan.y);
+		return;
+	}
+#endif
+
+	int count = dspan.x2 - dspan.x1 + 1;
+
+	dsfixed_t ufrac = dspan.yfrac;
+	dsfixed_t vfrac = dspan.xfrac;
+	const dsfixed_t ustep = dspan.ystep;
+	const dsfixed_t vstep = dspan.xstep;
+
+	const byte* source = dspan.source;
+	argb_t* dest = (argb_t*)dspan.destination + dspan.y * dspan.pitch_in_pixels + dspan.x1;
+
+	const shaderef_t& colormap = dspan.colormap;
+	const argb_t* shademap = colormap.m_shademap;
+
+	const int texture_width_bits = 6, texture_height_bits = 6;
+
+	const unsigned int umask = ((1 << texture_width_bits) - 1) << texture_height_bits;
+	const unsigned int vmask = (1 << texture_height_bits) - 1;
+	const int ushift = FRACBITS - texture_height_bits + 10;
+	const int vshift = FRACBITS + 10;
+
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i mustep = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(ustep));
+	const __m256i mvstep = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(vstep));
+	const __m256i mumask = _mm256_set1_epi32(umask);
+	const __m256i mvmask = _mm256_set1_epi32(vmask);
+
+	AVX2_ALIGNED(unsigned int spots[8]);
+
+	while (count >= 8)
+	{
+		const __m256i mufrac = _mm256_add_epi32(_mm256_set1_epi32(ufrac), mustep);
+		const __m256i mvfrac = _mm256_add_epi32(_mm256_set1_epi32(vfrac), mvstep);
+
+		const __m256i u = _mm256_and_si256(_mm256_srli_epi32(mufrac, ushift), mumask);
+		const __m256i v = _mm256_and_si256(_mm256_srli_epi32(mvfrac, vshift), mvmask);
+		_mm256_store_si256((__m256i*)spots, _mm256_or_si256(u, v));
+
+		const __m256i indices = _mm256_setr_epi32(
+				source[spots[0]], source[spots[1]], source[spots[2]], source[spots[3]],
+				source[spots[4]], source[spots[5]], source[spots[6]], source[spots[7]]);
+
+		_mm256_storeu_si256((__m256i*)dest, R_GatherShades(shademap, indices));
+
+		dest += 8;
+		ufrac += ustep * 8;
+		vfrac += vstep * 8;
+		count -= 8;
+	}
+
+	while (count--)
+	{
+		const unsigned int spot = ((ufrac >> ushift) & umask) | ((vfrac >> vshift) & vmask);
+		*dest++ = colormap.shade(source[spot]);
+		ufrac += ustep;
+		vfrac += vstep;
+	}
+}
+
+
+VERSION_CONTROL (r_drawt_avx2_cpp, "$Id$")
+
+#endif
@@ -29,12 +29,14 @@
 
 #include <stdlib.h>
 #include <math.h>
+#include "m_argv.h"
 #include "m_random.h"
 #include "p_local.h"
 #include "gi.h"
 #include "r_local.h"
 #include "r_sky.h"
 #include "r_interp.h"
+#include "r_thread.h"
 #include "st_stuff.h"
 #include "v_video.h"
 #include "stats.h"
@@ -42,7 +44,9 @@
 #include "i_video.h"
 #include "m_vectors.h"
 #include "am_map.h"
+#include "cl_benchmark.h"
 #include "cl_demo.h"
+#include "c_dispatch.h"
 
 extern NetDemo netdemo;
 
@@ -74,7 +78,7 @@ float			focratio;
 float			ifocratio;
 
 // [RH] colormap currently drawing with
-shaderef_t		basecolormap;
+thread_local shaderef_t basecolormap;
 int				fixedlightlev;
 shaderef_t		fixedcolormap;
 
@@ -981,6 +985,137 @@ void R_SetSkyForegroundDrawFuncs()
 	}
 }
 
+//
+// R_RenderScene
+//
+// Clips and draws the world as seen from the current view.
+//
+static void R_RenderScene(player_t* player)
+{
+	// Clear buffers.
+	R_ClearClipSegs();
+	R_ClearDrawSegs();
+	R_ClearOpenings();
+	R_ClearPlanes(true);
+	R_ClearSprites();
+
+	R_ResetDrawFuncs();
+
+    // [Russell] - From zdoom 1.22 source, added camera pointer check
+	// Never draw the player unless in chasecam mode
+	// the wall columns are queued during the walk and drawn by the render
+	// threads at the end (see R_DrawDeferredPass)
+	CL_BenchmarkClock(BENCH_BSP);
+	R_BeginDeferredPass();
+	if (camera && camera->player && !(player->cheats & CF_CHASECAM))
+	{
+		int flags2_backup = camera->flags2;
+		camera->flags2 |= MF2_DONTDRAW;
+		R_RenderBSPNode(numnodes - 1);
+		camera->flags2 = flags2_backup;
+	}
+	else
+		R_RenderBSPNode(numnodes - 1);	// The head node is the last node output.
+	R_DrawDeferredPass();
+	CL_BenchmarkUnclock(BENCH_BSP);
+
+	CL_BenchmarkClock(BENCH_PLANES);
+	R_DrawPlanes();
+	R_DrawSkyBoxes();
+	CL_BenchmarkUnclock(BENCH_PLANES);
+
+	R_DrawMasked();
+}
+
+// set by r_columnbatchtest to check the next frame
+static bool columnbatchtest = false;
+
+// frames compared with -columnbatchtest, and how many of those differed
+static int columnbatchtestframes = 0;
+static int columnbatchtestfailures = 0;
+
+//
+// R_TestColumnBatch
+//
+// Renders the scene without and then with column batching, starting from
+// the same view window contents, and returns the number of pixels that
+// differ, or -1 if the surface cannot be batched.
+//
+static int R_TestColumnBatch(player_t* player, IWindowSurface* surface)
+{
+	if (surface->getBitsPerPixel() != 32)
+	{
+		R_RenderScene(player);
+		return -1;
+	}
+
+	const int pitch = surface->getPitchInPixels();
+	argb_t* view = (argb_t*)surface->getBuffer() + viewwindowy * pitch + viewwindowx;
+
+	std::vector<argb_t> before(viewwidth * viewheight);
+	std::vector<argb_t> reference(viewwidth * viewheight);
+
+	for (int y = 0; y < viewheight; y++)
+		memcpy(&before[y * viewwidth], view + y * pitch, viewwidth * sizeof(argb_t));
+
+	const int fuzzpos = R_GetFuzzPosition();
+	const palindex_t color = dcol.color;
+
+	R_SetColumnBatchMode(0);
+	R_RenderScene(player);
+
+	for (int y = 0; y < viewheight; y++)
+	{
+		memcpy(&reference[y * viewwidth], view + y * pitch, viewwidth * sizeof(argb_t));
+		memcpy(view + y * pitch, &before[y * viewwidth], viewwidth * sizeof(argb_t));
+	}
+
+	R_SetFuzzPosition(fuzzpos);
+	dcol.color = color;
+
+	R_SetColumnBatchMode(1);
+	R_RenderScene(player);
+	R_SetColumnBatchMode(-1);
+
+	int diffs = 0;
+	for (int y = 0; y < viewheight; y++)
+		for (int x = 0; x < viewwidth; x++)
+			if (view[y * pitch + x] != reference[y * viewwidth + x])
+				diffs++;
+
+	return diffs;
+}
+
+//
+// R_ColumnBatchTestPassed
+//
+// Reports the frames checked by -columnbatchtest, which compares every
+// frame drawn with and without column batching. Returns false if any of
+// them differed or none could be checked.
+//
+bool R_ColumnBatchTestPassed()
+{
+	if (!Args.CheckParm("-columnbatchtest"))
+		return true;
+
+	if (columnbatchtestframes == 0)
+	{
+		PrintFmt(PRINT_WARNING, "columnbatchtest: no frames checked, a 32-bit video mode is needed\n");
+		return false;
+	}
+
+	PrintFmt(columnbatchtestfailures ? PRINT_WARNING : PRINT_HIGH,
+	         "columnbatchtest: {} of {} frames differ with column batching\n",
+	         columnbatchtestfailures, columnbatchtestframes);
+	return columnbatchtestfailures == 0;
+}
+
+BEGIN_COMMAND(r_columnbatchtest)
+{
+	columnbatchtest = true;
+}
+END_COMMAND(r_columnbatchtest)
+
 //
 // R_RenderPlayerView
 //
@@ -1001,15 +1136,6 @@ void R_RenderPlayerView(player_t* player)
 
 	R_SetupFrame(player);
 
-	// Clear buffers.
-	R_ClearClipSegs();
-	R_ClearDrawSegs();
-	R_ClearOpenings();
-	R_ClearPlanes(true);
-	R_ClearSprites();
-
-	R_ResetDrawFuncs();
-
 	IWindowSurface* surface = R_GetRenderingSurface();
 
 	// [SL] fill the screen with a blinking solid color to make HOM more visible
@@ -1027,21 +1153,37 @@ void R_RenderPlayerView(player_t* player)
 	// [RH] Setup particles for this frame
 	R_FindParticleSubsectors();
 
-    // [Russell] - From zdoom 1.22 source, added camera pointer check
-	// Never draw the player unless in chasecam mode
-	if (camera && camera->player && !(player->cheats & CF_CHASECAM))
+	static const bool everyframe = Args.CheckParm("-columnbatchtest") != 0;
+
+	if (everyframe)
 	{
-		int flags2_backup = camera->flags2;
-		camera->flags2 |= MF2_DONTDRAW;
-		R_RenderBSPNode(numnodes - 1);
-		camera->flags2 = flags2_backup;
+		const int diffs = R_TestColumnBatch(player, surface);
+		if (diffs >= 0)
+			columnbatchtestframes++;
+		if (diffs > 0)
+		{
+			columnbatchtestfailures++;
+			PrintFmt(PRINT_WARNING, "columnbatchtest: {} of {} pixels differ at gametic {}\n",
+			         diffs, viewwidth * viewheight, gametic);
+		}
+	}
+	else if (columnbatchtest)
+	{
+		const int diffs = R_TestColumnBatch(player, surface);
+		if (diffs < 0)
+			PrintFmt(PRINT_HIGH, "r_columnbatchtest: column batching needs a 32-bit video mode\n");
+		else if (diffs == 0)
+			PrintFmt(PRINT_HIGH, "r_columnbatchtest: {}x{} view is identical with column batching\n",
+			         viewwidth, viewheight);
+		else
+			PrintFmt(PRINT_WARNING, "r_columnbatchtest: {} of {} pixels differ with column batching\n",
+			         diffs, viewwidth * viewheight);
+		columnbatchtest = false;
 	}
 	else
-		R_RenderBSPNode(numnodes - 1);	// The head node is the last node output.
-
-	R_DrawPlanes();
-	R_DrawSkyBoxes();
-	R_DrawMasked();
+	{
+		R_RenderScene(player);
+	}
 
 	// NOTE(jsd): Full-screen status color blending:
 	int blend_alpha = int(blend_color.geta() * 255.0f);
@@ -51,6 +51,7 @@
 #include "v_video.h"
 
 #include "m_vectors.h"
+#include "r_thread.h"
 
 planefunction_t 		floorfunc;
 planefunction_t 		ceilingfunc;
@@ -101,19 +102,50 @@ extern float xfoc, yfoc;
 extern float focratio, ifocratio;
 extern Pool<int> sprclip_pool;
 
-int*					planezlight;
-float					plight, shade;
+// the per-plane state below is set up by every thread drawing the plane
+thread_local int*		planezlight;
+thread_local float		plight, shade;
 
 fixed_t 				*yslope;
-static fixed_t			planeheight;
+static thread_local fixed_t	planeheight;
 
-static fixed_t			pl_xscale, pl_yscale;
-static fixed_t			pl_viewsin, pl_viewcos;
-static fixed_t			pl_viewxtrans, pl_viewytrans;
-static fixed_t			pl_xstepscale, pl_ystepscale;
+static thread_local fixed_t	pl_xscale, pl_yscale;
+static thread_local fixed_t	pl_viewsin, pl_viewcos;
+static thread_local fixed_t	pl_viewxtrans, pl_viewytrans;
+static thread_local fixed_t	pl_xstepscale, pl_ystepscale;
 
-v3float_t				a, b, c;
-float					ixscale, iyscale;
+thread_local v3float_t	a, b, c;
+thread_local float		ixscale, iyscale;
+
+//
+// Parallel plane drawing
+//
+// With r_threads above 1, R_DrawPlanes hands the flats to the render
+// threads.  Every thread walks all of the planes but only draws the rows
+// it owns.  Visplanes never overlap and each row is drawn by exactly one
+// thread with the same span setup as the serial path, so the output is
+// identical.  Sky planes are drawn serially beforehand.  Walls and sprites
+// are split by column instead (see R_DrawDeferredPass).
+//
+struct planejob_t
+{
+	visplane_t*		plane;
+	byte*			source;
+	palindex_t		color;
+};
+
+static std::vector<planejob_t> planejobs;
+
+// which slice owns each row of the view, in blocks of a few rows
+static std::vector<byte> planerowslice;
+static const int PLANE_ROW_BLOCK = 4;
+
+// the slice this thread is drawing, or -1 to draw every row
+static thread_local int planeslice = -1;
+
+// span destination shared by all slices
+static byte* planedest;
+static int planepitch;
 
 //
 // R_InitPlanes
@@ -443,7 +475,14 @@ visplane_t* R_CheckPlane(visplane_t* pl, int start, int stop)
 //
 // R_MakeSpans
 //
-void R_MakeSpans(visplane_t *pl, void(*spanfunc)(int, int, int))
+template <bool sliced>
+static forceinline bool R_OwnsPlaneRow(unsigned int y)
+{
+	return !sliced || planerowslice[y] == planeslice;
+}
+
+template <bool sliced>
+static void R_MakeSpansGeneric(visplane_t *pl, void(*spanfunc)(int, int, int))
 {
 	for (int x = pl->minx; x <= pl->maxx + 1; x++)
 	{
@@ -452,17 +491,30 @@ void R_MakeSpans(visplane_t *pl, void(*spanfunc)(int, int, int))
 		unsigned int t2 = pl->top[x];
 		unsigned int b2 = pl->bottom[x];
 
+		// spanstart is shared, but each row is only touched by its owner
 		for (; t1 < t2 && t1 <= b1; t1++)
-			spanfunc(t1, spanstart[t1], x-1);
+			if (R_OwnsPlaneRow<sliced>(t1))
+				spanfunc(t1, spanstart[t1], x-1);
 		for (; b1 > b2 && b1 >= t1; b1--)
-			spanfunc(b1, spanstart[b1], x-1);
-		while (t2 < t1 && t2 <= b2)
-			spanstart[t2++] = x;
-		while (b2 > b1 && b2 >= t2)
-			spanstart[b2--] = x;
+			if (R_OwnsPlaneRow<sliced>(b1))
+				spanfunc(b1, spanstart[b1], x-1);
+		for (; t2 < t1 && t2 <= b2; t2++)
+			if (R_OwnsPlaneRow<sliced>(t2))
+				spanstart[t2] = x;
+		for (; b2 > b1 && b2 >= t2; b2--)
+			if (R_OwnsPlaneRow<sliced>(b2))
+				spanstart[b2] = x;
 	}
 }
 
+void R_MakeSpans(visplane_t *pl, void(*spanfunc)(int, int, int))
+{
+	if (planeslice < 0)
+		R_MakeSpansGeneric<false>(pl, spanfunc);
+	else
+		R_MakeSpansGeneric<true>(pl, spanfunc);
+}
+
 //
 // R_DrawSlopedPlane
 //
@@ -629,6 +681,151 @@ void R_DrawLevelPlane(visplane_t *pl)
 }
 
 
+//
+// R_CacheFlat
+//
+// Returns the pixels of a flat for drawing, warping it first if desired.
+// The caller changes the tag of the result to PU_CACHE when done with it.
+//
+static byte* R_CacheFlat(int useflatnum)
+{
+	byte* source = (byte *)W_CacheLumpNum (firstflat + useflatnum, PU_STATIC);
+
+	// [RH] warp a flat if desired
+	if (flatwarp[useflatnum])
+	{
+		if (warpedflats[useflatnum] && flatwarpedwhen[useflatnum] == level.time)
+		{
+			Z_ChangeTag(source, PU_CACHE);
+			source = warpedflats[useflatnum];
+			Z_ChangeTag(source, PU_STATIC);
+		}
+		else
+		{
+			if (!warpedflats[useflatnum])
+				warpedflats[useflatnum] = (byte*)Z_Malloc(64*64, PU_STATIC, &warpedflats[useflatnum]);
+
+			static byte buffer[64];
+			int timebase = level.time*23;
+
+			flatwarpedwhen[useflatnum] = level.time;
+			byte *warped = warpedflats[useflatnum];
+
+			for (int x = 63; x >= 0; x--)
+			{
+				int yt, yf = (finesine[(timebase + ((x+17) << 7))&FINEMASK]>>13) & 63;
+				byte *src = source + x;
+				byte *dest = warped + x;
+				for (yt = 64; yt; yt--, yf = (yf+1)&63, dest += 64)
+					*dest = *(src + (yf << 6));
+			}
+			timebase = level.time*32;
+			for (int y = 63; y >= 0; y--)
+			{
+				int xt, xf = (finesine[(timebase + (y << 7))&FINEMASK]>>13) & 63;
+				byte *src = warped + (y << 6);
+				byte *dest = buffer;
+				for (xt = 64; xt; xt--, xf = (xf+1) & 63)
+					*dest++ = *(src+xf);
+				memcpy (warped + (y << 6), buffer, 64);
+			}
+			Z_ChangeTag (source, PU_CACHE);
+			source = warped;
+		}
+	}
+
+	return source;
+}
+
+//
+// R_DrawFlatPlane
+//
+static void R_DrawFlatPlane(visplane_t *pl)
+{
+	if (P_IsPlaneLevel(&pl->secplane))
+		R_DrawLevelPlane(pl);
+	else
+		R_DrawSlopedPlane(pl);
+}
+
+//
+// R_DrawPlaneSlice
+//
+// Draws the rows of every queued flat that belong to one render slice.
+//
+static void R_DrawPlaneSlice(int slice, int numslices)
+{
+	planeslice = slice;
+
+	dspan.destination = planedest;
+	dspan.pitch_in_pixels = planepitch;
+
+	for (const planejob_t& job : planejobs)
+	{
+		dspan.source = job.source;
+		dspan.color = job.color;
+		R_DrawFlatPlane(job.plane);
+	}
+
+	planeslice = -1;
+}
+
+//
+// R_DrawPlanesParallel
+//
+static void R_DrawPlanesParallel(int numslices)
+{
+	planejobs.clear();
+
+	for (int i = 0; i < MAXVISPLANES; i++)
+	{
+		for (visplane_t *pl = visplanes[i]; pl; pl = pl->next)
+		{
+			if (pl->minx > pl->maxx)
+				continue;
+
+			// sky flat
+			if (R_IsSkyFlat(pl->picnum) || pl->picnum & PL_SKYFLAT)
+			{
+				R_RenderSkyRange(pl);
+				continue;
+			}
+
+			// regular flat
+			int useflatnum = flattranslation[pl->picnum < numflats ? pl->picnum : 0];
+
+			dspan.color += 4;	// [RH] color if r_drawflat is 1
+
+			planejob_t job;
+			job.plane = pl;
+			job.source = R_CacheFlat(useflatnum);
+			job.color = dspan.color;
+			planejobs.push_back(job);
+
+			pl->top[pl->maxx+1] = viewheight;
+			pl->top[pl->minx-1] = viewheight;
+		}
+	}
+
+	if (planejobs.empty())
+		return;
+
+	planerowslice.resize(viewheight);
+	for (int y = 0; y < viewheight; y++)
+		planerowslice[y] = (y / PLANE_ROW_BLOCK) % numslices;
+
+	planedest = dspan.destination;
+	planepitch = dspan.pitch_in_pixels;
+
+	R_RunRenderSlices(R_DrawPlaneSlice, numslices);
+
+	for (const planejob_t& job : planejobs)
+		Z_ChangeTag (job.source, PU_CACHE);
+
+	// leave the calling thread's span state as the serial path would
+	dspan.source = planejobs.back().source;
+}
+
 //
 // R_DrawPlanes
 //
@@ -638,12 +835,18 @@ void R_DrawPlanes (void)
 {
 	visplane_t *pl;
 	int i;
-	int vpcount;
 
 	R_ResetDrawFuncs();
 
 	dspan.color = 3;
 
+	const int numslices = R_RenderSliceCount();
+	if (numslices > 1)
+	{
+		R_DrawPlanesParallel(numslices);
+		return;
+	}
+
 	for (i = 0; i < MAXVISPLANES; i++)
 	{
 		for (pl = visplanes[i]; pl; pl = pl->next)
@@ -662,58 +865,12 @@ void R_DrawPlanes (void)
 				int useflatnum = flattranslation[pl->picnum < numflats ? pl->picnum : 0];
 
 				dspan.color += 4;	// [RH] color if r_drawflat is 1
-				dspan.source = (byte *)W_CacheLumpNum (firstflat + useflatnum, PU_STATIC);
-
-				// [RH] warp a flat if desired
-				if (flatwarp[useflatnum])
-				{
-					if (warpedflats[useflatnum] && flatwarpedwhen[useflatnum] == level.time)
-					{
-						Z_ChangeTag(dspan.source, PU_CACHE);
-						dspan.source = warpedflats[useflatnum];
-						Z_ChangeTag(dspan.source, PU_STATIC);
-					}
-					else
-					{
-						if (!warpedflats[useflatnum])
-							warpedflats[useflatnum] = (byte*)Z_Malloc(64*64, PU_STATIC, &warpedflats[useflatnum]);
-
-						static byte buffer[64];
-						int timebase = level.time*23;
-
-						flatwarpedwhen[useflatnum] = level.time;
-						byte *warped = warpedflats[useflatnum];
-
-						for (int x = 63; x >= 0; x--)
-						{
-							int yt, yf = (finesine[(timebase + ((x+17) << 7))&FINEMASK]>>13) & 63;
-							byte *source = dspan.source + x;
-							byte *dest = warped + x;
-							for (yt = 64; yt; yt--, yf = (yf+1)&63, dest += 64)
-								*dest = *(source + (yf << 6));
-						}
-						timebase = level.time*32;
-						for (int y = 63; y >= 0; y--)
-						{
-							int xt, xf = (finesine[(timebase + (y << 7))&FINEMASK]>>13) & 63;
-							byte *source = warped + (y << 6);
-							byte *dest = buffer;
-							for (xt = 64; xt; xt--, xf = (xf+1) & 63)
-								*dest++ = *(source+xf);
-							memcpy (warped + (y << 6), buffer, 64);
-						}
-						Z_ChangeTag (dspan.source, PU_CACHE);
-						dspan.source = warped;
-					}
-				}
+				dspan.source = R_CacheFlat(useflatnum);
 
 				pl->top[pl->maxx+1] = viewheight;
 				pl->top[pl->minx-1] = viewheight;
 
-				if (P_IsPlaneLevel(&pl->secplane))
-					R_DrawLevelPlane(pl);
-				else
-					R_DrawSlopedPlane(pl);
+				R_DrawFlatPlane(pl);
 
 				Z_ChangeTag (dspan.source, PU_CACHE);
 			}
@@ -816,7 +973,9 @@ void R_DrawSkyBoxes()
 		firstvissprite = vissprite_p;
 		firstdrawseg = ds_p++;
 
+		R_BeginDeferredPass();
 		R_RenderBSPNode(numnodes - 1);
+		R_DrawDeferredPass();
 		R_DrawPlanes();
 		R_DrawMasked();
 
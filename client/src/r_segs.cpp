@@ -35,6 +35,7 @@
 #include "p_local.h"
 #include "r_local.h"
 #include "r_sky.h"
+#include "r_thread.h"
 #include "v_video.h"
 
 #include "m_vectors.h"
@@ -255,8 +256,15 @@ static inline void R_BlastSolidSegColumn(void (*drawfunc)())
 
 		int destpostlen = 0;
 
-		static byte* destpostraw[512];
-		tallpost_t* destpost = (tallpost_t*) destpostraw;
+		// Rotate between several buffers: with r_columnbatch a column is
+		// only drawn after up to COLUMNBATCH_MAXQUEUED more have been set up.
+		// Deferred columns are drawn after the whole pass, so they need
+		// their own copy.
+		static byte* destpostraw[COLUMNBATCH_MAXQUEUED + 1][512];
+		static unsigned int destpostnext = 0;
+		tallpost_t* destpost = (tallpost_t*) R_DeferredScratch(count + 2 * sizeof(tallpost_t));
+		if (destpost == NULL)
+			destpost = (tallpost_t*) destpostraw[destpostnext++ % (COLUMNBATCH_MAXQUEUED + 1)];
 
 		destpost->topdelta = 0;
 
@@ -368,6 +376,17 @@ void R_RenderColumnRange(int start, int stop, int* top, int* bottom,
 	if (start > stop)
 		return;
 
+	// queue the columns for the render threads, or draw them in groups if
+	// possible; the blasters call colfunc, which is pointed at the queue
+	// for the duration
+	void (*const drawfunc)() = colfunc;
+	const bool deferred = R_BeginColumnDeferral(drawfunc);
+	const bool batched = !deferred && R_BeginColumnBatch(drawfunc);
+	if (deferred)
+		colfunc = R_DeferColumn;
+	else if (batched)
+		colfunc = R_BatchColumn;
+
 	if (calc_light)
 	{
 		if (fixedlightlev)
@@ -443,6 +462,10 @@ void R_RenderColumnRange(int start, int stop, int* top, int* bottom,
 			}
 		}
 	}
+
+	if (batched)
+		R_EndColumnBatch();
+	colfunc = drawfunc;
 }
 
 //
@@ -36,6 +36,7 @@
 
 #include "r_local.h"
 #include "r_interp.h"
+#include "r_thread.h"
 #include "p_local.h"
 
 #include "c_console.h"
@@ -46,6 +47,7 @@
 #include "s_sound.h"
 
 #include "m_vectors.h"
+#include "cl_benchmark.h"
 
 extern fixed_t FocalLengthX, FocalLengthY;
 
@@ -1087,12 +1089,18 @@ void R_DrawMasked (void)
 {
 	drawseg_t		 *ds;
 
+	// sprites, masked mid textures and psprites are queued and drawn by
+	// the render threads at the end (see R_DrawDeferredPass)
+	R_BeginDeferredPass();
+
+	CL_BenchmarkClock(BENCH_SPRITES);
 	R_SortVisSprites ();
 
 	for (int i = vsprcount; i > 0; i--)
 	{
 		R_DrawSprite(spritesorter[i-1]);
 	}
+	CL_BenchmarkUnclock(BENCH_SPRITES);
 
 	// render any remaining masked mid textures
 
@@ -1102,12 +1110,17 @@ void R_DrawMasked (void)
 
 	//		for (ds=ds_p-1 ; ds >= drawsegs ; ds--)    old buggy code
 
+	CL_BenchmarkClock(BENCH_MASKED);
 	for (ds=ds_p ; ds-- > firstdrawseg ; )	// new -- killough
 		if (ds->midposts)
 			R_RenderMaskedSegRange(ds, ds->x1, ds->x2);
+	CL_BenchmarkUnclock(BENCH_MASKED);
 
 	// draw the psprites on top of everything
+	CL_BenchmarkClock(BENCH_SPRITES);
 	R_DrawPlayerSprites();
+	R_DrawDeferredPass();
+	CL_BenchmarkUnclock(BENCH_SPRITES);
 }
 
 void R_InitParticles (void)
@@ -1252,7 +1265,10 @@ void R_DrawParticle(vissprite_t* vis)
 	dspan.color = vis->startfrac;
 
 	for (dspan.y = y1; dspan.y <= y2; dspan.y++)
-		R_FillTranslucentSpan();
+	{
+		if (!R_DeferSpan(R_FillTranslucentSpan))
+			R_FillTranslucentSpan();
+	}
 }
 
 VERSION_CONTROL (r_things_cpp, "$Id$")
@@ -0,0 +1,431 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//   Worker threads for splitting parts of the software renderer into
+//   slices that are drawn in parallel.
+//
+//   The calling thread always draws slice 0 itself, so a pool of N slices
+//   keeps N - 1 workers parked on a condition variable between frames.
+//
+//   Floors and ceilings are split into rows (see R_DrawPlanes).  Walls,
+//   sprites and masked mid textures are split into vertical strips of the
+//   view: their columns are queued while the BSP walk or R_DrawMasked sets
+//   them up, and each strip's queue is drawn by one slice afterwards.
+//
+//-----------------------------------------------------------------------------
+
+#include "novadoom.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "r_local.h"
+#include "r_thread.h"
+
+EXTERN_CVAR(r_threads)
+
+// Upper bound on render slices, whatever r_threads asks for.
+static const int MAX_RENDER_SLICES = 32;
+
+class RenderThreadPool
+{
+  public:
+	RenderThreadPool() : m_func(NULL), m_numslices(0), m_generation(0), m_pending(0), m_quit(false)
+	{
+	}
+
+	~RenderThreadPool()
+	{
+		stop();
+	}
+
+	int size() const
+	{
+		return static_cast<int>(m_threads.size()) + 1;
+	}
+
+	void run(renderslicefunc_t func, int numslices)
+	{
+		if (numslices - 1 != static_cast<int>(m_threads.size()))
+		{
+			stop();
+			start(numslices - 1);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_func = func;
+			m_numslices = numslices;
+			m_pending = numslices - 1;
+			m_generation++;
+		}
+		m_start.notify_all();
+
+		func(0, numslices);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this] { return m_pending == 0; });
+	}
+
+  private:
+	void start(int count)
+	{
+		m_quit = false;
+		for (int i = 0; i < count; i++)
+			m_threads.emplace_back(&RenderThreadPool::worker, this, i + 1, m_generation);
+	}
+
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_start.notify_all();
+
+		for (std::thread& thread : m_threads)
+			thread.join();
+		m_threads.clear();
+	}
+
+	// seen is the generation at the time the worker was created, so a job
+	// posted before the thread gets scheduled is not missed
+	void worker(int slice, unsigned int seen)
+	{
+		for (;;)
+		{
+			renderslicefunc_t func;
+			int numslices;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_start.wait(lock, [&] { return m_quit || m_generation != seen; });
+				if (m_quit)
+					return;
+
+				seen = m_generation;
+				func = m_func;
+				numslices = m_numslices;
+			}
+
+			func(slice, numslices);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_pending == 0)
+				m_done.notify_one();
+		}
+	}
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_done;
+
+	renderslicefunc_t m_func;
+	int m_numslices;
+	unsigned int m_generation;
+	int m_pending;
+	bool m_quit;
+};
+
+static RenderThreadPool renderthreads;
+
+//
+// R_RenderSliceCount
+//
+// Returns how many slices the renderer should split parallel work into,
+// based on r_threads.  1 means everything is drawn on the calling thread.
+//
+int R_RenderSliceCount()
+{
+	int count = r_threads.asInt();
+	if (count <= 0)
+		count = static_cast<int>(std::thread::hardware_concurrency());
+
+	return clamp(count, 1, MAX_RENDER_SLICES);
+}
+
+//
+// R_RunRenderSlices
+//
+// Calls func once for every slice in [0, numslices), in parallel, and
+// returns when all of them have finished.  Slice 0 runs on the caller.
+//
+void R_RunRenderSlices(renderslicefunc_t func, int numslices)
+{
+	if (numslices <= 1)
+	{
+		func(0, 1);
+		return;
+	}
+
+	renderthreads.run(func, numslices);
+}
+
+// ============================================================================
+//
+// Deferred column drawing
+//
+// ============================================================================
+
+//
+// A column or particle span queued by R_DeferColumn or R_DeferSpan.  Spans
+// keep their colormap, translevel, color and destination in dcol.
+//
+struct deferredcolumn_t
+{
+	void			(*drawfunc)();
+	bool			span;
+	int				fuzzpos;
+	int				y;
+	int				x1;
+	int				x2;
+	drawcolumn_t	dcol;
+};
+
+static const size_t DEFERRED_SCRATCH_BLOCK = 256 * 1024;
+
+static bool deferring = false;
+static int defernumslices;
+static int deferslicestart[MAX_RENDER_SLICES + 1];
+static std::vector<deferredcolumn_t> deferqueues[MAX_RENDER_SLICES];
+static void (*deferfunc)();
+
+static std::vector<std::unique_ptr<byte[]> > deferscratch;
+static size_t deferscratchblock;
+static size_t deferscratchused;
+
+static drawcolumn_t deferdcol;
+static drawspan_t deferdspan;
+
+//
+// R_DeferredSlice
+//
+// Returns the slice whose strip of the view holds column x.
+//
+static inline int R_DeferredSlice(int x)
+{
+	return clamp(x, 0, viewwidth - 1) * defernumslices / viewwidth;
+}
+
+//
+// R_BeginDeferredPass
+//
+// Starts queueing the columns drawn through R_RenderColumnRange instead of
+// drawing them, if r_threads allows more than one slice.  Does nothing
+// when a pass is already being deferred.
+//
+void R_BeginDeferredPass()
+{
+	if (deferring)
+		return;
+
+	const int numslices = MIN(R_RenderSliceCount(), viewwidth);
+	if (numslices <= 1)
+		return;
+
+	defernumslices = numslices;
+	for (int i = 0; i <= numslices; i++)
+		deferslicestart[i] = (i * viewwidth + numslices - 1) / numslices;
+
+	deferscratchblock = 0;
+	deferscratchused = 0;
+	deferring = true;
+}
+
+//
+// R_DrawDeferredSlice
+//
+// Draws one strip's queue in the order it was filled.  Runs of columns for
+// the same drawer go through R_BeginColumnBatch as they would have when
+// drawn directly.
+//
+static void R_DrawDeferredSlice(int slice, int numslices)
+{
+	void (*batchfunc)() = NULL;
+	bool batched = false;
+
+	for (const deferredcolumn_t& entry : deferqueues[slice])
+	{
+		if (entry.span || entry.drawfunc != batchfunc)
+		{
+			if (batched)
+				R_EndColumnBatch();
+			batchfunc = entry.span ? NULL : entry.drawfunc;
+			batched = !entry.span && R_BeginColumnBatch(batchfunc);
+		}
+
+		if (entry.span)
+		{
+			dspan.destination = entry.dcol.destination;
+			dspan.pitch_in_pixels = entry.dcol.pitch_in_pixels;
+			dspan.colormap = entry.dcol.colormap;
+			dspan.translevel = entry.dcol.translevel;
+			dspan.color = entry.dcol.color;
+			dspan.y = entry.y;
+			dspan.x1 = entry.x1;
+			dspan.x2 = entry.x2;
+			entry.drawfunc();
+			continue;
+		}
+
+		dcol = entry.dcol;
+		if (batched)
+		{
+			R_BatchColumn();
+		}
+		else
+		{
+			R_SetFuzzPosition(entry.fuzzpos);
+			entry.drawfunc();
+		}
+	}
+
+	if (batched)
+		R_EndColumnBatch();
+}
+
+//
+// R_DrawDeferredPass
+//
+// Draws everything queued since R_BeginDeferredPass, one strip per slice,
+// and goes back to drawing columns directly.  The calling thread's dcol,
+// dspan and fuzz position are left as drawing the columns directly would
+// have left them.
+//
+void R_DrawDeferredPass()
+{
+	if (!deferring)
+		return;
+
+	deferring = false;
+
+	deferdcol = dcol;
+	deferdspan = dspan;
+	const int fuzzpos = R_GetFuzzPosition();
+
+	R_RunRenderSlices(R_DrawDeferredSlice, defernumslices);
+
+	dcol = deferdcol;
+	dspan = deferdspan;
+	R_SetFuzzPosition(fuzzpos);
+
+	for (int i = 0; i < defernumslices; i++)
+		deferqueues[i].clear();
+}
+
+//
+// R_BeginColumnDeferral
+//
+// Returns true if a pass is being deferred, in which case the caller
+// should call R_DeferColumn instead of drawfunc for each column.
+//
+bool R_BeginColumnDeferral(void (*drawfunc)())
+{
+	if (!deferring)
+		return false;
+
+	deferfunc = drawfunc;
+	return true;
+}
+
+//
+// R_DeferColumn
+//
+// Queues the column described by dcol.  Stands in for colfunc after
+// R_BeginColumnDeferral.  The fuzz position is stepped past the column
+// here so the next fuzz column starts where it would have.
+//
+void R_DeferColumn()
+{
+	deferredcolumn_t entry;
+	entry.drawfunc = deferfunc;
+	entry.span = false;
+	entry.fuzzpos = R_GetFuzzPosition();
+	entry.dcol = dcol;
+
+	if (deferfunc == R_DrawFuzzColumn)
+		R_SkipFuzzColumn();
+
+	deferqueues[R_DeferredSlice(dcol.x)].push_back(entry);
+}
+
+//
+// R_DeferSpan
+//
+// Queues the translucent fill span described by dspan, split between the
+// strips it crosses.  Returns false if no pass is being deferred, in which
+// case the caller should draw the span itself.
+//
+bool R_DeferSpan(void (*drawfunc)())
+{
+	if (!deferring)
+		return false;
+
+	deferredcolumn_t entry;
+	entry.drawfunc = drawfunc;
+	entry.span = true;
+	entry.fuzzpos = 0;
+	entry.y = dspan.y;
+	entry.dcol.destination = dspan.destination;
+	entry.dcol.pitch_in_pixels = dspan.pitch_in_pixels;
+	entry.dcol.colormap = dspan.colormap;
+	entry.dcol.translevel = dspan.translevel;
+	entry.dcol.color = dspan.color;
+
+	const int first = R_DeferredSlice(dspan.x1), last = R_DeferredSlice(dspan.x2);
+	for (int slice = first; slice <= last; slice++)
+	{
+		entry.x1 = MAX(dspan.x1, deferslicestart[slice]);
+		entry.x2 = MIN(dspan.x2, deferslicestart[slice + 1] - 1);
+		deferqueues[slice].push_back(entry);
+	}
+
+	return true;
+}
+
+//
+// R_DeferredScratch
+//
+// Returns memory that stays valid until the deferred pass has been drawn,
+// for column data built on the fly.  Returns NULL if no pass is being
+// deferred.
+//
+byte* R_DeferredScratch(size_t size)
+{
+	if (!deferring)
+		return NULL;
+
+	size = (size + 7) & ~size_t(7);
+	if (deferscratchused + size > DEFERRED_SCRATCH_BLOCK)
+	{
+		deferscratchblock++;
+		deferscratchused = 0;
+	}
+
+	if (deferscratchblock == deferscratch.size())
+		deferscratch.emplace_back(new byte[DEFERRED_SCRATCH_BLOCK]);
+
+	byte* mem = deferscratch[deferscratchblock].get() + deferscratchused;
+	deferscratchused += size;
+	return mem;
+}
+
+VERSION_CONTROL (r_thread_cpp, "$Id$")
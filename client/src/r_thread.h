@@ -0,0 +1,37 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//   Worker threads for splitting parts of the software renderer into
+//   slices that are drawn in parallel.
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+typedef void (*renderslicefunc_t)(int slice, int numslices);
+
+int R_RenderSliceCount();
+void R_RunRenderSlices(renderslicefunc_t func, int numslices);
+
+void R_BeginDeferredPass();
+void R_DrawDeferredPass();
+bool R_BeginColumnDeferral(void (*drawfunc)());
+void R_DeferColumn();
+bool R_DeferSpan(void (*drawfunc)());
+byte* R_DeferredScratch(size_t size);
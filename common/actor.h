@@ -351,6 +351,21 @@ struct baseline_t
 	{
 	}
 
+	bool operator==(const baseline_t& other) const
+	{
+		return pos.x == other.pos.x && pos.y == other.pos.y && pos.z == other.pos.z &&
+		       mom.x == other.mom.x && mom.y == other.mom.y && mom.z == other.mom.z &&
+		       angle == other.angle &&
+		       targetid == other.targetid && tracerid == other.tracerid &&
+		       movecount == other.movecount && movedir == other.movedir &&
+		       rndindex == other.rndindex;
+	}
+
+	bool operator!=(const baseline_t& other) const
+	{
+		return !(*this == other);
+	}
+
 	void Serialize(FArchive& arc)
 	{
 		if (arc.IsStoring())
@@ -606,11 +621,14 @@ public:
 	//
 	// ActorBlockMapListNode
 	//
-	// [SL] A container for the linked list nodes for all of the mapblocks that
-	// an actor can be standing in.  Vanilla Doom only considered an actor to
+	// [SL] A container for the positions of an actor in all of the mapblocks
+	// it can be standing in.  Vanilla Doom only considered an actor to
 	// be in the mapblock where its center was located, even if it was
 	// overlapping other blocks.
 	//
+	// Each mapblock keeps its actors in a packed array (see blocklinks_t);
+	// this records the slot the actor holds in each of those arrays.
+	//
 	class ActorBlockMapListNode
 	{
 	public:
@@ -618,6 +636,7 @@ public:
 		void Link();
 		void Unlink();
 		AActor* Next(int bmx, int bmy);
+		void Relocate(int bmx, int bmy, size_t newslot);
 
 	private:
 		void clear();
@@ -635,10 +654,9 @@ public:
 		int			blockcntx;
 		int			blockcnty;
 
-		// the next and previous actors in each of the possible blockmaps
+		// the index of this actor in each of the possible blockmaps
 		// this actor can inhabit
-		AActor		*next[BLOCKSX * BLOCKSY];
-		AActor		**prev[BLOCKSX * BLOCKSY];
+		size_t		slot[BLOCKSX * BLOCKSY];
 	};
 
 	// Interaction info, by BLOCKMAP.
@@ -34,6 +34,7 @@
 #include "m_alloc.h"
 
 #include "d_netinf.h"
+#include "hashtable.h"
 
 #include "i_system.h"
 
@@ -63,6 +64,45 @@ cvar_t* GetFirstCvar(void)
 	return ad.GetCVars();
 }
 
+// Hash table of cvars keyed on their lowercase names, so looking a cvar up by
+// name doesn't walk the whole cvar list.  When two cvars share a name, the one
+// registered last is the one indexed, matching the order of the cvar list.
+// The table is never freed, since cvars are still being destroyed during
+// static destruction.
+typedef OHashTable<std::string, cvar_t*> cvar_index_t;
+static cvar_index_t& CVarIndex()
+{
+	static cvar_index_t* _CVarIndex = new cvar_index_t(1024);
+	return *_CVarIndex;
+}
+
+static std::string CVarKey(std::string_view name)
+{
+	std::string key(name);
+	for (char& ch : key)
+		ch = tolower(static_cast<unsigned char>(ch));
+	return key;
+}
+
+//
+// cvar_t::Unlink
+//
+// Removes the cvar from the cvar list and from the name index.
+//
+void cvar_t::Unlink()
+{
+	cvar_t** link = &ad.GetCVars();
+	while (*link && *link != this)
+		link = &(*link)->m_Next;
+
+	if (*link)
+		*link = m_Next;
+
+	cvar_index_t::iterator it = CVarIndex().find(CVarKey(m_Name));
+	if (it != CVarIndex().end() && it->second == this)
+		CVarIndex().erase(it);
+}
+
 int cvar_defflags;
 
 cvar_t::cvar_t(const char* var_name, const char* def, const char* help, cvartype_t type,
@@ -80,8 +120,7 @@ cvar_t::cvar_t(const char* var_name, const char* def, const char* help, cvartype
 void cvar_t::InitSelf(const char* var_name, const char* def, const char* help, cvartype_t type,
 		DWORD var_flags, void (*callback)(cvar_t &), float minval, float maxval)
 {
-	cvar_t* dummy;
-	cvar_t* var = FindCVar(var_name, &dummy);
+	cvar_t* var = FindCVar(var_name ? var_name : "");
 
 	m_Callback = callback;
 	m_String = "";
@@ -113,6 +152,7 @@ void cvar_t::InitSelf(const char* var_name, const char* def, const char* help, c
 		m_Name = var_name;
 		m_Next = ad.GetCVars();
 		ad.GetCVars() = this;
+		CVarIndex()[CVarKey(m_Name)] = this;
 	}
 	else
 		m_Name = "";
@@ -134,19 +174,7 @@ void cvar_t::InitSelf(const char* var_name, const char* def, const char* help, c
 cvar_t::~cvar_t ()
 {
 	if (m_Name.length())
-	{
-		cvar_t *var, *dummy = NULL;
-
-		var = FindCVar (m_Name.c_str(), &dummy);
-
-		if (var == this)
-		{
-			if (dummy)
-				dummy->m_Next = m_Next;
-			else
-				ad.GetCVars() = m_Next;
-		}
-	}
+		Unlink();
 }
 
 void cvar_t::ForceSet(const char* valstr)
@@ -254,10 +282,10 @@ void cvar_t::RestoreDefault ()
 //
 void cvar_t::Transfer(const char *fromname, const char *toname)
 {
-	cvar_t *from, *to, *dummy;
+	cvar_t *from, *to;
 
-	from = FindCVar(fromname, &dummy);
-	to = FindCVar(toname, &dummy);
+	from = FindCVar(fromname);
+	to = FindCVar(toname);
 
 	if (from && to)
 	{
@@ -265,19 +293,15 @@ void cvar_t::Transfer(const char *fromname, const char *toname)
 		to->ForceSet(from->m_String.c_str());
 
 		// remove the old cvar
-		cvar_t *cur = ad.GetCVars();
-		while (cur->m_Next != from)
-			cur = cur->m_Next;
-
-		cur->m_Next = from->m_Next;
+		from->Unlink();
 	}
 }
 
 cvar_t *cvar_t::cvar_set (const char *var_name, const char *val)
 {
-	cvar_t *var, *dummy;
+	cvar_t *var;
 
-	if ( (var = FindCVar (var_name, &dummy)) )
+	if ( (var = FindCVar (var_name)) )
 		var->Set (val);
 
 	return var;
@@ -285,9 +309,9 @@ cvar_t *cvar_t::cvar_set (const char *var_name, const char *val)
 
 cvar_t *cvar_t::cvar_forceset (const char *var_name, const char *val)
 {
-	cvar_t *var, *dummy;
+	cvar_t *var;
 
-	if ( (var = FindCVar (var_name, &dummy)) )
+	if ( (var = FindCVar (var_name)) )
 		var->ForceSet (val);
 
 	return var;
@@ -501,23 +525,13 @@ void cvar_t::C_RestoreCVars (void)
 	UnlatchCVars();
 }
 
-cvar_t *cvar_t::FindCVar (std::string_view var_name, cvar_t **prev)
+cvar_t *cvar_t::FindCVar (std::string_view var_name)
 {
-	cvar_t *var;
-
 	if (var_name.empty())
 		return nullptr;
 
-	var = ad.GetCVars();
-	*prev = nullptr;
-	while (var)
-	{
-		if (iequals(var->m_Name, var_name))
-			break;
-		*prev = var;
-		var = var->m_Next;
-	}
-	return var;
+	cvar_index_t::const_iterator it = CVarIndex().find(CVarKey(var_name));
+	return it != CVarIndex().end() ? it->second : nullptr;
 }
 
 void cvar_t::UnlatchCVars (void)
@@ -650,9 +664,9 @@ BEGIN_COMMAND (set)
 	}
 	else
 	{
-		cvar_t *var, *prev;
+		cvar_t *var;
 
-		var = cvar_t::FindCVar (argv[1], &prev);
+		var = cvar_t::FindCVar (argv[1]);
 		if (!var)
 			var = new cvar_t(argv[1], NULL, "", CVARTYPE_NONE,  CVAR_AUTO | CVAR_UNSETTABLE | cvar_defflags);
 
@@ -698,7 +712,6 @@ END_COMMAND (set)
 
 BEGIN_COMMAND (get)
 {
-    cvar_t *prev;
 	cvar_t *var;
 
     if (argc < 2)
@@ -707,7 +720,7 @@ BEGIN_COMMAND (get)
         return;
 	}
 
-    var = cvar_t::FindCVar (argv[1], &prev);
+    var = cvar_t::FindCVar (argv[1]);
 
 	if (var)
 	{
@@ -734,7 +747,6 @@ END_COMMAND (get)
 
 BEGIN_COMMAND (toggle)
 {
-    cvar_t *prev;
 	cvar_t *var;
 
     if (argc < 2)
@@ -743,7 +755,7 @@ BEGIN_COMMAND (toggle)
         return;
 	}
 
-    var = cvar_t::FindCVar (argv[1], &prev);
+    var = cvar_t::FindCVar (argv[1]);
 
 	if (!var)
 	{
@@ -790,7 +802,6 @@ END_COMMAND (cvarlist)
 
 BEGIN_COMMAND (help)
 {
-    cvar_t *prev;
     cvar_t *var;
 
     if (argc < 2)
@@ -799,7 +810,7 @@ BEGIN_COMMAND (help)
         return;
     }
 
-    var = cvar_t::FindCVar (argv[1], &prev);
+    var = cvar_t::FindCVar (argv[1]);
 
     if (!var)
     {
@@ -183,7 +183,7 @@ public:
 	static void C_RestoreCVars (void);
 
 	// Finds a named cvar
-	static cvar_t *FindCVar (std::string_view var_name, cvar_t **prev);
+	static cvar_t *FindCVar (std::string_view var_name);
 
 	// Called from G_InitNew()
 	static void UnlatchCVars (void);
@@ -219,6 +219,7 @@ private:
 
 	void InitSelf(const char* name, const char* def, const char* help, cvartype_t,
 				DWORD flags, void (*callback)(cvar_t &), float minval = -FLT_MAX, float maxval = FLT_MAX);
+	void Unlink();
 
 	void (*m_Callback)(cvar_t &);
 	cvar_t *m_Next;
@@ -55,6 +55,36 @@ command_map_t &Commands()
 	return _Commands;
 }
 
+//
+// BuiltinCommand
+//
+// A command the engine runs by a fixed name.  Builtin commands are never
+// removed, so the lookup in the Commands map only has to be done once.
+//
+class BuiltinCommand
+{
+public:
+	explicit BuiltinCommand(const char* name) : m_Name(name), m_Command(NULL) { }
+
+	DConsoleCommand* get()
+	{
+		if (m_Command == NULL)
+		{
+			command_map_t::iterator it = Commands().find(m_Name);
+			if (it != Commands().end() && !it->second->IsAlias())
+				m_Command = it->second;
+		}
+		return m_Command;
+	}
+
+private:
+	const char* m_Name;
+	DConsoleCommand* m_Command;
+};
+
+static BuiltinCommand set_command("set");
+static BuiltinCommand get_command("get");
+
 struct ActionBits actionbits[NUM_ACTIONS] =
 {
 	{ 0x00409, ACTION_USE,				"use" },
@@ -277,16 +307,12 @@ void C_DoCommand(std::string_view cmd, uint32_t key)
 	else
 	{
 		// Check for any CVars that match the command
-		cvar_t *var, *dummy;
-
-		if ((var = cvar_t::FindCVar(argv[0], &dummy)))
+		if (cvar_t::FindCVar(argv[0]))
 		{
 			if (argc >= 2)
 			{
-				c = Commands().find("set");
-				if (c != Commands().end())
+				if ((com = set_command.get()))
 				{
-					com = c->second;
 					com->argc = argc + 1;
 					com->argv = argv.data() - 1; // Hack
 					com->m_Instigator = consoleplayer().mo;
@@ -297,10 +323,8 @@ void C_DoCommand(std::string_view cmd, uint32_t key)
 			}
 			else
 			{
-				c = Commands().find("get");
-				if (c != Commands().end())
+				if ((com = get_command.get()))
 				{
-					com = c->second;
 					com->argc = argc + 1;
 					com->argv = argv.data() - 1; // Hack
 					com->m_Instigator = consoleplayer().mo;
@@ -518,8 +542,8 @@ BEGIN_COMMAND (if)
 	if (argc < 4)
 		return;
 
-	cvar_t *var, *dummy;
-	var = cvar_t::FindCVar (argv[1], &dummy);
+	cvar_t *var;
+	var = cvar_t::FindCVar (argv[1]);
 
 	if (!var)
 	{
@@ -649,8 +673,7 @@ std::function<parse_string_result_t()> ParseString(std::string_view data, bool e
 		if (!result || result.token->empty() || result.token->at(0) != '$')
 			return result;
 
-		cvar_t *dummy;
-		if (const cvar_t* var = cvar_t::FindCVar(std::string_view(*result.token).substr(1), &dummy))
+		if (const cvar_t* var = cvar_t::FindCVar(std::string_view(*result.token).substr(1)))
 			return {std::optional(var->str()), result.rest};
 
 		return result;
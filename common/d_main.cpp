@@ -50,6 +50,7 @@
 #include "m_fileio.h"
 #include "c_console.h"
 #include "i_system.h"
+#include "i_net.h"
 #include "g_game.h"
 #include "g_spawninv.h"
 #include "r_main.h"
@@ -58,6 +59,7 @@
 #include "s_sound.h"
 #include "gi.h"
 #include "w_ident.h"
+#include "w_hashcache.h"
 #include "m_resfile.h"
 #include "odainfo.h"
 #include "infomap.h"
@@ -721,6 +723,17 @@ void D_LoadResourceFiles(const OWantFiles& newwadfiles, const OWantFiles& newpat
 	::missingfiles.clear();
 	::missingCommercialIWAD = false;
 
+	// Files that were named directly get hashed in parallel in the
+	// background while they are resolved one by one.
+	std::vector<std::string> direct_files;
+	for (const auto& wantfile : newwadfiles)
+		if (M_FileExists(wantfile.getWantedPath()))
+			direct_files.push_back(wantfile.getWantedPath());
+	for (const auto& wantfile : newpatchfiles)
+		if (M_FileExists(wantfile.getWantedPath()))
+			direct_files.push_back(wantfile.getWantedPath());
+	W_PrefetchFileHashes(direct_files);
+
 	// Resolve wanted wads.
 	OResFiles resolved_wads;
 	resolved_wads.reserve(newwadfiles.size());
@@ -1171,9 +1184,10 @@ void STACK_ARGS D_ClearTaskSchedulers()
 // TICRATE times a second. If the framerate is uncapped, the simulation function
 // will still be called TICRATE times a second but the display function will
 // be called as often as possible. After each iteration through the loop,
-// the program yields briefly to the operating system.
+// the program yields briefly to the operating system.  If net_func is given,
+// it is called whenever a packet arrives while waiting for the next task.
 //
-void D_RunTics(void (*sim_func)(), void(*display_func)())
+void D_RunTics(void (*sim_func)(), void(*display_func)(), void (*net_func)())
 {
 	D_InitTaskSchedulers(sim_func, display_func);
 
@@ -1201,6 +1215,18 @@ void D_RunTics(void (*sim_func)(), void(*display_func)())
 	const dtime_t display_wake_time = display_scheduler->getNextTime();
 	const dtime_t wake_time = std::min<dtime_t>(simulation_wake_time, display_wake_time);
 
+	if (net_func != NULL)
+	{
+		// Sleep until the next scheduled task, but handle packets as soon as
+		// they arrive instead of leaving them for the next tic.
+		for (dtime_t now = I_GetTime(); wake_time > now; now = I_GetTime())
+		{
+			if (NET_WaitForPacket(wake_time - now))
+				net_func();
+		}
+		return;
+	}
+
 	constexpr dtime_t max_sleep_amount = 1000LL * 1000LL;	// 1ms
 
 	// Sleep in 1ms increments until the next scheduled task
@@ -33,6 +33,9 @@
 #include "stats.h"
 #include "p_local.h"
 #include "g_musinfo.h"
+#include "c_dispatch.h"
+
+#include <unordered_map>
 
 IMPLEMENT_SERIAL (DThinker, DObject)
 
@@ -41,6 +44,27 @@ DThinker *DThinker::LastThinker = NULL;
 
 std::vector<DThinker *> LingerDestroy;
 
+// Thinkers that have been constructed but not yet sorted by type.
+static ThinkerList PendingThinkers = { NULL, NULL, NULL, 0 };
+
+// One list per concrete thinker type.  Lists are created the first time a
+// type is seen and are never freed, so pointers to them stay valid.
+static std::vector<ThinkerList *> ThinkerLists;
+static std::unordered_map<const TypeInfo *, ThinkerList *> ThinkerListByType;
+
+// Lists matching each type that has been iterated over, rebuilt whenever a
+// new concrete type shows up.
+static std::unordered_map<const TypeInfo *, std::vector<ThinkerList *> > ThinkerListCache;
+static size_t ThinkerListCacheSize = 0;
+
+// Thinkers are stamped in construction order, which is also the order of the
+// main thinker list.
+static uint64_t NextThinkerSerial = 1;
+
+static uint64_t IteratorPasses = 0;
+static uint64_t IteratorVisited = 0;
+static uint64_t IteratorSkipped = 0;
+
 void DThinker::Serialize (FArchive &arc)
 {
 	Super::Serialize (arc);
@@ -99,6 +123,10 @@ DThinker::DThinker ()
 	LastThinker = this;
 	refCount = 0;
 	destroyed = false;
+
+	m_Serial = NextThinkerSerial++;
+	m_TypeList = NULL;
+	LinkToTypeList (&PendingThinkers);
 }
 
 DThinker::~DThinker ()
@@ -112,9 +140,102 @@ void DThinker::Orphan()
 {
 	m_Next = NULL;
 	m_Prev = NULL;
+	m_TypeNext = NULL;
+	m_TypePrev = NULL;
+	m_TypeList = NULL;
 	refCount = 0;
 }
 
+void DThinker::LinkToTypeList (ThinkerList *list)
+{
+	m_TypeList = list;
+	m_TypePrev = list->tail;
+	m_TypeNext = NULL;
+	if (list->tail)
+		list->tail->m_TypeNext = this;
+	else
+		list->head = this;
+	list->tail = this;
+	list->count++;
+}
+
+// The node keeps its own links, so an iterator that is sitting on it can
+// still step past it.
+void DThinker::UnlinkFromTypeList ()
+{
+	ThinkerList *list = m_TypeList;
+	if (list == NULL)
+		return;
+
+	if (list->head == this)
+		list->head = m_TypeNext;
+	if (list->tail == this)
+		list->tail = m_TypePrev;
+	if (m_TypeNext)
+		m_TypeNext->m_TypePrev = m_TypePrev;
+	if (m_TypePrev)
+		m_TypePrev->m_TypeNext = m_TypeNext;
+
+	list->count--;
+	m_TypeList = NULL;
+}
+
+void DThinker::ClassifyThinkers ()
+{
+	while (PendingThinkers.head)
+	{
+		DThinker *thinker = PendingThinkers.head;
+		thinker->UnlinkFromTypeList ();
+
+		const TypeInfo *type = thinker->StaticType ();
+		ThinkerList *&list = ThinkerListByType[type];
+		if (list == NULL)
+		{
+			list = new ThinkerList;
+			list->type = type;
+			list->head = list->tail = NULL;
+			list->count = 0;
+			ThinkerLists.push_back (list);
+		}
+
+		thinker->LinkToTypeList (list);
+	}
+}
+
+const std::vector<ThinkerList *> &DThinker::ThinkerListsOf (const TypeInfo *type)
+{
+	if (ThinkerListCacheSize != ThinkerLists.size ())
+	{
+		ThinkerListCache.clear ();
+		ThinkerListCacheSize = ThinkerLists.size ();
+	}
+
+	auto it = ThinkerListCache.find (type);
+	if (it != ThinkerListCache.end ())
+		return it->second;
+
+	std::vector<ThinkerList *> &lists = ThinkerListCache[type];
+	for (ThinkerList *list : ThinkerLists)
+	{
+		if (list->type->IsDescendantOf (type))
+			lists.push_back (list);
+	}
+	return lists;
+}
+
+const std::vector<ThinkerList *> &DThinker::AllThinkerLists ()
+{
+	return ThinkerLists;
+}
+
+size_t DThinker::NumThinkers ()
+{
+	size_t count = PendingThinkers.count;
+	for (const ThinkerList *list : ThinkerLists)
+		count += list->count;
+	return count;
+}
+
 void DThinker::Destroy ()
 {
 	// denis - allow this function to be safely called multiple times
@@ -130,6 +251,8 @@ void DThinker::Destroy ()
 	if (m_Prev)
 		m_Prev->m_Next = m_Next;
 
+	UnlinkFromTypeList ();
+
 	destroyed = true;
 
 	if(refCount)
@@ -261,15 +384,151 @@ void DThinker::RunThinkers ()
 
 void *DThinker::operator new (size_t size)
 {
-	return Z_Malloc (size, PU_LEVSPEC, 0);
+	return Z_MallocSlab (size, PU_LEVSPEC);
 }
 
 // Deallocation is lazy -- it will not actually be freed
 // until its thinking turn comes up.
-void DThinker::operator delete (void *mem)
+void DThinker::operator delete (void *mem, size_t size)
 {
-	Z_Free (mem);
+	Z_FreeSlab (mem, size);
+}
+
+FThinkerIterator::FThinkerIterator (TypeInfo *type)
+	: m_ParentType (type), m_NumLists (0), m_Visited (0)
+{
+	Rewind ();
+}
+
+void FThinkerIterator::Rewind ()
+{
+	DThinker::ClassifyThinkers ();
+
+	const std::vector<ThinkerList *> &lists = DThinker::ThinkerListsOf (m_ParentType);
+	m_Cursors.clear ();
+	for (ThinkerList *list : lists)
+	{
+		Cursor cursor = { list, list->head, 0 };
+		m_Cursors.push_back (cursor);
+	}
+	m_NumLists = lists.size ();
+	m_Visited = 0;
+}
+
+//
+// Refill
+//
+// Called when every cursor has run off the end of its list.  Picks up
+// thinkers that were spawned since the iterator last looked, including ones
+// of a type that did not exist yet.  Returns false if there are none.
+//
+bool FThinkerIterator::Refill ()
+{
+	DThinker::ClassifyThinkers ();
+
+	const std::vector<ThinkerList *> &lists = DThinker::ThinkerListsOf (m_ParentType);
+	for (size_t i = m_NumLists; i < lists.size (); i++)
+	{
+		Cursor cursor = { lists[i], NULL, 0 };
+		m_Cursors.push_back (cursor);
+	}
+	m_NumLists = lists.size ();
+
+	bool found = false;
+	for (Cursor &cursor : m_Cursors)
+	{
+		DThinker *first = NULL;
+		for (DThinker *th = cursor.list->tail;
+		     th && th->m_Serial > cursor.lastSerial; th = th->m_TypePrev)
+		{
+			first = th;
+		}
+
+		if (first)
+		{
+			cursor.next = first;
+			found = true;
+		}
+	}
+	return found;
+}
+
+//
+// Next
+//
+// Thinkers of several matching types are merged by serial number, so they
+// come out in the same order as a walk of the main thinker list.
+//
+DThinker *FThinkerIterator::Next ()
+{
+	for (;;)
+	{
+		Cursor *best = NULL;
+		for (Cursor &cursor : m_Cursors)
+		{
+			if (cursor.next && (!best || cursor.next->m_Serial < best->next->m_Serial))
+				best = &cursor;
+		}
+
+		if (best)
+		{
+			DThinker *res = best->next;
+			best->lastSerial = res->m_Serial;
+			best->next = res->m_TypeNext;
+			m_Visited++;
+			return res;
+		}
+
+		if (!Refill ())
+			break;
+	}
+
+	IteratorPasses++;
+	IteratorVisited += m_Visited;
+	IteratorSkipped += Skipped ();
+
+	Rewind ();
+	return NULL;
+}
+
+size_t FThinkerIterator::Skipped () const
+{
+	size_t total = DThinker::NumThinkers ();
+	return total > m_Visited ? total - m_Visited : 0;
+}
+
+void FThinkerIterator::ResetStats ()
+{
+	IteratorPasses = IteratorVisited = IteratorSkipped = 0;
+}
+
+void FThinkerIterator::PrintStats ()
+{
+	DThinker::ClassifyThinkers ();
+
+	PrintFmt(PRINT_HIGH, "{} thinkers in {} lists:\n", DThinker::NumThinkers (),
+	         DThinker::AllThinkerLists ().size ());
+	for (const ThinkerList *list : DThinker::AllThinkerLists ())
+	{
+		if (list->count)
+			PrintFmt(PRINT_HIGH, "  {:<20} {}\n", list->type->Name, list->count);
+	}
+
+	PrintFmt(PRINT_HIGH, "{} iterator passes visited {} thinkers and skipped {}\n",
+	         IteratorPasses, IteratorVisited, IteratorSkipped);
+}
+
+BEGIN_COMMAND (thinkerstats)
+{
+	if (argc > 1 && stricmp (argv[1], "reset") == 0)
+	{
+		FThinkerIterator::ResetStats ();
+		return;
+	}
+
+	FThinkerIterator::PrintStats ();
 }
+END_COMMAND (thinkerstats)
 
 bool P_ThinkerIsPlayerType(DThinker* thinker)
 {
@@ -52,6 +52,15 @@ typedef actionf_t  think_t;
 
 class FThinkerIterator;
 
+// Intrusive list of every live thinker of exactly one concrete type.
+struct ThinkerList
+{
+	const TypeInfo *type;
+	DThinker *head;
+	DThinker *tail;
+	size_t count;
+};
+
 // Doubly linked list of thinkers
 class DThinker : public DObject
 {
@@ -65,7 +74,7 @@ public:
 	virtual void RunThink () {}
 
 	void *operator new (size_t size);
-	void operator delete (void *block);
+	void operator delete (void *block, size_t size);
 
 	// Both the head and tail of the thinker list.
 	static DThinker *FirstThinker;
@@ -75,44 +84,61 @@ public:
 	static void DestroyMostThinkers ();
 	static void SerializeAll (FArchive &arc, bool keepPlayers);
 
+	// Per-type lists.  A thinker's dynamic type is not known until its
+	// most-derived constructor has finished, so new thinkers wait on a
+	// pending list and are sorted into their type's list the next time
+	// anybody iterates.
+	static void ClassifyThinkers ();
+	static const std::vector<ThinkerList *> &ThinkerListsOf (const TypeInfo *type);
+	static const std::vector<ThinkerList *> &AllThinkerLists ();
+	static size_t NumThinkers ();
+
 	bool WasDestroyed();
 
 	size_t refCount;
 
 private:
 	DThinker *m_Next, *m_Prev;
+	DThinker *m_TypeNext, *m_TypePrev;
+	ThinkerList *m_TypeList;
+	uint64_t m_Serial;
 	bool destroyed;
 
+	void LinkToTypeList (ThinkerList *list);
+	void UnlinkFromTypeList ();
+
 	friend class FThinkerIterator;
 };
 
 class FThinkerIterator
 {
 private:
+	struct Cursor
+	{
+		ThinkerList *list;
+		DThinker *next;
+		uint64_t lastSerial;
+	};
+
 	TypeInfo *m_ParentType;
-	DThinker *m_CurrThinker;
+	std::vector<Cursor> m_Cursors;
+	size_t m_NumLists;
+	size_t m_Visited;
+
+	void Rewind ();
+	bool Refill ();
 
 public:
-	FThinkerIterator (TypeInfo *type)
-	{
-		m_ParentType = type;
-		m_CurrThinker = DThinker::FirstThinker;
-	}
-	DThinker *Next ()
-	{
-		while (m_CurrThinker)
-		{
-			if (m_CurrThinker->IsKindOf (m_ParentType))
-			{
-				DThinker *res = m_CurrThinker;
-				m_CurrThinker = m_CurrThinker->m_Next;
-				return res;
-			}
-			m_CurrThinker = m_CurrThinker->m_Next;
-		}
-		m_CurrThinker = DThinker::FirstThinker;
-		return NULL;
-	}
+	FThinkerIterator (TypeInfo *type);
+	DThinker *Next ();
+
+	// Number of thinkers this iterator has returned during the current pass
+	// and the number a walk of the whole thinker list would have skipped.
+	size_t Visited () const { return m_Visited; }
+	size_t Skipped () const;
+
+	static void ResetStats ();
+	static void PrintStats ();
 };
 
 template <class T> class TThinkerIterator : public FThinkerIterator
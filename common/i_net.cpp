@@ -67,6 +67,18 @@ typedef int SOCKET;
 #define SETSOCKOPTCAST(x) ((const void *)(x))
 #endif
 
+// Linux can move several datagrams per syscall with recvmmsg/sendmmsg.
+#ifdef __linux__
+#define NET_BATCHED_IO
+#endif
+
+// Linux can also wait for a packet or a nanosecond deadline in one call.
+#ifdef __linux__
+#define NET_EPOLL_WAIT
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
 #include <google/protobuf/message.h>
 
 
@@ -333,12 +345,26 @@ void BindToLocalPort (SOCKET s, u_short wanted)
 }
 
 
+#ifdef NET_EPOLL_WAIT
+// Waits on the socket and a deadline timer, see NET_WaitForPacket.
+static int wait_epoll = -1;
+static int wait_timer = -1;
+#endif
+
 void CloseNetwork (void)
 {
 #ifdef ODA_HAVE_MINIUPNP
     upnp_rem_redir (port);
 #endif
 
+#ifdef NET_EPOLL_WAIT
+	if (wait_timer != -1)
+		close(wait_timer);
+	if (wait_epoll != -1)
+		close(wait_epoll);
+	wait_timer = wait_epoll = -1;
+#endif
+
 	closesocket (inet_socket);
 #ifdef _WIN32
 	WSACleanup ();
@@ -418,6 +444,131 @@ bool NET_CompareAdr (netadr_t a, netadr_t b)
 typedef int socklen_t;
 #endif
 
+#ifdef NET_BATCHED_IO
+
+// Number of datagrams moved per recvmmsg/sendmmsg call.
+static const size_t NET_BATCH_SIZE = 32;
+
+struct NetBatch
+{
+	mmsghdr hdrs[NET_BATCH_SIZE];
+	iovec iovs[NET_BATCH_SIZE];
+	sockaddr_in addrs[NET_BATCH_SIZE];
+	byte data[NET_BATCH_SIZE][MAX_UDP_PACKET];
+	size_t count;
+	size_t next;
+
+	// Point slot i at its own data buffer and address.
+	void prepare(size_t i, size_t len)
+	{
+		iovs[i].iov_base = data[i];
+		iovs[i].iov_len = len;
+		memset(&hdrs[i], 0, sizeof(hdrs[i]));
+		hdrs[i].msg_hdr.msg_name = &addrs[i];
+		hdrs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		hdrs[i].msg_hdr.msg_iov = &iovs[i];
+		hdrs[i].msg_hdr.msg_iovlen = 1;
+	}
+};
+
+static NetBatch recvBatch;
+static NetBatch sendBatch;
+static int sendBatchDepth = 0;
+
+//
+// NET_FillRecvBatch
+//
+// Drain as many waiting datagrams as fit into recvBatch with one syscall.
+//
+static bool NET_FillRecvBatch()
+{
+	recvBatch.count = recvBatch.next = 0;
+
+	for (size_t i = 0; i < NET_BATCH_SIZE; i++)
+		recvBatch.prepare(i, MAX_UDP_PACKET);
+
+	int ret = recvmmsg(inet_socket, recvBatch.hdrs, NET_BATCH_SIZE, MSG_DONTWAIT, NULL);
+	if (ret == -1)
+	{
+		if (errno == EWOULDBLOCK)
+			return false;
+		if (errno == ECONNREFUSED)
+			return false;
+
+		PrintFmt(PRINT_HIGH, "NET_GetPacket: {}\n", strerror(errno));
+		return false;
+	}
+
+	recvBatch.count = ret;
+	return ret > 0;
+}
+
+static void NET_FlushSendBatch()
+{
+	size_t sent = 0;
+	while (sent < sendBatch.count)
+	{
+		int ret = sendmmsg(inet_socket, sendBatch.hdrs + sent, sendBatch.count - sent, 0);
+		if (ret == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno != EWOULDBLOCK && errno != ECONNREFUSED)
+				PrintFmt(PRINT_HIGH, "NET_SendPacket: {}\n", strerror(errno));
+
+			// Drop the datagram that failed, as sendto would have.
+			ret = 1;
+		}
+		sent += ret;
+	}
+
+	sendBatch.count = 0;
+}
+
+#endif // NET_BATCHED_IO
+
+//
+// NET_BeginSendBatch
+//
+// Queue packets passed to NET_SendPacket until the matching
+// NET_EndSendBatch, so they can be sent with as few syscalls as possible.
+// Calls may be nested; packets go out when the outermost batch ends.
+//
+void NET_BeginSendBatch()
+{
+#ifdef NET_BATCHED_IO
+	sendBatchDepth++;
+#endif
+}
+
+void NET_EndSendBatch()
+{
+#ifdef NET_BATCHED_IO
+	if (sendBatchDepth > 0 && --sendBatchDepth == 0)
+		NET_FlushSendBatch();
+#endif
+}
+
+#ifdef NET_BATCHED_IO
+
+int NET_GetPacket (void)
+{
+	if (recvBatch.next >= recvBatch.count && !NET_FillRecvBatch())
+		return false;
+
+	const size_t i = recvBatch.next++;
+	const size_t len = MIN<size_t>(recvBatch.hdrs[i].msg_len, net_message.maxsize());
+
+	net_message.clear();
+	memcpy(net_message.ptr(), recvBatch.data[i], len);
+	net_message.setcursize(len);
+	SockadrToNetadr(&recvBatch.addrs[i], &net_from);
+
+	return len;
+}
+
+#else
+
 int NET_GetPacket (void)
 {
 	int				  ret;
@@ -464,6 +615,8 @@ int NET_GetPacket (void)
 	return ret;
 }
 
+#endif // NET_BATCHED_IO
+
 int NET_SendPacket (buf_t &buf, netadr_t &to)
 {
 	int				   ret;
@@ -479,6 +632,23 @@ int NET_SendPacket (buf_t &buf, netadr_t &to)
 
 	NetadrToSockadr (&to, &addr);
 
+#ifdef NET_BATCHED_IO
+	if (sendBatchDepth > 0 && buf.size() <= MAX_UDP_PACKET)
+	{
+		if (sendBatch.count == NET_BATCH_SIZE)
+			NET_FlushSendBatch();
+
+		const size_t i = sendBatch.count++;
+		memcpy(sendBatch.data[i], buf.ptr(), buf.size());
+		sendBatch.addrs[i] = addr;
+		sendBatch.prepare(i, buf.size());
+
+		ret = buf.size();
+		buf.clear();
+		return ret;
+	}
+#endif
+
 	ret = sendto(inet_socket, (const char *)buf.ptr(), buf.size(), 0, (struct sockaddr *)&addr, sizeof(addr));
 
 	buf.clear();
@@ -635,19 +805,21 @@ void MSG_WriteSVC(buf_t* b, const google::protobuf::Message& msg)
 	b->WriteChunk(buffer.data(), buffer.size());
 }
 
-/**
- * @brief Broadcast message to all players.
- *
- * @param buf Type of buffer to broadcast in, per player.
- * @param msg Message to broadcast to all players.
- * @param skip If passed, skip this player id.
- */
-void MSG_BroadcastSVC(const clientBuf_e buf, const google::protobuf::Message& msg,
-                      const int skipPlayer)
+EncodedSVC::EncodedSVC(const google::protobuf::Message& msg)
 {
 	if (simulated_connection)
 		return;
 
+	svc_t header = SVC_ResolveDescriptor(msg.GetDescriptor());
+	if (header == svc_noop)
+	{
+		PrintFmt(PRINT_WARNING,
+		         "WARNING: Could not find svc header for message \"{}\".  This is most "
+		         "likely a bug.\n",
+		         msg.GetDescriptor()->full_name());
+		return;
+	}
+
 	static std::string buffer;
 	if (!msg.SerializeToString(&buffer))
 	{
@@ -658,15 +830,55 @@ void MSG_BroadcastSVC(const clientBuf_e buf, const google::protobuf::Message& ms
 		return;
 	}
 
-	svc_t header = SVC_ResolveDescriptor(msg.GetDescriptor());
-	if (header == svc_noop)
+	// Frame the message exactly as buf_t::WriteUnVarint would.
+	std::string* data = new std::string;
+	data->reserve(buffer.size() + 4);
+	data->push_back(static_cast<char>(header));
+	for (size_t uv = buffer.size();; uv >>= 7)
 	{
-		PrintFmt(PRINT_WARNING,
-		         "WARNING: Could not find svc header for message \"{}\".  This is most "
-		         "likely a bug.\n",
-		         msg.GetDescriptor()->full_name());
-		return;
+		if (uv < 0x80)
+		{
+			data->push_back(static_cast<char>(uv));
+			break;
+		}
+		data->push_back(static_cast<char>((uv & 0x7F) | 0x80));
 	}
+	data->append(buffer);
+
+	m_data.reset(data);
+}
+
+svc_t EncodedSVC::header() const
+{
+	return m_data ? static_cast<svc_t>((*m_data)[0]) : svc_noop;
+}
+
+/**
+ * @brief Append an already encoded message to a buffer.
+ */
+void MSG_WriteSVC(buf_t* b, const EncodedSVC& msg)
+{
+	if (simulated_connection || !msg.valid())
+		return;
+
+	// Do we actaully have room for this upcoming message?
+	if (b->cursize + msg.size() >= MAX_UDP_SIZE)
+		SV_SendPackets();
+
+	b->WriteChunk(msg.data(), msg.size());
+}
+
+/**
+ * @brief Broadcast an already encoded message to all players.
+ *
+ * @param buf Type of buffer to broadcast in, per player.
+ * @param msg Message to broadcast to all players.
+ * @param skip If passed, skip this player id.
+ */
+void MSG_BroadcastSVC(const clientBuf_e buf, const EncodedSVC& msg, const int skipPlayer)
+{
+	if (simulated_connection || !msg.valid())
+		return;
 
 	for (auto& player : players)
 	{
@@ -678,18 +890,23 @@ void MSG_BroadcastSVC(const clientBuf_e buf, const google::protobuf::Message& ms
 
 		// Select the correct buffer.
 		buf_t* b = buf == CLBUF_RELIABLE ? &player.client.reliablebuf : &player.client.netbuf;
-
-		// Do we actaully have room for this upcoming message?
-		static constexpr size_t MAX_HEADER_SIZE = 4; // header + 3 bytes for varint size.
-		if (b->cursize + MAX_HEADER_SIZE + msg.ByteSizeLong() >= MAX_UDP_SIZE)
-			SV_SendPackets();
-
-		b->WriteByte(header);
-		b->WriteUnVarint(buffer.size());
-		b->WriteChunk(buffer.data(), buffer.size());
+		MSG_WriteSVC(b, msg);
 	}
 }
 
+/**
+ * @brief Broadcast message to all players.
+ *
+ * @param buf Type of buffer to broadcast in, per player.
+ * @param msg Message to broadcast to all players.
+ * @param skip If passed, skip this player id.
+ */
+void MSG_BroadcastSVC(const clientBuf_e buf, const google::protobuf::Message& msg,
+                      const int skipPlayer)
+{
+	MSG_BroadcastSVC(buf, EncodedSVC(msg), skipPlayer);
+}
+
 void MSG_WriteShort (buf_t *b, short c)
 {
 	if (simulated_connection)
@@ -1052,6 +1269,7 @@ static void InitNetMessageFormats()
 	SVC_INFO(svc_maplist_index);
 	SVC_INFO(svc_toast);
 	SVC_INFO(svc_hordeinfo);
+	SVC_INFO(svc_worldsnapshot);
 	SVC_INFO(svc_max);
 
 	// Client Messages.
@@ -1141,6 +1359,12 @@ void InitNetCommon(void)
 //
 bool NetWaitOrTimeout(size_t ms)
 {
+#ifdef NET_BATCHED_IO
+	// Datagrams already pulled off the socket won't wake select.
+	if (recvBatch.next < recvBatch.count)
+		return true;
+#endif
+
 	struct timeval timeout = {0, int(1000*ms) + 1};
 	fd_set fds;
 
@@ -1165,6 +1389,83 @@ bool NetWaitOrTimeout(size_t ms)
 	return false;
 }
 
+//
+// NET_WaitForPacket
+//
+// Sleep until a packet arrives or the timeout in nanoseconds runs out,
+// whichever comes first.  Returns true if there is a packet to read.
+//
+bool NET_WaitForPacket(dtime_t timeout)
+{
+#ifdef NET_BATCHED_IO
+	// Datagrams already pulled off the socket won't wake anything.
+	if (recvBatch.next < recvBatch.count)
+		return true;
+#endif
+
+#ifdef NET_EPOLL_WAIT
+	if (wait_epoll == -1)
+	{
+		wait_epoll = epoll_create1(EPOLL_CLOEXEC);
+		wait_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (wait_epoll == -1 || wait_timer == -1)
+			I_FatalError("NET_WaitForPacket: {}", strerror(errno));
+
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = inet_socket;
+		if (epoll_ctl(wait_epoll, EPOLL_CTL_ADD, inet_socket, &ev) == -1)
+			I_FatalError("NET_WaitForPacket: epoll_ctl: {}", strerror(errno));
+
+		ev.data.fd = wait_timer;
+		if (epoll_ctl(wait_epoll, EPOLL_CTL_ADD, wait_timer, &ev) == -1)
+			I_FatalError("NET_WaitForPacket: epoll_ctl: {}", strerror(errno));
+	}
+
+	if (timeout == 0)
+		timeout = 1;
+
+	struct itimerspec deadline;
+	memset(&deadline, 0, sizeof(deadline));
+	deadline.it_value.tv_sec = timeout / 1000000000LL;
+	deadline.it_value.tv_nsec = timeout % 1000000000LL;
+	timerfd_settime(wait_timer, 0, &deadline, NULL);
+
+	struct epoll_event events[2];
+	const int count = epoll_wait(wait_epoll, events, ARRAY_LENGTH(events), -1);
+	if (count == -1 && errno != EINTR)
+		PrintFmt(PRINT_HIGH, "epoll_wait returned -1: {}\n", strerror(errno));
+
+	bool ready = false;
+	for (int i = 0; i < count; i++)
+	{
+		if (events[i].data.fd == static_cast<int>(inet_socket))
+		{
+			ready = true;
+		}
+		else
+		{
+			uint64_t expirations;
+			if (read(wait_timer, &expirations, sizeof(expirations)) == -1 &&
+			    errno != EAGAIN)
+				PrintFmt(PRINT_HIGH, "timerfd read returned -1: {}\n", strerror(errno));
+		}
+	}
+
+	return ready;
+#else
+	struct timeval tv = {static_cast<long>(timeout / 1000000000LL),
+	                     static_cast<long>((timeout % 1000000000LL) / 1000LL) + 1};
+	fd_set fds;
+
+	FD_ZERO(&fds);
+	FD_SET(inet_socket, &fds);
+
+	return select(inet_socket + 1, &fds, NULL, NULL, &tv) == 1;
+#endif
+}
+
 void I_SetPort(netadr_t &addr, int port)
 {
    addr.port = htons(port);
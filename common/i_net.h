@@ -24,6 +24,8 @@
 
 #pragma once
 
+#include <memory>
+
 // Default buffer size for a UDP packet.
 // This constant seems to be used as a default buffer size and should
 // probably not be considered a reasonable MTU.
@@ -42,6 +44,7 @@
 #define MSG_CHALLENGE 5560020     // Signals challenger wants MSG protocol.
 #define LAUNCHER_CHALLENGE 777123 // csdl challenge
 #define RCON_CHALLENGE -5560021   // RCON-only connection (no player slot)
+#define DOWNLOAD_CHALLENGE -5560022 // Out-of-band WAD download (no player slot)
 #define VERSION 65                // GhostlyDeath -- this should remain static from now on
 
 /**
@@ -53,6 +56,12 @@ enum clientBuf_e
 	CLBUF_NET,
 };
 
+/**
+ * @brief Capability flags sent by the client in the connect challenge's
+ *        "connection type" byte.  Older clients always send 0.
+ */
+#define CONNECT_SNAPSHOTS BIT(0) // Client understands svc_worldsnapshot.
+
 /**
  * @brief Compression is enabled for this packet
  */
@@ -255,6 +264,7 @@ enum svc_t
 	svc_toast,
 	svc_hordeinfo,
 	svc_raisemobj,
+	svc_worldsnapshot,     // Delta-compressed per-client actor state
 	svc_netdemocap = 100,  // netdemos - NullPoint
 	svc_netdemostop = 101, // netdemos - NullPoint
 	svc_netdemoloadsnap = 102, // netdemos - NullPoint
@@ -766,12 +776,15 @@ void CloseNetwork (void);
 void InitNetCommon(void);
 void I_SetPort(netadr_t &addr, int port);
 bool NetWaitOrTimeout(size_t ms);
+bool NET_WaitForPacket(dtime_t timeout);
 
 char *NET_AdrToString (netadr_t a);
 bool NET_StringToAdr (const char *s, netadr_t *a);
 bool NET_CompareAdr (netadr_t a, netadr_t b);
 int  NET_GetPacket (void);
 int NET_SendPacket (buf_t &buf, netadr_t &to);
+void NET_BeginSendBatch();
+void NET_EndSendBatch();
 std::string NET_GetLocalAddress (void);
 
 void SZ_Clear (buf_t *buf);
@@ -790,7 +803,35 @@ void MSG_WriteFloat(buf_t *b, float);
 void MSG_WriteString (buf_t *b, const char *s);
 void MSG_WriteHexString(buf_t *b, const char *s);
 void MSG_WriteChunk (buf_t *b, const void *p, unsigned l);
+
+/**
+ * @brief A server message that has been serialized and framed once, so the
+ *        same bytes can be appended to any number of client buffers.
+ *
+ * Copies share the encoded bytes, so an EncodedSVC can be passed around by
+ * value cheaply.
+ */
+class EncodedSVC
+{
+  public:
+	EncodedSVC() { }
+	explicit EncodedSVC(const google::protobuf::Message& msg);
+
+	bool valid() const { return m_data != NULL; }
+	svc_t header() const;
+
+	// Encoded size including the header byte and varint length.
+	size_t size() const { return m_data ? m_data->size() : 0; }
+	const char* data() const { return m_data ? m_data->data() : NULL; }
+
+  private:
+	std::shared_ptr<const std::string> m_data;
+};
+
 void MSG_WriteSVC(buf_t* b, const google::protobuf::Message& msg);
+void MSG_WriteSVC(buf_t* b, const EncodedSVC& msg);
+void MSG_BroadcastSVC(const clientBuf_e buf, const EncodedSVC& msg,
+                      const int skipPlayer = -1);
 void MSG_BroadcastSVC(const clientBuf_e buf, const google::protobuf::Message& msg,
                       const int skipPlayer = -1);
 
@@ -31,6 +31,7 @@
 #include "m_argv.h"
 #include "m_fileio.h"
 #include "md5.h"
+#include "w_hashcache.h"
 #include "w_ident.h"
 #include "w_wad.h"
 
@@ -342,31 +343,36 @@ std::vector<scannedIWAD_t> M_ScanIWADs()
 	std::vector<scannedIWAD_t> rvo;
 	OHashTable<OCRC32Sum, bool> found;
 
+	// Find every candidate first, so the ones we haven't seen before can be
+	// hashed in parallel.
+	std::vector<std::string> candidates;
 	for (const auto& dir : dirs)
 	{
 		std::vector<std::string> files = M_BaseFilesScanDir(dir, iwads);
 		for (const auto& file : files)
-		{
-			const std::string fullpath = dir + PATHSEP + file;
-
-			// Check to see if we got a real IWAD.
-			const OCRC32Sum crc32 = W_CRC32(fullpath);
-			if (crc32.empty())
-				continue;
-
-			// Found a dupe?
-			if (found.find(crc32) != found.end())
-				continue;
-
-			// Does the gameinfo exist?
-			const fileIdentifier_t* id = W_GameInfo(crc32);
-			if (id == NULL)
-				continue;
+			candidates.push_back(dir + PATHSEP + file);
+	}
+	W_PrefetchFileHashes(candidates);
 
-			scannedIWAD_t iwad = {fullpath, id};
-			rvo.push_back(iwad);
-			found[crc32] = true;
-		}
+	for (const auto& fullpath : candidates)
+	{
+		// Check to see if we got a real IWAD.
+		const OCRC32Sum crc32 = W_CRC32(fullpath);
+		if (crc32.empty())
+			continue;
+
+		// Found a dupe?
+		if (found.find(crc32) != found.end())
+			continue;
+
+		// Does the gameinfo exist?
+		const fileIdentifier_t* id = W_GameInfo(crc32);
+		if (id == NULL)
+			continue;
+
+		scannedIWAD_t iwad = {fullpath, id};
+		rvo.push_back(iwad);
+		found[crc32] = true;
 	}
 
 	// Sort the results by weight.
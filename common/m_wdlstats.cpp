@@ -29,8 +29,17 @@
 #include "g_levelstate.h"
 #include "m_wdlstats.h"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <json/json.h>
+
 #include "c_dispatch.h"
 #include "p_local.h"
+#include "w_wad.h"
 
 #define WDLSTATS_VERSION 6
 
@@ -63,14 +72,36 @@ EXTERN_CVAR(g_lives)
 
 std::string M_GetCurrentWadHashes();
 
+// Layout of the saved log.
+enum WDLFormat
+{
+	// The original sectioned text format.
+	WDL_FORMAT_TEXT,
+
+	// One JSON object per line, for ingestion pipelines.
+	WDL_FORMAT_NDJSON
+};
+
 static struct WDLState
 {
 	// Directory to log stats to.
 	std::string logdir;
 
+	// Format to save logs in.
+	WDLFormat format;
+
 	// True if we're recording stats for this game.
 	bool recording;
 
+	// True if the writer has a partial log open.
+	bool writing;
+
+	// Partial log that events are streamed to while recording.
+	std::string partname;
+
+	// Number of events logged since the log was started.
+	size_t eventcount;
+
 	// The starting gametic of the most recent log.
 	int begintic;
 
@@ -126,6 +157,39 @@ struct WDLItemSpawn
 typedef std::vector<WDLItemSpawn> WDLItemSpawns;
 static WDLItemSpawns wdlitemspawns;
 
+// Location of an item spawn, optionally with the item, for indexing them.
+struct WDLItemKey
+{
+	int x;
+	int y;
+	int z;
+	int item;
+
+	bool operator==(const WDLItemKey& other) const
+	{
+		return x == other.x && y == other.y && z == other.z && item == other.item;
+	}
+};
+
+struct WDLItemKeyHash
+{
+	size_t operator()(const WDLItemKey& key) const
+	{
+		size_t hash = static_cast<uint32_t>(key.x);
+		hash = hash * 31 + static_cast<uint32_t>(key.y);
+		hash = hash * 31 + static_cast<uint32_t>(key.z);
+		return hash * 31 + static_cast<uint32_t>(key.item);
+	}
+};
+
+typedef std::unordered_map<WDLItemKey, int, WDLItemKeyHash> WDLItemIndex;
+
+// First item spawn at each location, keyed with an item of -1.
+static WDLItemIndex wdlitemspawnsbypos;
+
+// Item spawns by location and item, to find duplicates.
+static WDLItemIndex wdlitemspawnsbyitem;
+
 // A single tracked flag socket
 struct WDLFlagLocation
 {
@@ -163,10 +227,302 @@ auto inline format_as(const WDLEvent& ev)
 	                   ev.arg1, ev.arg2, ev.arg3);
 }
 
-// Events that we're keeping track of.
+// Events of the current tic, which may still be merged with.  Events of
+// earlier tics are final and are handed to the writer.
 typedef std::vector<WDLEvent> WDLEventLog;
 static WDLEventLog wdlevents;
 
+// The last few events handed to the writer, for wdlinfo.
+static const size_t WDL_RECENT_EVENTS = 1024;
+static std::deque<WDLEvent> wdlrecentevents;
+
+/**
+ * @brief Formats and writes events on a background thread, so a long log
+ *        doesn't stall the game when the level ends.
+ *
+ * Events are streamed to a partial file as they become final.  Committing
+ * puts the header in front of them and gives the log its final name.
+ */
+class WDLWriter
+{
+  public:
+	WDLWriter() : m_stop(false), m_format(WDL_FORMAT_TEXT), m_out(NULL) { }
+
+	~WDLWriter()
+	{
+		if (!m_thread.joinable())
+			return;
+
+		Job job;
+		job.type = Job::STOP;
+		push(job);
+		m_thread.join();
+	}
+
+	void open(const std::string& partname, WDLFormat format)
+	{
+		Job job;
+		job.type = Job::OPEN;
+		job.path = partname;
+		job.format = format;
+		push(job);
+	}
+
+	void write(WDLEventLog& events)
+	{
+		Job job;
+		job.type = Job::EVENTS;
+		job.events.swap(events);
+		push(job);
+	}
+
+	void commit(const std::string& header, const std::string& filename)
+	{
+		Job job;
+		job.type = Job::COMMIT;
+		job.path = filename;
+		job.header = header;
+		push(job);
+	}
+
+	void abort()
+	{
+		Job job;
+		job.type = Job::ABORT;
+		push(job);
+	}
+
+	/**
+	 * @brief Take the errors the writer ran into, to be printed on the
+	 *        main thread.
+	 */
+	std::vector<std::string> errors()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<std::string> errors;
+		errors.swap(m_errors);
+		return errors;
+	}
+
+  private:
+	struct Job
+	{
+		enum Type
+		{
+			OPEN,
+			EVENTS,
+			COMMIT,
+			ABORT,
+			STOP
+		} type;
+		std::string path;
+		std::string header;
+		WDLFormat format;
+		WDLEventLog events;
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::thread m_thread;
+	std::deque<Job> m_jobs;
+	std::vector<std::string> m_errors;
+	bool m_stop;
+
+	// Only touched by the writer thread.
+	WDLFormat m_format;
+	FILE* m_out;
+	std::string m_partname;
+
+	void push(Job& job)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_thread.joinable())
+			m_thread = std::thread(&WDLWriter::run, this);
+
+		m_jobs.push_back(Job());
+		std::swap(m_jobs.back(), job);
+		m_cond.notify_one();
+	}
+
+	void error(const std::string& msg)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_errors.push_back(msg);
+	}
+
+	void run()
+	{
+		for (;;)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cond.wait(lock, [this] { return !m_jobs.empty(); });
+				std::swap(job, m_jobs.front());
+				m_jobs.pop_front();
+			}
+
+			if (job.type == Job::STOP)
+			{
+				discard();
+				return;
+			}
+
+			handle(job);
+		}
+	}
+
+	void handle(Job& job)
+	{
+		switch (job.type)
+		{
+		case Job::OPEN:
+			discard();
+			m_format = job.format;
+			m_partname = job.path;
+			m_out = fopen(m_partname.c_str(), "w+");
+			if (m_out == NULL)
+				error(fmt::format("Could not open \"{}\" for writing.", m_partname));
+			break;
+		case Job::EVENTS:
+			if (m_out == NULL)
+				break;
+			for (const auto& ev : job.events)
+			{
+				if (m_format == WDL_FORMAT_NDJSON)
+				{
+					fmt::print(m_out,
+					           "{{\"type\":\"event\",\"ev\":{},\"activator\":{},"
+					           "\"target\":{},\"gametic\":{},\"apos\":[{},{},{}],"
+					           "\"tpos\":[{},{},{}],\"arg0\":{},\"arg1\":{},"
+					           "\"arg2\":{},\"arg3\":{}}}\n",
+					           ev.ev, ev.activator, ev.target, ev.gametic, ev.apos[0],
+					           ev.apos[1], ev.apos[2], ev.tpos[0], ev.tpos[1], ev.tpos[2],
+					           ev.arg0, ev.arg1, ev.arg2, ev.arg3);
+				}
+				else
+				{
+					fmt::print(m_out, "{}\n", ev);
+				}
+			}
+			break;
+		case Job::COMMIT:
+			finish(job.header, job.path);
+			break;
+		case Job::ABORT:
+		case Job::STOP:
+			discard();
+			break;
+		}
+	}
+
+	/**
+	 * @brief Close and delete a partial log that will never be committed.
+	 */
+	void discard()
+	{
+		if (m_out == NULL)
+			return;
+
+		fclose(m_out);
+		m_out = NULL;
+		remove(m_partname.c_str());
+	}
+
+	void finish(const std::string& header, const std::string& filename)
+	{
+		if (m_out == NULL)
+			return;
+
+		if (m_format == WDL_FORMAT_NDJSON)
+		{
+			// Lines stand on their own, so the header can go last.
+			fputs(header.c_str(), m_out);
+			const bool failed = ferror(m_out) != 0;
+			fclose(m_out);
+			m_out = NULL;
+
+			if (failed || rename(m_partname.c_str(), filename.c_str()) != 0)
+			{
+				error(fmt::format("Could not save \"{}\".", filename));
+				remove(m_partname.c_str());
+			}
+			return;
+		}
+
+		FILE* fh = fopen(filename.c_str(), "w+");
+		if (fh == NULL)
+		{
+			error(fmt::format("Could not save \"{}\" for writing.", filename));
+			discard();
+			return;
+		}
+
+		fputs(header.c_str(), fh);
+
+		// Events go after the header.
+		fflush(m_out);
+		fseek(m_out, 0, SEEK_SET);
+
+		static const size_t copy_chunk_size = 65536;
+		std::vector<char> buf(copy_chunk_size);
+		size_t n = 0;
+		while ((n = fread(buf.data(), 1, buf.size(), m_out)))
+			fwrite(buf.data(), 1, n, fh);
+
+		if (ferror(fh) || ferror(m_out))
+			error(fmt::format("Could not write all of \"{}\".", filename));
+
+		fclose(fh);
+		discard();
+	}
+};
+
+static WDLWriter wdlwriter;
+
+/**
+ * @brief Print anything the writer thread had trouble with.
+ */
+static void ReportWDLWriterErrors()
+{
+	for (const auto& msg : ::wdlwriter.errors())
+		PrintFmt(PRINT_HIGH, "wdlstats: {}\n", msg);
+}
+
+/**
+ * @brief Hand events from earlier tics, which can no longer be merged with,
+ *        to the writer.
+ */
+static void FlushWDLEvents(bool all)
+{
+	WDLEventLog::iterator it = ::wdlevents.begin();
+	if (!all)
+	{
+		while (it != ::wdlevents.end() && it->gametic != ::gametic)
+			++it;
+	}
+
+	if (it == ::wdlevents.begin())
+		return;
+
+	WDLEventLog done(::wdlevents.begin(), it);
+	::wdlevents.erase(::wdlevents.begin(), it);
+
+	::wdlrecentevents.insert(::wdlrecentevents.end(), done.begin(), done.end());
+	while (::wdlrecentevents.size() > WDL_RECENT_EVENTS)
+		::wdlrecentevents.pop_front();
+
+	if (::wdlstate.writing)
+		::wdlwriter.write(done);
+}
+
+static void AddWDLEvent(const WDLEvent& evt)
+{
+	FlushWDLEvents(false);
+	::wdlevents.push_back(evt);
+	::wdlstate.eventcount += 1;
+}
+
 // Turn an event enum into a string.
 //static const char* WDLEventString(WDLEvents i)
 //{
@@ -263,28 +619,28 @@ static void RemoveWDLPlayerSpawn(const mapthing2_t* mthing)
 
 int GetItemSpawn(int x, int y, int z, WDLPowerups item)
 {
-	for (const auto& spawn : ::wdlitemspawns)
-	{
-		if (spawn.x == x && spawn.y == y && spawn.z == z)
-			return spawn.id;
-	}
-	return 0;
+	const WDLItemKey key = {x, y, z, -1};
+	WDLItemIndex::const_iterator it = ::wdlitemspawnsbypos.find(key);
+	if (it == ::wdlitemspawnsbypos.end())
+		return 0;
+	return it->second;
 }
 
 void M_LogWDLItemSpawn(AActor* target, WDLPowerups type)
 {
 	// [Blair] Add item spawn to the table.
 	// Don't add an overlapping item spawn, treat it as one.
-	for (const auto& spawn : ::wdlitemspawns)
-	{
-		if (spawn.x == target->x && spawn.y == target->y && spawn.z == target->z &&
-		    spawn.item == type)
-			return;
-	}
+	const WDLItemKey key = {target->x, target->y, target->z, static_cast<int>(type)};
+	if (::wdlitemspawnsbyitem.find(key) != ::wdlitemspawnsbyitem.end())
+		return;
 
 	WDLItemSpawn wdlitemspawn = {static_cast<int>(::wdlitemspawns.size() + 1), target->x, target->y,
 	                             target->z, type};
 	::wdlitemspawns.push_back(wdlitemspawn);
+
+	::wdlitemspawnsbyitem.emplace(key, wdlitemspawn.id);
+	const WDLItemKey poskey = {target->x, target->y, target->z, -1};
+	::wdlitemspawnsbypos.emplace(poskey, wdlitemspawn.id);
 }
 
 WDLPowerups M_GetWDLItemByMobjType(const mobjtype_t type)
@@ -422,8 +778,9 @@ static void WDLStatsHelp()
 	         "wdlstats - Starts logging WDL statistics to the given directory.  Unless "
 	         "you are running a WDL server, you probably are not interested in this.\n\n"
 	         "Usage:\n"
-	         "  ] wdlstats <DIRNAME>\n"
-	         "  Starts logging WDL statistics in the directory DIRNAME.\n");
+	         "  ] wdlstats <DIRNAME> [FORMAT]\n"
+	         "  Starts logging WDL statistics in the directory DIRNAME.  FORMAT is\n"
+	         "  \"text\" for the usual log, or \"ndjson\" for one JSON object per line.\n");
 }
 
 BEGIN_COMMAND(wdlstats)
@@ -434,8 +791,21 @@ BEGIN_COMMAND(wdlstats)
 		return;
 	}
 
+	WDLFormat format = WDL_FORMAT_TEXT;
+	if (argc >= 3)
+	{
+		if (stricmp(argv[2], "ndjson") == 0)
+			format = WDL_FORMAT_NDJSON;
+		else if (stricmp(argv[2], "text") != 0)
+		{
+			WDLStatsHelp();
+			return;
+		}
+	}
+
 	// Setting the stats dir tells us that we intend to log.
 	::wdlstate.logdir = argv[1];
+	::wdlstate.format = format;
 
 	// Ensure our path ends with a slash.
 	if (::wdlstate.logdir.back() != PATHSEPCHAR)
@@ -480,8 +850,16 @@ void M_StartWDLLog(bool newmap)
 	}
 	*/
 
+	ReportWDLWriterErrors();
+
+	// Throw away a log that was never committed.
+	if (::wdlstate.writing)
+		::wdlwriter.abort();
+
 	// Start with a fresh slate of events.
 	::wdlevents.clear();
+	::wdlrecentevents.clear();
+	::wdlstate.eventcount = 0;
 
 	// And a fresh set of players.
 	::wdlplayers.clear();
@@ -490,6 +868,8 @@ void M_StartWDLLog(bool newmap)
 	{
 		::wdlflaglocations.clear();
 		::wdlitemspawns.clear();
+		::wdlitemspawnsbypos.clear();
+		::wdlitemspawnsbyitem.clear();
 		::wdlplayerspawns.clear();
 	}
 
@@ -499,8 +879,11 @@ void M_StartWDLLog(bool newmap)
 	else
 		::wdlstate.enablebeacons = false;
 
-	// Turn on recording.
+	// Turn on recording, streaming events to a partial log as we go.
 	::wdlstate.recording = true;
+	::wdlstate.partname = ::wdlstate.logdir + "wdl_" + GenerateTimestamp() + ".part";
+	::wdlstate.writing = true;
+	::wdlwriter.open(::wdlstate.partname, ::wdlstate.format);
 
 	// Set our starting tic.
 	::wdlstate.begintic = ::gametic;
@@ -722,7 +1105,7 @@ void M_LogWDLItemRespawnEvent(AActor* activator)
 	// Add the event to the log.
 	WDLEvent evt = {WDL_EVENT_SPAWNITEM, 0,     0,        ::gametic, {ax, ay, az},
 	                {0, 0, 0},           itemtype, itemspawnid, 0,         0};
-	::wdlevents.push_back(evt);
+	AddWDLEvent(evt);
 }
 
 /**
@@ -787,7 +1170,7 @@ void M_LogWDLPickupEvent(player_t* activator, AActor* target, WDLPowerups pickup
 	WDLEvent evt = {
 	    WDL_EVENT_PICKUPITEM, aid,        tid,         ::gametic, {ax, ay, az},
 	    {tx, ty, tz},         pickuptype, itemspawnid, dropitem,  0};
-	::wdlevents.push_back(evt);
+	AddWDLEvent(evt);
 }
 
 /**
@@ -873,7 +1256,7 @@ void M_LogWDLEvent(WDLEvents event, player_t* activator, player_t* target, int a
 	// Add the event to the log.
 	WDLEvent evt = {event,        aid,  tid,  ::gametic, {ax, ay, az},
 	                {tx, ty, tz}, arg0, arg1, arg2,      arg3};
-	::wdlevents.push_back(evt);
+	AddWDLEvent(evt);
 }
 
 /**
@@ -954,88 +1337,181 @@ int M_GetPlayerId(player_t* player, team_t team)
 	return 0;
 }
 
-void M_CommitWDLLog()
+// Header and tables of a text log, which go in front of the events.
+static std::string BuildTextHeader(const char* iso8601)
 {
-	if (!::wdlstate.recording || wdlevents.empty() ||
-	    ::levelstate.getState() != LevelState::INGAME)
-		return;
-
-	// See if we can write a file.
-	std::string timestamp = GenerateTimestamp();
-	std::string filename = ::wdlstate.logdir + "wdl_" + timestamp + ".log";
-
-	// [Blair] Make the in-file timestamp ISO 8601 instead of a homegrown one.
-	// However, keeping the homegrown one for filename as ISO 8601 characters
-	// aren't supported in Windows filenames.
-	time_t now;
-	time(&now);
-	char iso8601buf[sizeof "2011-10-08T07:07:09Z"];
-	strftime(iso8601buf, sizeof iso8601buf, "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
-
-	FILE* fh = fopen(filename.c_str(), "w+");
-	if (fh == NULL)
-	{
-		::wdlstate.recording = false;
-		PrintFmt(PRINT_HIGH, "wdlstats: Could not save\"{}\" for writing.\n",
-		         filename);
-		return;
-	}
+	fmt::memory_buffer out;
+	auto it = std::back_inserter(out);
 
 	// Header (metadata)
-	fmt::print(fh, "version={}\n", WDLSTATS_VERSION);
-	fmt::print(fh, "time={}\n", iso8601buf);
-	fmt::print(fh, "levelnum={}\n", ::level.levelnum);
-	fmt::print(fh, "levelname={}\n", ::level.level_name);
-	fmt::print(fh, "levelhash={}\n", ::level.level_fingerprint.toString());
-	fmt::print(fh, "gametype={}\n", ::sv_gametype.str());
-	fmt::print(fh, "lives={}\n", ::g_lives.str());
-	fmt::print(fh, "attackdefend={}\n", ::g_sides.str());
-	fmt::print(fh, "duration={}\n", ::gametic - ::wdlstate.begintic);
-	fmt::print(fh, "endgametic={}\n", ::gametic);
-	fmt::print(fh, "round={}\n", ::levelstate.getRound());
-	fmt::print(fh, "winresult={}\n", static_cast<int>(::levelstate.getWinInfo().type));
-	fmt::print(fh, "winid={}\n", ::levelstate.getWinInfo().id);
-	fmt::print(fh, "hostname={}\n", ::sv_hostname.str());
+	fmt::format_to(it, "version={}\n", WDLSTATS_VERSION);
+	fmt::format_to(it, "time={}\n", iso8601);
+	fmt::format_to(it, "levelnum={}\n", ::level.levelnum);
+	fmt::format_to(it, "levelname={}\n", ::level.level_name);
+	fmt::format_to(it, "levelhash={}\n", ::level.level_fingerprint.toString());
+	fmt::format_to(it, "gametype={}\n", ::sv_gametype.str());
+	fmt::format_to(it, "lives={}\n", ::g_lives.str());
+	fmt::format_to(it, "attackdefend={}\n", ::g_sides.str());
+	fmt::format_to(it, "duration={}\n", ::gametic - ::wdlstate.begintic);
+	fmt::format_to(it, "endgametic={}\n", ::gametic);
+	fmt::format_to(it, "round={}\n", ::levelstate.getRound());
+	fmt::format_to(it, "winresult={}\n", static_cast<int>(::levelstate.getWinInfo().type));
+	fmt::format_to(it, "winid={}\n", ::levelstate.getWinInfo().id);
+	fmt::format_to(it, "hostname={}\n", ::sv_hostname.str());
 
 	// Players
-	fmt::print(fh, "players\n");
+	fmt::format_to(it, "players\n");
 	for (const auto& pl : ::wdlplayers)
-		fmt::print(fh, "{},{},{},{}\n", pl.id, pl.pid, static_cast<int>(pl.team), pl.netname);
+		fmt::format_to(it, "{},{},{},{}\n", pl.id, pl.pid, static_cast<int>(pl.team), pl.netname);
 
 	// ItemSpawns
-	fmt::print(fh, "itemspawns\n");
+	fmt::format_to(it, "itemspawns\n");
 	for (const auto& is : ::wdlitemspawns)
-		fmt::print(fh, "{},{},{},{},{}\n", is.id, is.x, is.y, is.z, static_cast<int>(is.item));
+		fmt::format_to(it, "{},{},{},{},{}\n", is.id, is.x, is.y, is.z, static_cast<int>(is.item));
 
 	// PlayerSpawns
-	fmt::print(fh, "playerspawns\n");
+	fmt::format_to(it, "playerspawns\n");
 	for (const auto& ps : ::wdlplayerspawns)
-		fmt::print(fh, "{},{},{},{},{}\n", ps.id, static_cast<int>(ps.team), ps.x, ps.y, ps.z);
+		fmt::format_to(it, "{},{},{},{},{}\n", ps.id, static_cast<int>(ps.team), ps.x, ps.y, ps.z);
 
 	if (sv_gametype == GM_CTF)
 	{
 		// FlagLocation
-		fmt::print(fh, "flaglocations\n");
+		fmt::format_to(it, "flaglocations\n");
 		for (const auto& fl : ::wdlflaglocations)
-			fmt::print(fh, "{},{},{},{}\n", static_cast<int>(fl.team), fl.x, fl.y, fl.z);
+			fmt::format_to(it, "{},{},{},{}\n", static_cast<int>(fl.team), fl.x, fl.y, fl.z);
 	}
 
 	// Wads
-	fmt::print(fh, "wads\n");
-	fmt::print(fh, "{}", M_GetCurrentWadHashes());
+	fmt::format_to(it, "wads\n");
+	fmt::format_to(it, "{}", M_GetCurrentWadHashes());
 
 	// Events
-	fmt::print(fh, "events\n");
-	for (const auto& ev : ::wdlevents)
-		fmt::print(fh, "{}\n", ev);
+	fmt::format_to(it, "events\n");
+
+	return fmt::to_string(out);
+}
+
+// The same information as the text header, one JSON object per line.
+static std::string BuildNDJSONHeader(const char* iso8601)
+{
+	Json::FastWriter writer;
+	std::string out;
+
+	Json::Value header(Json::objectValue);
+	header["type"] = "header";
+	header["version"] = WDLSTATS_VERSION;
+	header["time"] = iso8601;
+	header["levelnum"] = ::level.levelnum;
+	header["levelname"] = std::string(::level.level_name);
+	header["levelhash"] = ::level.level_fingerprint.toString();
+	header["gametype"] = ::sv_gametype.str();
+	header["lives"] = ::g_lives.str();
+	header["attackdefend"] = ::g_sides.str();
+	header["duration"] = ::gametic - ::wdlstate.begintic;
+	header["endgametic"] = ::gametic;
+	header["round"] = ::levelstate.getRound();
+	header["winresult"] = static_cast<int>(::levelstate.getWinInfo().type);
+	header["winid"] = ::levelstate.getWinInfo().id;
+	header["hostname"] = ::sv_hostname.str();
+	out += writer.write(header);
+
+	for (const auto& pl : ::wdlplayers)
+	{
+		Json::Value line(Json::objectValue);
+		line["type"] = "player";
+		line["id"] = pl.id;
+		line["pid"] = pl.pid;
+		line["team"] = static_cast<int>(pl.team);
+		line["netname"] = pl.netname;
+		out += writer.write(line);
+	}
+
+	for (const auto& is : ::wdlitemspawns)
+	{
+		Json::Value line(Json::objectValue);
+		line["type"] = "itemspawn";
+		line["id"] = is.id;
+		line["x"] = is.x;
+		line["y"] = is.y;
+		line["z"] = is.z;
+		line["item"] = static_cast<int>(is.item);
+		out += writer.write(line);
+	}
+
+	for (const auto& ps : ::wdlplayerspawns)
+	{
+		Json::Value line(Json::objectValue);
+		line["type"] = "playerspawn";
+		line["id"] = ps.id;
+		line["team"] = static_cast<int>(ps.team);
+		line["x"] = ps.x;
+		line["y"] = ps.y;
+		line["z"] = ps.z;
+		out += writer.write(line);
+	}
+
+	if (sv_gametype == GM_CTF)
+	{
+		for (const auto& fl : ::wdlflaglocations)
+		{
+			Json::Value line(Json::objectValue);
+			line["type"] = "flaglocation";
+			line["team"] = static_cast<int>(fl.team);
+			line["x"] = fl.x;
+			line["y"] = fl.y;
+			line["z"] = fl.z;
+			out += writer.write(line);
+		}
+	}
+
+	for (const auto& file : ::wadfiles)
+	{
+		Json::Value line(Json::objectValue);
+		line["type"] = "wad";
+		line["name"] = file.getBasename();
+		line["md5"] = file.getMD5().getHexStr();
+		out += writer.write(line);
+	}
 
-	fclose(fh);
+	return out;
+}
+
+void M_CommitWDLLog()
+{
+	if (!::wdlstate.recording || ::wdlstate.eventcount == 0 ||
+	    ::levelstate.getState() != LevelState::INGAME)
+		return;
+
+	// See if we can write a file.
+	std::string timestamp = GenerateTimestamp();
+	std::string filename = ::wdlstate.logdir + "wdl_" + timestamp +
+	                       (::wdlstate.format == WDL_FORMAT_NDJSON ? ".ndjson" : ".log");
+
+	// [Blair] Make the in-file timestamp ISO 8601 instead of a homegrown one.
+	// However, keeping the homegrown one for filename as ISO 8601 characters
+	// aren't supported in Windows filenames.
+	time_t now;
+	time(&now);
+	char iso8601buf[sizeof "2011-10-08T07:07:09Z"];
+	strftime(iso8601buf, sizeof iso8601buf, "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	// The events have been streamed out as they happened, only the last of
+	// them and the header are left to hand over.
+	FlushWDLEvents(true);
+
+	const std::string header = ::wdlstate.format == WDL_FORMAT_NDJSON
+	                               ? BuildNDJSONHeader(iso8601buf)
+	                               : BuildTextHeader(iso8601buf);
+	::wdlwriter.commit(header, filename);
+	::wdlstate.writing = false;
 
 	// Turn off stat recording global - it must be turned on again by the
 	// log starter next go-around.
 	::wdlstate.recording = false;
 
-	PrintFmt(PRINT_HIGH, "wdlstats: Log saved as \"{}\".\n", filename);
+	ReportWDLWriterErrors();
+	PrintFmt(PRINT_HIGH, "wdlstats: Saving log as \"{}\".\n", filename);
 }
 
 static void PrintWDLEvent(const WDLEvent& evt)
@@ -1043,13 +1519,21 @@ static void PrintWDLEvent(const WDLEvent& evt)
 	PrintFmt(PRINT_HIGH, "{}\n", evt);
 }
 
+// Events still in memory, oldest first.
+static std::vector<WDLEvent> RecentWDLEvents()
+{
+	std::vector<WDLEvent> events(::wdlrecentevents.begin(), ::wdlrecentevents.end());
+	events.insert(events.end(), ::wdlevents.begin(), ::wdlevents.end());
+	return events;
+}
+
 static void WDLInfoHelp()
 {
 	PrintFmt(PRINT_HIGH,
 	         "wdlinfo - Looks up internal information about logged WDL events\n\n"
 	         "Usage:\n"
 	         "  ] wdlinfo event <ID>\n"
-	         "  Print the event by ID.\n\n"
+	         "  Print the event by ID, if it is one of the most recent.\n\n"
 	         "  ] wdlinfo size\n"
 	         "  Return the size of the internal event array.\n\n"
 	         "  ] wdlinfo state\n"
@@ -1069,7 +1553,7 @@ BEGIN_COMMAND(wdlinfo)
 	if (stricmp(argv[1], "size") == 0)
 	{
 		// Count total events.
-		PrintFmt(PRINT_HIGH, "{} events found\n", ::wdlevents.size());
+		PrintFmt(PRINT_HIGH, "{} events found\n", ::wdlstate.eventcount);
 		return;
 	}
 	else if (stricmp(argv[1], "state") == 0)
@@ -1084,20 +1568,19 @@ BEGIN_COMMAND(wdlinfo)
 	}
 	else if (stricmp(argv[1], "tail") == 0)
 	{
-		// [Blair] C++ doesn't like when you access an iterator on an empty vector.
-		if (::wdlevents.empty())
+		const std::vector<WDLEvent> events = RecentWDLEvents();
+		if (events.empty())
 		{
 			PrintFmt(PRINT_HIGH, "No events to show.\n");
 			return;
 		}
+
 		// Show last 10 events.
-		WDLEventLog::const_iterator it = ::wdlevents.end() - 10;
-		if (it < ::wdlevents.begin())
-			it = wdlevents.begin();
+		std::vector<WDLEvent>::const_iterator it =
+		    events.end() - std::min<size_t>(10, events.size());
 
-		PrintFmt(PRINT_HIGH, "Showing last {} events:\n",
-		         ::wdlevents.end() - it);
-		for (; it != ::wdlevents.end(); ++it)
+		PrintFmt(PRINT_HIGH, "Showing last {} events:\n", events.end() - it);
+		for (; it != events.end(); ++it)
 			PrintWDLEvent(*it);
 		return;
 	}
@@ -1111,13 +1594,21 @@ BEGIN_COMMAND(wdlinfo)
 	if (stricmp(argv[1], "event") == 0)
 	{
 		int id = atoi(argv[2]);
-		if (id >= static_cast<int>(::wdlevents.size()))
+		if (id < 0 || id >= static_cast<int>(::wdlstate.eventcount))
 		{
 			PrintFmt(PRINT_HIGH, "Event number {} not found\n", id);
 			return;
 		}
-		WDLEvent evt = ::wdlevents.at(id);
-		PrintWDLEvent(evt);
+
+		// Only the most recent events are kept in memory.
+		const std::vector<WDLEvent> events = RecentWDLEvents();
+		const size_t first = ::wdlstate.eventcount - events.size();
+		if (static_cast<size_t>(id) < first)
+		{
+			PrintFmt(PRINT_HIGH, "Event number {} has already been written out\n", id);
+			return;
+		}
+		PrintWDLEvent(events.at(id - first));
 		return;
 	}
 
@@ -3757,8 +3757,8 @@ void DLevelScript::RunScript ()
 			break;
 
 		case PCD_GETCVAR: {
-			cvar_t *var, *prev;
-			var = cvar_t::FindCVar(level.behavior->LookupString(STACK(1)), &prev);
+			cvar_t *var;
+			var = cvar_t::FindCVar(level.behavior->LookupString(STACK(1)));
 			if (var == NULL)
 			{
 				STACK(1) = 0;
@@ -130,55 +130,153 @@ extern bool isFast;
 
 
 //
-// Called by P_NoiseAlert.
-// Recursively traverse adjacent sectors,
-// sound blocking lines cut off traversal.
+// Sound propagation
 //
-
-void P_RecursiveSound (sector_t *sec, int soundblocks, AActor *soundtarget)
+// Each sector's two-sided neighbours are gathered once per level so that
+// P_NoiseAlert can flood them from an explicit stack.  Line flags are still
+// read at alert time since specials can toggle ML_SOUNDBLOCK.
+//
+struct soundlink_t
 {
-	int 		i;
-	line_t* 	check;
+	line_t*		line;
 	sector_t*	other;
+};
+
+static std::vector<soundlink_t> soundlinks;
+static std::vector<size_t> soundlinkstart;	// numsectors + 1 offsets
+
+struct soundflood_t
+{
+	sector_t*	sector;
+	int			soundblocks;
+};
+
+static std::vector<soundflood_t> soundstack;
+
+// The last flood made this tic.  Flooding again from the same sector for
+// the same target over unchanged geometry writes back exactly the same
+// values, so such a repeat is skipped.
+static struct
+{
+	int				time;
+	const sector_t*	sector;
+	const AActor*	target;
+	unsigned int	generation;
+} lastnoise = { -1, NULL, NULL, 0 };
+
+static unsigned int noisegeneration = 1;
+
+//
+// P_InvalidateNoiseAlerts
+// Called when a sector plane, a line's flags or a sector's sound state
+// changes, so that the next alert floods even if it repeats the last one.
+//
+void P_InvalidateNoiseAlerts()
+{
+	noisegeneration++;
+}
+
+//
+// P_BuildSoundLinks
+// Builds the sector adjacency used by P_NoiseAlert.  Must be called after
+// P_GroupLines.
+//
+void P_BuildSoundLinks()
+{
+	soundlinks.clear();
+	soundlinkstart.resize(numsectors + 1);
 
-	// wake up all monsters in this sector
-	if (sec->validcount == validcount
-		&& sec->soundtraversed <= soundblocks+1)
+	for (int s = 0; s < numsectors; s++)
 	{
-		return; 		// already flooded
+		sector_t* sec = &sectors[s];
+		soundlinkstart[s] = soundlinks.size();
+
+		for (int i = 0; i < sec->linecount; i++)
+		{
+			line_t* check = sec->lines[i];
+			if (check->sidenum[1] == R_NOSIDE)
+				continue;
+
+			soundlink_t link;
+			link.line = check;
+			if (sides[check->sidenum[0]].sector == sec)
+				link.other = sides[check->sidenum[1]].sector;
+			else
+				link.other = sides[check->sidenum[0]].sector;
+
+			soundlinks.push_back(link);
+		}
 	}
 
-	sec->validcount = validcount;
-	sec->soundtraversed = soundblocks+1;
-	sec->soundtarget = soundtarget->ptr();
+	soundlinkstart[numsectors] = soundlinks.size();
 
-	for (i=0 ;i<sec->linecount ; i++)
+	lastnoise.time = -1;
+	lastnoise.sector = NULL;
+	lastnoise.target = NULL;
+	noisegeneration++;
+}
+
+//
+// Called by P_NoiseAlert.
+// Traverse adjacent sectors,
+// sound blocking lines cut off traversal.
+//
+// A sector reached again with fewer sound blocks is flooded again, so the
+// final soundtraversed values do not depend on the visiting order and match
+// the recursive vanilla version.
+//
+static void P_FloodSound (sector_t *start, AActor *soundtarget)
+{
+	soundstack.clear();
+
+	soundflood_t first = { start, 0 };
+	soundstack.push_back(first);
+
+	while (!soundstack.empty())
 	{
-		check = sec->lines[i];
-		if (! (check->flags & ML_TWOSIDED) )
-			continue;
+		const soundflood_t cur = soundstack.back();
+		soundstack.pop_back();
 
-		if ( sides[ check->sidenum[0] ].sector == sec)
-			other = sides[ check->sidenum[1] ] .sector;
-		else
-			other = sides[ check->sidenum[0] ].sector;
+		sector_t* sec = cur.sector;
+		const int soundblocks = cur.soundblocks;
 
-		// [SL] 2012-02-08 - FIXME: Currently only checks for a line opening at
-		// midpoint of a sloped linedef.  P_RecursiveSound() in ZDoom 1.23 causes
-		// demo desyncs.
-		P_LineOpening(check, (check->v1->x >> 1) + (check->v2->x >> 1),
-							 (check->v1->y >> 1) + (check->v2->y >> 1));
+		// wake up all monsters in this sector
+		if (sec->validcount == validcount
+			&& sec->soundtraversed <= soundblocks+1)
+		{
+			continue; 		// already flooded
+		}
 
-		if (openrange <= 0)
-			continue;	// closed door
+		sec->validcount = validcount;
+		sec->soundtraversed = soundblocks+1;
+		sec->soundtarget = soundtarget->ptr();
 
-		if (check->flags & ML_SOUNDBLOCK)
+		const size_t s = sec - sectors;
+		for (size_t i = soundlinkstart[s]; i < soundlinkstart[s + 1]; i++)
 		{
-			if (!soundblocks)
-				P_RecursiveSound (other, 1, soundtarget);
+			const line_t* check = soundlinks[i].line;
+			if (! (check->flags & ML_TWOSIDED) )
+				continue;
+
+			// [SL] 2012-02-08 - FIXME: Currently only checks for a line opening at
+			// midpoint of a sloped linedef.  P_RecursiveSound() in ZDoom 1.23 causes
+			// demo desyncs.
+			P_LineOpening(check, (check->v1->x >> 1) + (check->v2->x >> 1),
+								 (check->v1->y >> 1) + (check->v2->y >> 1));
+
+			if (openrange <= 0)
+				continue;	// closed door
+
+			soundflood_t next = { soundlinks[i].other, soundblocks };
+			if (check->flags & ML_SOUNDBLOCK)
+			{
+				if (soundblocks)
+					continue;
+				next.soundblocks = 1;
+			}
+
+			soundstack.push_back(next);
 		}
-		else
-			P_RecursiveSound (other, soundblocks, soundtarget);
 	}
 }
 
@@ -194,8 +292,21 @@ void P_NoiseAlert (AActor *target, AActor *emmiter)
 	if (target->player && (!multiplayer && (target->player->cheats & CF_NOTARGET)))
 		return;
 
+	sector_t* sec = emmiter->subsector->sector;
+
+	if (lastnoise.time == level.time && lastnoise.sector == sec &&
+		lastnoise.target == target && lastnoise.generation == noisegeneration)
+	{
+		return;
+	}
+
 	validcount++;
-	P_RecursiveSound (emmiter->subsector->sector, 0, target);
+	P_FloodSound (sec, target);
+
+	lastnoise.time = level.time;
+	lastnoise.sector = sec;
+	lastnoise.target = target;
+	lastnoise.generation = noisegeneration;
 }
 
 
@@ -1426,6 +1426,9 @@ FUNC(LS_Line_SetBlocking)
 			lines[s].flags = (lines[s].flags & ~clearflags) | setflags;
 		}
 
+		// ML_SOUNDBLOCK may have changed
+		P_InvalidateNoiseAlerts();
+
 		return true;
 	}
 	return false;
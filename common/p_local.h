@@ -152,6 +152,8 @@ bool	P_DeactivateMobj (AActor *mobj);
 // P_ENEMY
 //
 void	P_NoiseAlert (AActor* target, AActor* emmiter);
+void	P_BuildSoundLinks ();
+void	P_InvalidateNoiseAlerts ();
 void	P_SpawnBrainTargets(void);	// killough 3/26/98: spawn icon landings
 
 extern struct brain_s {				// killough 3/26/98: global state of boss brain
@@ -214,6 +216,9 @@ void P_LineOpening (const line_t *linedef, fixed_t x, fixed_t y, fixed_t refx=li
 
 bool P_BlockLinesIterator (int x, int y, bool(*func)(line_t*) );
 bool P_BlockThingsIterator (int x, int y, bool(*func)(AActor*), AActor *start=NULL);
+AActor* P_BlockFirstThing (int x, int y);
+void P_InitBlockLinks ();
+void P_CompactBlockLinks ();
 
 #define PT_ADDLINES 	1
 #define PT_ADDTHINGS	2
@@ -298,6 +303,9 @@ v3fixed_t P_LinePlaneIntersection(const plane_t *plane, const v3fixed_t &lineorg
 
 
 bool P_CheckSightEdges(const AActor* t1, const AActor* t2, float radius_boost);
+void P_InvalidateSightCache();
+void P_BuildSightComponents();
+void P_ClearSightComponents();
 bool P_SpecialIsWeapon(AActor* special);
 
 bool	P_ChangeSector (sector_t* sector, int crunch);
@@ -334,7 +342,24 @@ extern int				bmapwidth;
 extern int				bmapheight; 	// in mapblocks
 extern fixed_t			bmaporgx;
 extern fixed_t			bmaporgy;		// origin of block map
-extern AActor** 		blocklinks; 	// for thing chains
+
+//
+// blocklinks_t
+//
+// The actors overlapping a mapblock, packed in the order they were linked.
+// Iteration runs newest-first like the old linked lists.  Unlinking leaves a
+// NULL hole so iterators in flight keep their place; P_CompactBlockLinks
+// squeezes the holes out once per tic.
+//
+struct blocklinks_t
+{
+	std::vector<AActor*> actors;
+	size_t holes;
+
+	blocklinks_t() : holes(0) { }
+};
+
+extern std::vector<blocklinks_t> blocklinks;	// for thing chains
 
 extern std::set<short>	movable_sectors;
 
@@ -3261,7 +3261,7 @@ void P_RadiusAttack(AActor *spot, AActor *source, int damage, int distance,
 		{
 			for (int x=xl ; x<=xh ; x++)
 			{
-				AActor *mobj = blocklinks[y*bmapwidth+x];
+				AActor *mobj = P_BlockFirstThing(x, y);
 				while (mobj)
 				{
 					actorset.insert(mobj);
@@ -3918,6 +3918,9 @@ void P_ChangeCeilingHeight(sector_t *sector, fixed_t amount)
 	if (!sector)
 		return;
 
+	P_InvalidateSightCache();
+	P_InvalidateNoiseAlerts();
+
 	plane_t *plane = &sector->ceilingplane;
 	plane->d -= FixedMul(amount, plane->c);
 
@@ -3931,6 +3934,9 @@ void P_ChangeFloorHeight(sector_t *sector, fixed_t amount)
 	if (!sector)
 		return;
 
+	P_InvalidateSightCache();
+	P_InvalidateNoiseAlerts();
+
 	plane_t *plane = &sector->floorplane;
 	plane->d -= FixedMul(amount, plane->c);
 
@@ -4076,6 +4082,8 @@ void P_CopySector(sector_t *dest, sector_t *src)
 	if (!dest || !src)
 		return;
 
+	P_InvalidateNoiseAlerts();
+
 	dest->floorheight			= src->floorheight;
 	dest->ceilingheight			= src->ceilingheight;
 	dest->floorpic				= src->floorpic;
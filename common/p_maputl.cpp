@@ -99,6 +99,9 @@ subsector_t* P_PointInSubsector(fixed_t x, fixed_t y)
 }
 
 
+// mapblocks that have had an actor unlinked since the last compaction
+static std::vector<size_t> dirtyblocks;
+
 AActor::ActorBlockMapListNode::ActorBlockMapListNode(AActor *mo) :
 	actor(mo)
 {
@@ -142,22 +145,12 @@ void AActor::ActorBlockMapListNode::Link()
 		{
 			for (int bmx = left; bmx <= right; bmx++)
 			{
-				// killough 8/11/98: simpler scheme using pointer-to-pointer prev
-				// pointers, allows head nodes to be treated like everything else
-
-				AActor **headptr = &blocklinks[bmy * bmapwidth + bmx];
-				AActor *headactor = *headptr;
+				// newest actors go on the end of the array and are
+				// visited first, as they were at the head of the old lists
+				std::vector<AActor*>& actors = blocklinks[bmy * bmapwidth + bmx].actors;
 
-				size_t thisidx = getIndex(bmx, bmy);
-
-		        if ((next[thisidx] = headactor))
-		        {
-		        	size_t nextidx = headactor->bmapnode.getIndex(bmx, bmy);
-					headactor->bmapnode.prev[nextidx] = &next[thisidx];
-				}
-
-		        prev[thisidx] = headptr;
-		        *headptr = actor;
+				slot[getIndex(bmx, bmy)] = actors.size();
+				actors.push_back(actor);
 			}
 		}
 	}
@@ -173,23 +166,21 @@ void AActor::ActorBlockMapListNode::Unlink()
 	{
 		for (int bmx = originx; bmx < originx + blockcntx; bmx++)
 		{
-			// killough 8/11/98: simpler scheme using pointers-to-pointers for prev
-			// pointers, allows head node pointers to be treated like everything else
-			//
-			// Also more robust, since it doesn't depend on current position for
-			// unlinking. Old method required computing head node based on position
-			// at time of unlinking, assuming it was the same position as during
-			// linking.
-
-			size_t thisidx = getIndex(bmx, bmy);
+			// Leave a hole rather than moving the other actors so that an
+			// iterator currently walking this block keeps its place.  The
+			// slot is kept too, so Next() still works on an unlinked actor.
+			const size_t index = bmy * bmapwidth + bmx;
+			if (index >= blocklinks.size())
+				continue;
 
-			AActor *nextactor = next[thisidx];
-			AActor **prevactor = prev[thisidx];
+			blocklinks_t& block = blocklinks[index];
+			const size_t thisslot = slot[getIndex(bmx, bmy)];
 
-			if (prevactor && (*prevactor = nextactor))
+			if (thisslot < block.actors.size() && block.actors[thisslot] == actor)
 			{
-				size_t nextidx = nextactor->bmapnode.getIndex(bmx, bmy);
-				nextactor->bmapnode.prev[nextidx] = prevactor;
+				block.actors[thisslot] = NULL;
+				if (block.holes++ == 0)
+					dirtyblocks.push_back(index);
 			}
 		}
 	}
@@ -200,15 +191,28 @@ AActor* AActor::ActorBlockMapListNode::Next(int bmx, int bmy)
 	if (bmx < 0 || bmx >= bmapwidth || bmy < 0 || bmy >= bmapheight)
 		return NULL;
 
-	return next[getIndex(bmx, bmy)];
+	const std::vector<AActor*>& actors = blocklinks[bmy * bmapwidth + bmx].actors;
+
+	size_t i = std::min(slot[getIndex(bmx, bmy)], actors.size());
+	while (i-- > 0)
+	{
+		if (actors[i])
+			return actors[i];
+	}
+
+	return NULL;
+}
+
+void AActor::ActorBlockMapListNode::Relocate(int bmx, int bmy, size_t newslot)
+{
+	slot[getIndex(bmx, bmy)] = newslot;
 }
 
 void AActor::ActorBlockMapListNode::clear()
 {
 	originx = originy = 0;
 	blockcntx = blockcnty = 0;
-	memset(prev, 0, sizeof(prev));
-	memset(next, 0, sizeof(next));
+	memset(slot, 0, sizeof(slot));
 }
 
 size_t AActor::ActorBlockMapListNode::getIndex(int bmx, int bmy)
@@ -224,6 +228,55 @@ size_t AActor::ActorBlockMapListNode::getIndex(int bmx, int bmy)
 	return (bmy - originy) * BLOCKSX + bmx - originx;
 }
 
+//
+// P_InitBlockLinks
+// Empties the actor arrays for a freshly loaded blockmap.
+//
+void P_InitBlockLinks()
+{
+	blocklinks.clear();
+	blocklinks.resize(bmapwidth * bmapheight);
+	dirtyblocks.clear();
+}
+
+//
+// P_CompactBlockLinks
+// Removes the holes left by unlinked actors, preserving the order of the
+// remaining ones.  Must not be called while a block is being iterated.
+//
+void P_CompactBlockLinks()
+{
+	for (size_t index : dirtyblocks)
+	{
+		if (index >= blocklinks.size())
+			continue;
+
+		blocklinks_t& block = blocklinks[index];
+		const int bmx = index % bmapwidth;
+		const int bmy = index / bmapwidth;
+
+		size_t out = 0;
+		for (size_t in = 0; in < block.actors.size(); in++)
+		{
+			AActor* mo = block.actors[in];
+			if (mo == NULL)
+				continue;
+
+			if (out != in)
+			{
+				block.actors[out] = mo;
+				mo->bmapnode.Relocate(bmx, bmy, out);
+			}
+			out++;
+		}
+
+		block.actors.resize(out);
+		block.holes = 0;
+	}
+
+	dirtyblocks.clear();
+}
+
 
 //
 // P_AproxDistance
@@ -711,6 +764,26 @@ bool P_BlockLinesIterator (int x, int y, bool(*func)(line_t*))
 }
 
 
+//
+// P_BlockFirstThing
+// Returns the most recently linked actor in a mapblock.
+//
+AActor* P_BlockFirstThing(int x, int y)
+{
+	if (x<0 || y<0 || x>=bmapwidth || y>=bmapheight)
+		return NULL;
+
+	const std::vector<AActor*>& actors = blocklinks[y*bmapwidth+x].actors;
+	for (size_t i = actors.size(); i-- > 0; )
+	{
+		if (actors[i])
+			return actors[i];
+	}
+
+	return NULL;
+}
+
+
 //
 // P_BlockThingsIterator
 //
@@ -720,7 +793,7 @@ bool P_BlockThingsIterator (int x, int y, bool(*func)(AActor*), AActor *actor)
 		return true;
 	else
  	{
-		AActor *mobj = (actor != NULL ? actor : blocklinks[y*bmapwidth+x]);
+		AActor *mobj = (actor != NULL ? actor : P_BlockFirstThing(x, y));
 		while (mobj)
  		{
  			if (!func (mobj))
@@ -1210,7 +1283,7 @@ AActor* RoughMonsterCheck(AActor* mo, int index, angle_t fov)
 {
 	const int bx = index % bmapwidth;
 	const int by = index / bmapwidth;
-	for (AActor* link = blocklinks[index]; link != nullptr; link = link->bmapnode.Next(bx, by))
+	for (AActor* link = P_BlockFirstThing(bx, by); link != nullptr; link = link->bmapnode.Next(bx, by))
 	{
 		// skip non-shootable actors
 		if (!(link->flags & MF_SHOOTABLE))
@@ -1261,7 +1334,7 @@ AActor* RoughTracerCheck(AActor* mo, int index, angle_t fov)
 {
 	const int bx = index % bmapwidth;
 	const int by = index / bmapwidth;
-	for (AActor* link = blocklinks[index]; link != nullptr; link = link->bmapnode.Next(bx, by))
+	for (AActor* link = P_BlockFirstThing(bx, by); link != nullptr; link = link->bmapnode.Next(bx, by))
 	{
 		// skip non-shootable actors
 		if (!(link->flags & MF_SHOOTABLE))
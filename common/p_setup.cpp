@@ -129,7 +129,7 @@ int				*blockmaplump;	// offsets in blockmap are from here
 fixed_t 		bmaporgx;		// origin of block map
 fixed_t 		bmaporgy;
 
-AActor**		blocklinks;		// for thing chains
+std::vector<blocklinks_t> blocklinks;	// for thing chains
 
 
 
@@ -164,7 +164,6 @@ bool cmpPlayerNum(mapthing2_t i, mapthing2_t j)
 //
 void P_LoadVertexes (int lump)
 {
-	byte *data;
 	int i;
 
 	// Determine number of vertices:
@@ -174,19 +173,17 @@ void P_LoadVertexes (int lump)
 	// Allocate zone memory for buffer.
 	vertexes = (vertex_t *)Z_Malloc (numvertexes*sizeof(vertex_t), PU_LEVEL, 0);
 
-	// Load data into cache.
-	data = (byte *)W_CacheLumpNum (lump, PU_STATIC);
+	// Read the lump in place.
+	OLumpView lumpdata(lump);
+	const byte* data = lumpdata.data();
 
 	// Copy and convert vertex coordinates,
 	// internal representation as fixed.
 	for (i = 0; i < numvertexes; i++)
 	{
-		vertexes[i].x = LESHORT(((mapvertex_t *)data)[i].x)<<FRACBITS;
-		vertexes[i].y = LESHORT(((mapvertex_t *)data)[i].y)<<FRACBITS;
+		vertexes[i].x = LESHORT(((const mapvertex_t *)data)[i].x)<<FRACBITS;
+		vertexes[i].y = LESHORT(((const mapvertex_t *)data)[i].y)<<FRACBITS;
 	}
-
-	// Free buffer memory.
-	Z_Free (data);
 }
 
 void P_LoadSegsHelper(int side, short angle, int linedef, seg_t *li)
@@ -242,22 +239,21 @@ void P_LoadSegs (int lump, bool isdeepbsp = false)
 		    "P_LoadSegs: SEGS lump is empty - levels without nodes are not supported.");
 	}
 
-	byte* data;
-
 	if (isdeepbsp)
 		numsegs = W_LumpLength (lump) / sizeof(mapseg_deepbsp_t);
 	else
 		numsegs = W_LumpLength (lump) / sizeof(mapseg_t);
 	segs = (seg_t *)Z_Malloc (numsegs*sizeof(seg_t), PU_LEVEL, 0);
 	memset (segs, 0, numsegs*sizeof(seg_t));
-	data = (byte*)W_CacheLumpNum (lump, PU_STATIC);
+	OLumpView lumpdata(lump);
+	const byte* data = lumpdata.data();
 
 	for (int i = 0; i < numsegs; i++)
 	{
 		seg_t *li = segs+i;
 		if (isdeepbsp)
 		{
-			const mapseg_deepbsp_t *ml = (mapseg_deepbsp_t*) data+i;
+			const mapseg_deepbsp_t *ml = (const mapseg_deepbsp_t*) data+i;
 			uint32_t v = LELONG(ml->v1);
 
 			if(v >= numvertexes)
@@ -276,7 +272,7 @@ void P_LoadSegs (int lump, bool isdeepbsp = false)
 		}
 		else
 		{
-			const mapseg_t *ml = (mapseg_t*) data+i;
+			const mapseg_t *ml = (const mapseg_t*) data+i;
 			uint16_t v = LESHORT(ml->v1);
 
 			if(v >= numvertexes)
@@ -294,8 +290,6 @@ void P_LoadSegs (int lump, bool isdeepbsp = false)
 			P_LoadSegsHelper(LESHORT(ml->side), LESHORT(ml->angle), LESHORT(ml->linedef), li);
 		}
 	}
-
-	Z_Free (data);
 }
 
 //
@@ -309,7 +303,6 @@ void P_LoadSubsectors(int lump, bool isdeepbsp = false)
 		    "P_LoadSubsectors: SSECTORS lump is empty - levels without nodes are not supported.");
 	}
 
-	byte *data;
 	int i;
 
 	if (isdeepbsp)
@@ -317,27 +310,26 @@ void P_LoadSubsectors(int lump, bool isdeepbsp = false)
 	else
 		numsubsectors = W_LumpLength (lump) / sizeof(mapsubsector_t);
 	subsectors = (subsector_t *)Z_Malloc (numsubsectors*sizeof(subsector_t),PU_LEVEL,0);
-	data = (byte *)W_CacheLumpNum (lump,PU_STATIC);
+	OLumpView lumpdata(lump);
+	const byte* data = lumpdata.data();
 
 	memset (subsectors, 0, numsubsectors*sizeof(subsector_t));
 
 	if (isdeepbsp) {
 		for (i = 0; i < numsubsectors; i++)
 		{
-			subsectors[i].numlines = (uint32_t)LESHORT(((mapsubsector_deepbsp_t *)data)[i].numsegs);
-			subsectors[i].firstline = (uint32_t)LELONG(((mapsubsector_deepbsp_t *)data)[i].firstseg);
+			subsectors[i].numlines = (uint32_t)LESHORT(((const mapsubsector_deepbsp_t *)data)[i].numsegs);
+			subsectors[i].firstline = (uint32_t)LELONG(((const mapsubsector_deepbsp_t *)data)[i].firstseg);
 		}
 	}
 	else
 	{
 		for (i = 0; i < numsubsectors; i++)
 		{
-			subsectors[i].numlines = (uint16_t)LESHORT(((mapsubsector_t *)data)[i].numsegs);
-			subsectors[i].firstline = (uint16_t)LESHORT(((mapsubsector_t *)data)[i].firstseg);
+			subsectors[i].numlines = (uint16_t)LESHORT(((const mapsubsector_t *)data)[i].numsegs);
+			subsectors[i].firstline = (uint16_t)LESHORT(((const mapsubsector_t *)data)[i].firstseg);
 		}
 	}
-
-	Z_Free(data);
 }
 
 
@@ -356,11 +348,11 @@ void P_LoadSectors (int lump)
 	// denis - properly construct sectors so that smart pointers they contain don't get screwed
 	sectors = new sector_t[numsectors];
 
-	byte* data = (byte*)W_CacheLumpNum(lump, PU_STATIC);
+	OLumpView lumpdata(lump);
 
 	const int defSeqType = (level.flags & LEVEL_SNDSEQTOTALCTRL) ? 0 : -1;
 
-	mapsector_t* ms = (mapsector_t*)data;
+	const mapsector_t* ms = (const mapsector_t*)lumpdata.data();
 	sector_t* ss = sectors;
 	for (int i = 0; i < numsectors; i++, ss++, ms++)
 	{
@@ -434,8 +426,6 @@ void P_LoadSectors (int lump)
 		ss->friction = ORIG_FRICTION;
 		ss->movefactor = ORIG_FRICTION_FACTOR;
 	}
-
-	Z_Free (data);
 }
 
 enum class nodetype_t {
@@ -496,9 +486,9 @@ void P_LoadNodes (int lump)
 
 	numnodes = W_LumpLength (lump) / sizeof(mapnode_t);
 	nodes = (node_t *)Z_Malloc (numnodes*sizeof(node_t), PU_LEVEL, 0);
-	byte* data = (byte *)W_CacheLumpNum (lump, PU_STATIC);
+	OLumpView lumpdata(lump);
 
-	mapnode_t* mn = (mapnode_t *)data;
+	const mapnode_t* mn = (const mapnode_t *)lumpdata.data();
 	node_t* no = nodes;
 
 	for (int i = 0; i < numnodes; i++, no++, mn++)
@@ -523,8 +513,6 @@ void P_LoadNodes (int lump)
 				no->bbox[j][k] = LESHORT(mn->bbox[j][k]) << FRACBITS;
 		}
 	}
-
-	Z_Free (data);
 }
 
 //
@@ -538,17 +526,15 @@ void P_LoadNodes_DeePBSP(int lump)
 		    "P_LoadNodes_DeePBSP: NODES lump is empty - levels without nodes are not supported.");
 	}
 
-	byte*		data;
-	mapnode_deepbsp_t*	mn;
+	const mapnode_deepbsp_t*	mn;
 	node_t* 	no;
 
 	numnodes = (W_LumpLength (lump) - 8) / sizeof(mapnode_deepbsp_t);
 	nodes = (node_t *)Z_Malloc (numnodes*sizeof(node_t), PU_LEVEL, 0);
-	data = (byte*) W_CacheLumpNum (lump, PU_STATIC);
-
-	data += 8;
+	OLumpView lumpdata(lump);
 
-	mn = (mapnode_deepbsp_t *)data;
+	// skip the "xNd4\0\0\0\0" signature
+	mn = (const mapnode_deepbsp_t *)(lumpdata.data() + 8);
 	no = nodes;
 
 	for (int i = 0; i < numnodes; i++, mn++, no++)
@@ -565,8 +551,6 @@ void P_LoadNodes_DeePBSP(int lump)
 				no->bbox[j][k] = LESHORT(mn->bbox[j][k]) << FRACBITS;
 		}
 	}
-
-	Z_Free (data - 8);
 }
 
 byte* P_DecompressNodes(byte* data, size_t len) {
@@ -891,9 +875,9 @@ void P_LoadExtendedNodes(int lump, nodetype_t nodetype)
 void P_LoadThings (int lump)
 {
 	mapthing2_t mt2;		// [RH] for translation
-	byte *data = (byte *)W_CacheLumpNum (lump, PU_STATIC);
-	mapthing_t *mt = (mapthing_t *)data;
-	mapthing_t *lastmt = (mapthing_t *)(data + W_LumpLength (lump));
+	OLumpView lumpdata(lump);
+	const mapthing_t *mt = (const mapthing_t *)lumpdata.data();
+	const mapthing_t *lastmt = (const mapthing_t *)(lumpdata.data() + lumpdata.size());
 
 	P_HordeClearSpawns();
 	playerstarts.clear();
@@ -952,8 +936,6 @@ void P_LoadThings (int lump)
 	std::sort(playerstarts.begin(), playerstarts.end(), cmpPlayerNum);
 
 	P_SpawnAvatars();
-
-	Z_Free (data);
 }
 
 // [RH]
@@ -1169,14 +1151,14 @@ void P_FinishLoadingLineDefs (void)
 
 void P_LoadLineDefs (const int lump)
 {
-	byte *data;
 	int i;
 	line_t *ld;
 
 	numlines = W_LumpLength (lump) / sizeof(maplinedef_t);
 	lines = (line_t *)Z_Malloc (numlines*sizeof(line_t), PU_LEVEL, 0);
 	memset (lines, 0, numlines*sizeof(line_t));
-	data = (byte *)W_CacheLumpNum (lump, PU_STATIC);
+	OLumpView lumpdata(lump);
+	const byte* data = lumpdata.data();
 
 	// [Blair] Don't mind me, just hackin'
 	// E2M7 has flags masked in that interfere with MBF21 flags.
@@ -1189,7 +1171,7 @@ void P_LoadLineDefs (const int lump)
 	ld = lines;
 	for (i=0 ; i<numlines ; i++, ld++)
 	{
-		const maplinedef_t *mld = ((maplinedef_t *)data) + i;
+		const maplinedef_t *mld = ((const maplinedef_t *)data) + i;
 
 		ld->flags = (unsigned short)(short int)mld->flags;
 		ld->special = (short int)mld->special;
@@ -1226,24 +1208,21 @@ void P_LoadLineDefs (const int lump)
 
 		P_AdjustLine (ld);
 	}
-
-	Z_Free (data);
 }
 
 // [RH] Same as P_LoadLineDefs() except it uses Hexen-style LineDefs.
 void P_LoadLineDefs2 (int lump)
 {
-	byte*				data;
 	int 				i;
-	maplinedef2_t*		mld;
+	const maplinedef2_t*	mld;
 	line_t* 			ld;
 
 	numlines = W_LumpLength (lump) / sizeof(maplinedef2_t);
 	lines = (line_t *)Z_Malloc (numlines*sizeof(line_t), PU_LEVEL,0 );
 	memset (lines, 0, numlines*sizeof(line_t));
-	data = (byte *)W_CacheLumpNum (lump, PU_STATIC);
+	OLumpView lumpdata(lump);
 
-	mld = (maplinedef2_t *)data;
+	mld = (const maplinedef2_t *)lumpdata.data();
 	ld = lines;
 	for (i = 0; i < numlines; i++, mld++, ld++)
 	{
@@ -1281,8 +1260,6 @@ void P_LoadLineDefs2 (int lump)
 
 		P_AdjustLine (ld);
 	}
-
-	Z_Free (data);
 }
 
 //
@@ -1683,7 +1660,8 @@ void P_LoadBlockMap (int lump)
 		P_CreateBlockMap();
 	else
 	{
-		short *wadblockmaplump = (short *)W_CacheLumpNum (lump, PU_LEVEL);
+		OLumpView lumpdata(lump);
+		const short *wadblockmaplump = (const short *)lumpdata.data();
 		int i;
 		blockmaplump = (int *)Z_Malloc(sizeof(*blockmaplump) * count, PU_LEVEL, 0);
 
@@ -1702,8 +1680,6 @@ void P_LoadBlockMap (int lump)
 			short t = LESHORT(wadblockmaplump[i]);          // killough 3/1/98
 			blockmaplump[i] = t == -1 ? (DWORD)0xffffffff : (DWORD) t & 0xffff;
 		}
-
-		Z_Free (wadblockmaplump);
 	}
 
 	bmaporgx = blockmaplump[0]<<FRACBITS;
@@ -1712,9 +1688,7 @@ void P_LoadBlockMap (int lump)
 	bmapheight = blockmaplump[3];
 
 	// clear out mobj chains
-	count = sizeof(*blocklinks) * bmapwidth*bmapheight;
-	blocklinks = (AActor **)Z_Malloc (count, PU_LEVEL, 0);
-	memset (blocklinks, 0, count);
+	P_InitBlockLinks();
 	blockmap = blockmaplump+4;
 }
 
@@ -2257,6 +2231,16 @@ void P_SetupLevel (const char *lumpname, int position)
 	if (!demoplayback)
 		P_RemoveSlimeTrails();
 
+	P_BuildSoundLinks();
+
+	// sector connectivity is only built for levels whose sectors are all
+	// closed, where it agrees with the traversal; keep demos on the exact
+	// original traversal anyway
+	if (!demoplayback)
+		P_BuildSightComponents();
+	else
+		P_ClearSightComponents();
+
 	P_SetupSlopes();
 
     po_NumPolyobjs = 0;
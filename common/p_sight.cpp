@@ -29,6 +29,7 @@
 
 
 #include "i_system.h"
+#include "hashtable.h"
 #include "p_local.h"
 #include "m_random.h"
 #include "m_vectors.h"
@@ -53,6 +54,234 @@ int		sightcounts2[3];
 
 EXTERN_CVAR (co_zdoomphys)
 
+//
+// Sight cache
+//
+// Monsters repeat the same check several times in a tic (A_Look, A_Chase,
+// the attack codepointer) and a slaughter map does it for hundreds of them.
+// Every input to the traversal is part of the key, so a hit returns exactly
+// what the traversal would have.  Entries are stamped with a generation that
+// advances every tic and whenever a floor, ceiling or polyobject moves.
+//
+enum sightmode_t
+{
+	SIGHT_DOOM,
+	SIGHT_ZDOOM,
+	SIGHT_EDGES_DOOM,
+	SIGHT_EDGES_ZDOOM
+};
+
+struct SightCacheKey
+{
+	const subsector_t	*ss1, *ss2;
+	fixed_t				x1, y1, z1, h1;
+	fixed_t				x2, y2, z2, h2, r2;
+	float				boost;
+	int					mode;
+
+	SightCacheKey() :
+		ss1(NULL), ss2(NULL), x1(0), y1(0), z1(0), h1(0),
+		x2(0), y2(0), z2(0), h2(0), r2(0), boost(0.0f), mode(-1)
+	{ }
+
+	SightCacheKey(sightmode_t m, const AActor* t1, const AActor* t2, float b) :
+		ss1(t1->subsector), ss2(t2->subsector),
+		x1(t1->x), y1(t1->y), z1(t1->z), h1(t1->height),
+		x2(t2->x), y2(t2->y), z2(t2->z), h2(t2->height), r2(t2->radius),
+		boost(b), mode(m)
+	{ }
+
+	bool operator==(const SightCacheKey& other) const
+	{
+		return ss1 == other.ss1 && ss2 == other.ss2 &&
+		       x1 == other.x1 && y1 == other.y1 && z1 == other.z1 && h1 == other.h1 &&
+		       x2 == other.x2 && y2 == other.y2 && z2 == other.z2 && h2 == other.h2 &&
+		       r2 == other.r2 && boost == other.boost && mode == other.mode;
+	}
+
+	bool operator!=(const SightCacheKey& other) const
+	{
+		return !(*this == other);
+	}
+};
+
+struct SightCacheHash
+{
+	unsigned int operator()(const SightCacheKey& key) const
+	{
+		hashfunc<const void*> hashptr;
+		hashfunc<unsigned int> hashint;
+
+		unsigned int hash = hashptr(key.ss1) ^ (hashptr(key.ss2) * 31) ^ key.mode;
+		hash = hashint(hash ^ key.x1) ^ key.y1;
+		hash = hashint(hash ^ key.z1) ^ key.x2;
+		hash = hashint(hash ^ key.y2) ^ key.z2;
+		return hashint(hash);
+	}
+};
+
+struct SightCacheEntry
+{
+	unsigned int	generation;
+	bool			result;
+
+	SightCacheEntry() : generation(0), result(false) { }
+};
+
+// keep the table from growing without bound on a busy map
+static const unsigned int SIGHTCACHE_MAXSIZE = 8192;
+
+static OHashTable<SightCacheKey, SightCacheEntry, SightCacheHash> sightcache;
+static unsigned int sightgeneration = 1;
+
+//
+// P_InvalidateSightCache
+// Forgets every cached sight check.  Called once per tic and whenever
+// level geometry that can block sight changes.
+//
+void P_InvalidateSightCache()
+{
+	sightgeneration++;
+}
+
+static bool P_LookupSightCache(const SightCacheKey& key, bool& result)
+{
+	auto it = sightcache.find(key);
+	if (it == sightcache.end() || it->second.generation != sightgeneration)
+		return false;
+
+	result = it->second.result;
+	return true;
+}
+
+static void P_StoreSightCache(const SightCacheKey& key, bool result)
+{
+	if (sightcache.size() >= SIGHTCACHE_MAXSIZE)
+		sightcache.clear();
+
+	SightCacheEntry& entry = sightcache[key];
+	entry.generation = sightgeneration;
+	entry.result = result;
+}
+
+//
+// Sector connectivity
+//
+// Sectors that are not joined by any chain of two-sided lines can never see
+// each other.  Maps with an empty or zero-filled REJECT lump get no trivial
+// rejection at all, so this table gives their sight checks an early out.
+//
+static std::vector<int> sightcomponent;
+
+static int P_FindSightComponent(int sec)
+{
+	while (sightcomponent[sec] != sec)
+	{
+		sightcomponent[sec] = sightcomponent[sightcomponent[sec]];
+		sec = sightcomponent[sec];
+	}
+	return sec;
+}
+
+//
+// P_SectorsClosed
+// Returns true if the boundary of every sector is made of closed loops, so
+// that a sight line can only pass between sectors by crossing a line.
+//
+static bool P_SectorsClosed()
+{
+	std::vector<byte> parity(numvertexes, 0);
+
+	for (int i = 0; i < numsectors; i++)
+	{
+		const sector_t* sector = &sectors[i];
+
+		for (int j = 0; j < sector->linecount; j++)
+		{
+			const line_t* line = sector->lines[j];
+			if (line->frontsector == line->backsector)
+				continue;
+
+			parity[line->v1 - vertexes] ^= 1;
+			parity[line->v2 - vertexes] ^= 1;
+		}
+
+		bool closed = true;
+		for (int j = 0; j < sector->linecount; j++)
+		{
+			const line_t* line = sector->lines[j];
+			if (parity[line->v1 - vertexes] || parity[line->v2 - vertexes])
+				closed = false;
+			parity[line->v1 - vertexes] = parity[line->v2 - vertexes] = 0;
+		}
+
+		if (!closed)
+			return false;
+	}
+
+	return true;
+}
+
+//
+// P_BuildSightComponents
+// Groups the sectors of the current level into connected areas.  Levels with
+// unclosed sectors are left without the table, since sight can leak through
+// their gaps and rejecting it would change what monsters see.
+//
+void P_BuildSightComponents()
+{
+	if (!P_SectorsClosed())
+	{
+		P_ClearSightComponents();
+		return;
+	}
+
+	sightcomponent.resize(numsectors);
+	for (int i = 0; i < numsectors; i++)
+		sightcomponent[i] = i;
+
+	for (int i = 0; i < numlines; i++)
+	{
+		const line_t* line = &lines[i];
+		if (!line->frontsector || !line->backsector)
+			continue;
+
+		int c1 = P_FindSightComponent(line->frontsector - sectors);
+		int c2 = P_FindSightComponent(line->backsector - sectors);
+		if (c1 != c2)
+			sightcomponent[c2] = c1;
+	}
+
+	for (int i = 0; i < numsectors; i++)
+		sightcomponent[i] = P_FindSightComponent(i);
+
+	sightcache.clear();
+}
+
+//
+// P_ClearSightComponents
+// Disables the connectivity check, e.g. for demo playback.
+//
+void P_ClearSightComponents()
+{
+	sightcomponent.clear();
+	sightcache.clear();
+}
+
+//
+// P_SectorsDisconnected
+// Returns true if the sectors s1 and s2 cannot possibly see each other,
+// using the REJECT lump and the sector connectivity table.
+//
+static bool P_SectorsDisconnected(int s1, int s2)
+{
+	const int pnum = s1 * numsectors + s2;
+	if (!rejectempty && rejectmatrix[pnum >> 3] & (1 << (pnum & 7)))
+		return true;
+
+	return !sightcomponent.empty() && sightcomponent[s1] != sightcomponent[s2];
+}
+
 /*
 ==============
 =
@@ -423,12 +652,11 @@ bool P_CheckSightZDoom(const AActor *t1, const AActor *t2)
 
 	const sector_t *s1 = t1->subsector->sector;
 	const sector_t *s2 = t2->subsector->sector;
-	int pnum = (s1 - sectors) * numsectors + (s2 - sectors);
 
 	//
 	// check for trivial rejection
 	//
-	if (!rejectempty && rejectmatrix[pnum>>3] & (1 << (pnum & 7))) {
+	if (P_SectorsDisconnected(s1 - sectors, s2 - sectors)) {
 		sightcounts2[0]++;
 		return false;			// can't possibly be connected
 	}
@@ -483,12 +711,11 @@ bool P_CheckSightEdgesZDoom(const AActor *t1, const AActor *t2, float radius_boo
 {
 	const sector_t *s1 = t1->subsector->sector;
 	const sector_t *s2 = t2->subsector->sector;
-	int pnum = (s1 - sectors) * numsectors + (s2 - sectors);
 
 	//
 	// check for trivial rejection
 	//
-	if (!rejectempty && rejectmatrix[pnum>>3] & (1 << (pnum & 7))) {
+	if (P_SectorsDisconnected(s1 - sectors, s2 - sectors)) {
 		sightcounts2[0]++;
 		return false;                   // can't possibly be connected
 	}
@@ -804,9 +1031,6 @@ bool P_CheckSightDoom(const AActor* t1, const AActor* t2)
 {
     int		s1;
     int		s2;
-    int		pnum;
-    int		bytenum;
-    int		bitnum;
 
 	if(!t1 || !t2 || !t1->subsector || !t2->subsector)
 		return false;
@@ -816,12 +1040,9 @@ bool P_CheckSightDoom(const AActor* t1, const AActor* t2)
     // Determine subsector entries in REJECT table.
     s1 = (t1->subsector->sector - sectors);
     s2 = (t2->subsector->sector - sectors);
-    pnum = s1*numsectors + s2;
-    bytenum = pnum>>3;
-    bitnum = 1 << (pnum&7);
 
     // Check in REJECT table.
-    if (!rejectempty && rejectmatrix[bytenum]&bitnum)
+    if (P_SectorsDisconnected(s1, s2))
     {
 		sightcounts[0]++;
 
@@ -862,21 +1083,15 @@ static bool P_CheckSightDoom
 {
     int		s1;
     int		s2;
-    int		pnum;
-    int		bytenum;
-    int		bitnum;
 
     // First check for trivial rejection.
 
     // Determine subsector entries in REJECT table.
     s1 = (P_PointInSubsector(x1, y1)->sector - sectors);
     s2 = (P_PointInSubsector(x2, y2)->sector - sectors);
-    pnum = s1*numsectors + s2;
-    bytenum = pnum>>3;
-    bitnum = 1 << (pnum&7);
 
     // Check in REJECT table.
-    if (!rejectempty && rejectmatrix[bytenum]&bitnum)
+    if (P_SectorsDisconnected(s1, s2))
     {
 		sightcounts[0]++;
 
@@ -907,10 +1122,23 @@ static bool P_CheckSightDoom
 
 bool P_CheckSight(const AActor* t1, const AActor* t2)
 {
-	if (co_zdoomphys || map_format.getZDoom())
-		return P_CheckSightZDoom(t1, t2);
+	if (!t1 || !t2 || !t1->subsector || !t2->subsector)
+		return false;
+
+	const bool zdoom = co_zdoomphys || map_format.getZDoom();
+	const SightCacheKey key(zdoom ? SIGHT_ZDOOM : SIGHT_DOOM, t1, t2, 0.0f);
+
+	bool result;
+	if (P_LookupSightCache(key, result))
+		return result;
+
+	if (zdoom)
+		result = P_CheckSightZDoom(t1, t2);
 	else
-		return P_CheckSightDoom(t1, t2);
+		result = P_CheckSightDoom(t1, t2);
+
+	P_StoreSightCache(key, result);
+	return result;
 }
 
 //
@@ -953,10 +1181,21 @@ bool P_CheckSightEdgesDoom
 
 bool P_CheckSightEdges(const AActor* t1, const AActor* t2, float radius_boost)
 {
-	if (co_zdoomphys || map_format.getZDoom())
-		return P_CheckSightEdgesZDoom(t1, t2, radius_boost);
+	const bool zdoom = co_zdoomphys || map_format.getZDoom();
+	const SightCacheKey key(zdoom ? SIGHT_EDGES_ZDOOM : SIGHT_EDGES_DOOM, t1, t2,
+	                        radius_boost);
+
+	bool result;
+	if (P_LookupSightCache(key, result))
+		return result;
+
+	if (zdoom)
+		result = P_CheckSightEdgesZDoom(t1, t2, radius_boost);
 	else
-		return P_CheckSightEdgesDoom(t1, t2, radius_boost);
+		result = P_CheckSightEdgesDoom(t1, t2, radius_boost);
+
+	P_StoreSightCache(key, result);
+	return result;
 }
 
 
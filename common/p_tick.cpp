@@ -60,6 +60,9 @@ void P_Ticker (void)
 	}
 #endif
 
+	// positions of anything may have changed since the last tic
+	P_InvalidateSightCache();
+
 	if (serverside)
 	{
 		P_RunHordeTics();
@@ -87,6 +90,9 @@ void P_Ticker (void)
 
 	DThinker::RunThinkers ();
 
+	// no block iteration is in flight between thinkers
+	P_CompactBlockLinks ();
+
 	P_UpdateSpecials ();
 	P_RespawnSpecials ();
 
@@ -37,6 +37,10 @@
 
 #include "novadoom.h"
 
+#include <algorithm>
+
+#include "c_dispatch.h"
+#include "i_system.h"
 #include "m_vectors.h"
 #include "p_unlag.h"
 #include "p_local.h"
@@ -51,14 +55,14 @@ EXTERN_CVAR(sv_maxunlagtime)
 
 Unlag::SectorHistoryRecord::SectorHistoryRecord()
 	:	sector(NULL), history_size(0),
-		history_ceilingheight(), history_floorheight(),
+		history_ceilingheight(), history_floorheight(), last_moved(0),
 		backup_ceilingheight(0), backup_floorheight(0)
 {
 }
 
 Unlag::SectorHistoryRecord::SectorHistoryRecord(sector_t *sec)
 	: 	sector(sec), history_size(Unlag::MAX_HISTORY_TICS),
-		history_ceilingheight(), history_floorheight(),
+		history_ceilingheight(), history_floorheight(), last_moved(gametic),
 		backup_ceilingheight(0), backup_floorheight(0)
 {
 	if (!sector)
@@ -90,6 +94,11 @@ Unlag& Unlag::getInstance()
 	return instance;
 }
 
+Unlag::Unlag() : player_history(), history_x(), history_y(), history_z(),
+	reconciled(false)
+{
+}
+
 Unlag::~Unlag()
 {
 	Unlag::reset();
@@ -154,8 +163,11 @@ void Unlag::moveSector(sector_t *sector, fixed_t ceilingheight,
 
 void Unlag::reconcilePlayerPositions(byte shooter_id, size_t ticsago)
 {
-	for (auto& record : player_history)
+	const size_t cur = (gametic - ticsago) % Unlag::MAX_HISTORY_TICS;
+
+	for (const byte id : player_ids)
 	{
+		PlayerHistoryRecord& record = player_history[id];
 		player_t *player = record.player;
 
 		// skip over the player shooting and any spectators
@@ -172,11 +184,9 @@ void Unlag::reconcilePlayerPositions(byte shooter_id, size_t ticsago)
 			record.backup_y = player->mo->y;
 			record.backup_z = player->mo->z;
 
-  			size_t cur = (gametic - ticsago) % Unlag::MAX_HISTORY_TICS;
-
-			dest_x = record.history_x[cur];
-			dest_y = record.history_y[cur];
-			dest_z = record.history_z[cur];
+			dest_x = history_x[cur][id];
+			dest_y = history_y[cur][id];
+			dest_z = history_z[cur][id];
 
 			record.offset_x = record.backup_x - dest_x;
 			record.offset_y = record.backup_y - dest_y;
@@ -228,11 +238,15 @@ void Unlag::reconcilePlayerPositions(byte shooter_id, size_t ticsago)
 // If 'reconciled' is true, restore the ceiling and floors to where they
 // were prior to reconciliation.
 //
+// Only sectors that have moved within the history window are visited, since
+// every other registered sector is already at the height it would be moved to.
+//
 
 void Unlag::reconcileSectorPositions(size_t ticsago)
 {
-	for (auto& record : sector_history)
+	for (const size_t index : moved_sectors)
 	{
+		SectorHistoryRecord& record = sector_history[index];
 		sector_t *sector = record.sector;
 
 		fixed_t dest_ceilingheight, dest_floorheight;
@@ -253,6 +267,11 @@ void Unlag::reconcileSectorPositions(size_t ticsago)
 			dest_ceilingheight = record.backup_ceilingheight;
 			dest_floorheight = record.backup_floorheight;
 		}
+
+		if (dest_ceilingheight == P_CeilingHeight(sector) &&
+			dest_floorheight == P_FloorHeight(sector))
+			continue;
+
 		moveSector(sector, dest_ceilingheight, dest_floorheight);
 	}
 }
@@ -267,9 +286,13 @@ void Unlag::reconcileSectorPositions(size_t ticsago)
 
 void Unlag::reset()
 {
-	player_history.clear();
+	for (const byte id : player_ids)
+		player_history[id].player = NULL;
+
+	player_ids.clear();
 	sector_history.clear();
-	player_id_map.clear();
+	moved_sectors.clear();
+	sector_index_map.clear();
 }
 
 
@@ -285,8 +308,11 @@ void Unlag::recordPlayerPositions()
 	if (!Unlag::enabled())
 		return;
 
-	for (auto& record : player_history)
+	const size_t cur = gametic % Unlag::MAX_HISTORY_TICS;
+
+	for (const byte id : player_ids)
 	{
+		PlayerHistoryRecord& record = player_history[id];
 		player_t *player = record.player;
 
 		if (player->playerstate == PST_LIVE &&
@@ -294,10 +320,9 @@ void Unlag::recordPlayerPositions()
 		{
 			record.history_size++;
 
-			size_t cur = gametic % Unlag::MAX_HISTORY_TICS;
-			record.history_x[cur] = player->mo->x;
-			record.history_y[cur] = player->mo->y;
-			record.history_z[cur] = player->mo->z;
+			history_x[cur][id] = player->mo->x;
+			history_y[cur][id] = player->mo->y;
+			history_z[cur][id] = player->mo->z;
 
 			#ifdef _UNLAG_DEBUG_
 			DPrintFmt("Unlag ({:03d}): recording player {} position ({}, {})\n",
@@ -318,7 +343,8 @@ void Unlag::recordPlayerPositions()
 //
 // Unlag::recordSectorPositions()
 //
-// Saves the current ceiling and floor heights of all movable sectors
+// Saves the current ceiling and floor heights of all movable sectors and
+// rebuilds the list of sectors that moved within the history window.
 //
 
 void Unlag::recordSectorPositions()
@@ -326,14 +352,28 @@ void Unlag::recordSectorPositions()
 	if (!Unlag::enabled())
 		return;
 
-	for (auto& record : sector_history)
+	moved_sectors.clear();
+
+	for (size_t i = 0; i < sector_history.size(); i++)
 	{
+		SectorHistoryRecord& record = sector_history[i];
 		sector_t *sector = record.sector;
 
+		const fixed_t ceilingheight = P_CeilingHeight(sector);
+		const fixed_t floorheight = P_FloorHeight(sector);
+
+		size_t prev = (record.history_size - 1) % Unlag::MAX_HISTORY_TICS;
+		if (record.history_ceilingheight[prev] != ceilingheight ||
+			record.history_floorheight[prev] != floorheight)
+			record.last_moved = gametic;
+
 		size_t cur = record.history_size++
 					 % Unlag::MAX_HISTORY_TICS;
-		record.history_ceilingheight[cur] = P_CeilingHeight(sector);
-		record.history_floorheight[cur] = P_FloorHeight(sector);
+		record.history_ceilingheight[cur] = ceilingheight;
+		record.history_floorheight[cur] = floorheight;
+
+		if (gametic - record.last_moved <= (int)Unlag::MAX_HISTORY_TICS)
+			moved_sectors.push_back(i);
 	}
 }
 
@@ -343,19 +383,13 @@ void Unlag::recordSectorPositions()
 //
 // Updates the pointer to player_t in each player history record.
 // The address of a player's player_t can change when a player is added to or
-// removed from the global 'players' vector.  Also recreate the player_id_map.
+// removed from the global 'players' vector.
 //
 
 void Unlag::refreshRegisteredPlayers()
 {
-	player_id_map.clear();
-	for (size_t i=0; i<player_history.size(); i++)
-	{
-		byte id = player_history[i].player_id;
-
-		player_history[i].player = &idplayer(id);
-		player_id_map[id] = i;
-	}
+	for (const byte id : player_ids)
+		player_history[id].player = &idplayer(id);
 }
 
 //
@@ -374,10 +408,14 @@ void Unlag::registerPlayer(byte player_id)
 	if (!validplayer(idplayer(player_id)))
 		return;
 
-	player_history.push_back(PlayerHistoryRecord());
-	player_history.back().player_id = player_id;
-	player_history.back().history_size = 0;
-	player_history.back().changed_flags = false;
+	PlayerHistoryRecord& record = player_history[player_id];
+	if (!record.player)
+		player_ids.push_back(player_id);
+
+	record = PlayerHistoryRecord();
+	record.history_size = 0;
+	record.changed_flags = false;
+	record.current_lag = 0;
 
 	refreshRegisteredPlayers();
 }
@@ -398,11 +436,11 @@ void Unlag::unregisterPlayer(byte player_id)
 	if (!Unlag::enabled())
 		return;
 
-	size_t history_index = player_id_map[player_id];
-	if (history_index >= player_history.size())
+	if (!player_history[player_id].player)
 		return;
 
-	player_history.erase(player_history.begin() + history_index);
+	player_history[player_id].player = NULL;
+	player_ids.erase(std::find(player_ids.begin(), player_ids.end(), player_id));
 	refreshRegisteredPlayers();
 }
 
@@ -421,14 +459,28 @@ void Unlag::registerSector(sector_t *sector)
 		return;
 
 	// Check if this sector already is in sector_history
-	for (const auto& record : sector_history)
+	auto it = sector_index_map.find(sector);
+	size_t index;
+	if (it == sector_index_map.end())
+	{
+		index = sector_history.size();
+		sector_history.push_back(SectorHistoryRecord(sector));
+		sector_index_map[sector] = index;
+	}
+	else
 	{
-		// note: comparing the pointers to the sector_t objects
-		if (record.sector == sector)
-			return;
+		index = it->second;
+		sector_history[index].last_moved = gametic;
 	}
 
-	sector_history.push_back(SectorHistoryRecord(sector));
+	// the sector starts moving this tic, so it may need reconciling before
+	// recordSectorPositions next rebuilds the list of moved sectors. While a
+	// reconcile is active the sector has no backup heights to restore to, so
+	// leave it for recordSectorPositions to pick up.
+	if (!reconciled &&
+		std::find(moved_sectors.begin(), moved_sectors.end(), index) ==
+		moved_sectors.end())
+		moved_sectors.push_back(index);
 }
 
 
@@ -444,14 +496,29 @@ void Unlag::unregisterSector(sector_t *sector)
 	if (!Unlag::enabled())
 		return;
 
-	for (size_t i=0; i<sector_history.size(); i++)
+	auto it = sector_index_map.find(sector);
+	if (it == sector_index_map.end())
+		return;
+
+	// move the last record into the vacated slot so the other indices
+	// stay valid
+	const size_t index = it->second;
+	const size_t last = sector_history.size() - 1;
+	sector_index_map.erase(it);
+
+	if (index != last)
 	{
-		// note: comparing the pointers to the sector_t objects
-		if (sector_history[i].sector == sector)
-		{
-			sector_history.erase(sector_history.begin() + i);
-			return;
-		}
+		sector_history[index] = sector_history[last];
+		sector_index_map[sector_history[index].sector] = index;
+	}
+	sector_history.pop_back();
+
+	moved_sectors.erase(std::remove(moved_sectors.begin(), moved_sectors.end(),
+	                                index), moved_sectors.end());
+	for (size_t& moved : moved_sectors)
+	{
+		if (moved == last)
+			moved = index;
 	}
 }
 
@@ -470,9 +537,10 @@ void Unlag::reconcile(byte shooter_id)
 	if (!Unlag::enabled())
 		return;
 
-	size_t player_index = player_id_map[shooter_id];
+	if (!player_history[shooter_id].player)
+		return;
 
-	size_t lag = player_history[player_index].current_lag;
+	size_t lag = player_history[shooter_id].current_lag;
 
 	#ifdef _UNLAG_DEBUG_
 	DPrintFmt("Unlag ({:03d}): moving players to their positions at gametic {} ({} tics ago)\n",
@@ -557,8 +625,10 @@ void Unlag::setRoundtripDelay(byte player_id, byte svgametic)
 
 	size_t delay = ((gametic & 0xFF) + 256 - svgametic) & 0xFF;
 
-	size_t player_index = player_id_map[player_id];
-	player_history[player_index].current_lag = MIN(delay, maxdelay);
+	if (!player_history[player_id].player)
+		return;
+
+	player_history[player_id].current_lag = MIN(delay, maxdelay);
 
 	#ifdef _UNLAG_DEBUG_
 	DPrintFmt("Unlag ({:03d}): received gametic {} from player {}, lag = {}\n",
@@ -581,12 +651,13 @@ void Unlag::getReconciliationOffset(	byte target_id,
 	if (!reconciled)
 		return;
 
-	size_t target_index  = player_id_map[target_id];
+	if (!player_history[target_id].player)
+		return;
 
 	// calculate how far the target was moved during reconciliation
-	x = player_history[target_index].offset_x;
-	y = player_history[target_index].offset_y;
-	z = player_history[target_index].offset_z;
+	x = player_history[target_id].offset_x;
+	y = player_history[target_id].offset_y;
+	z = player_history[target_id].offset_z;
 }
 
 
@@ -601,17 +672,17 @@ void Unlag::getCurrentPlayerPosition(	byte player_id,
 {
 	x = y = z = 0;
 
-	size_t cur = player_id_map[player_id];
-	player_t* player = player_history[cur].player;
+	const PlayerHistoryRecord& record = player_history[player_id];
+	player_t* player = record.player;
 
 	if (!player || !player->mo || player->spectator)
 		return;
 
 	if (Unlag::enabled() && reconciled)
 	{
-		x = player_history[cur].backup_x;
-		y = player_history[cur].backup_y;
-		z = player_history[cur].backup_z;
+		x = record.backup_x;
+		y = record.backup_y;
+		z = record.backup_z;
 	}
 	else
 	{
@@ -631,9 +702,10 @@ void Unlag::debugReconciliation(byte shooter_id)
 {
 	player_t *shooter = &(idplayer(shooter_id));
 
-	for (auto& record : player_history)
+	for (const byte id : player_ids)
 	{
-		if (record.player->id == shooter_id)
+		const PlayerHistoryRecord& record = player_history[id];
+		if (id == shooter_id)
 			continue;
 
 		for (size_t n = 0; n < MAX_HISTORY_TICS; n++)
@@ -643,8 +715,8 @@ void Unlag::debugReconciliation(byte shooter_id)
 
 			size_t cur = (gametic - n) % Unlag::MAX_HISTORY_TICS;
 
-			fixed_t x = record.history_x[cur];
-			fixed_t y = record.history_y[cur];
+			fixed_t x = history_x[cur][id];
+			fixed_t y = history_y[cur][id];
 
 			angle_t angle = P_PointToAngle(shooter->mo->x,	shooter->mo->y, x, y);
 			angle_t deltaangle = 	angle - shooter->mo->angle < ANG180 ?
@@ -670,12 +742,64 @@ void Unlag::clearPlayerHistory(byte player_id)
 	if (!Unlag::enabled())
 		return;
 
-	size_t cur = player_id_map[player_id];
+	player_history[player_id].history_size = 0;
+}
+
+
+//
+// Unlag::benchmark
+//
+// Times reconciling and restoring the world from the point of view of every
+// registered player, as if each of them fired a hitscan weapon with half the
+// history window of lag.
+//
+
+void Unlag::benchmark(size_t iterations)
+{
+	if (!Unlag::enabled() || reconciled)
+	{
+		PrintFmt("Unlag is not active.\n");
+		return;
+	}
 
-	if (cur >= player_history.size())
+	if (player_ids.empty())
+	{
+		PrintFmt("No players are registered with Unlag.\n");
 		return;
+	}
 
-	PlayerHistoryRecord& record = player_history[cur];
+	const size_t lag = Unlag::MAX_HISTORY_TICS / 2;
+	const std::vector<byte> shooters = player_ids;
 
-	record.history_size = 0;
+	dtime_t start = I_GetTime();
+	for (size_t i = 0; i < iterations; i++)
+	{
+		for (const byte id : shooters)
+		{
+			const size_t current_lag = player_history[id].current_lag;
+			player_history[id].current_lag = lag;
+
+			reconcile(id);
+			restore(id);
+
+			player_history[id].current_lag = current_lag;
+		}
+	}
+	dtime_t elapsed = I_GetTime() - start;
+
+	const size_t shots = iterations * shooters.size();
+	PrintFmt("Unlag: {} shots against {} players and {} of {} sectors in {:.3f} ms "
+	         "({:.3f} us per shot)\n",
+	         shots, player_ids.size(), moved_sectors.size(), sector_history.size(),
+	         elapsed / 1e6, shots ? elapsed / 1e3 / shots : 0.0);
+}
+
+BEGIN_COMMAND(unlag_bench)
+{
+	size_t iterations = 1000;
+	if (argc > 1)
+		iterations = MAX(1, atoi(argv[1]));
+
+	Unlag::getInstance().benchmark(iterations);
 }
+END_COMMAND(unlag_bench)
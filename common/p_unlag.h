@@ -33,6 +33,8 @@
 #include "d_player.h"
 #include "r_defs.h"
 
+#include <unordered_map>
+
 class Unlag
 {
 public:
@@ -54,19 +56,19 @@ public:
 									fixed_t &x, fixed_t &y, fixed_t &z);
 	void clearPlayerHistory(byte player_id);
 	static bool enabled();
+	void benchmark(size_t iterations);
 private:
 	static constexpr size_t MAX_HISTORY_TICS = TICRATE;
 
-	typedef struct {
-		byte		player_id;
+	// One slot per possible player id, so records are found without a lookup.
+	static constexpr size_t MAX_PLAYER_IDS = 256;
 
-		// cached pointer to players[n].  Note: this needs to be updated
-		// EVERYTIME a player connects or disconnects.
+	typedef struct {
+		// cached pointer to players[n], NULL if the id isn't registered.
+		// Note: this needs to be updated EVERYTIME a player connects or
+		// disconnects.
 		player_t*	player;
 
-		fixed_t		history_x[Unlag::MAX_HISTORY_TICS];
-		fixed_t		history_y[Unlag::MAX_HISTORY_TICS];
-		fixed_t		history_z[Unlag::MAX_HISTORY_TICS];
 		size_t		history_size;
 
 		// current position. restore this position after reconciliation.
@@ -85,6 +87,11 @@ private:
 		size_t		current_lag;
 	} PlayerHistoryRecord;
 
+	// Ring buffers of player positions, one row per tic and one column per
+	// player id, so reconciling reads every player's position for a tic
+	// from the same few cache lines.
+	typedef fixed_t PlayerHistoryRow[MAX_PLAYER_IDS];
+
 	class SectorHistoryRecord
 	{
 	public:
@@ -96,19 +103,34 @@ private:
 		fixed_t		history_ceilingheight[Unlag::MAX_HISTORY_TICS];
 		fixed_t		history_floorheight[Unlag::MAX_HISTORY_TICS];
 
+		// last gametic the recorded heights changed.
+		int			last_moved;
+
 		// current position. restore this position after reconciliation.
 		fixed_t		backup_ceilingheight;
 		fixed_t		backup_floorheight;
 	};
 
-	std::vector<PlayerHistoryRecord> player_history;
+	PlayerHistoryRecord player_history[MAX_PLAYER_IDS];
+	PlayerHistoryRow history_x[MAX_HISTORY_TICS];
+	PlayerHistoryRow history_y[MAX_HISTORY_TICS];
+	PlayerHistoryRow history_z[MAX_HISTORY_TICS];
+
+	// ids of the registered players, in order of registration.
+	std::vector<byte> player_ids;
+
 	std::vector<SectorHistoryRecord> sector_history;
-	bool reconciled;
 
-    // stores an index into the player_history vector, keyed by player_id
-	std::map<byte, size_t> player_id_map;
+	// indices into sector_history of the sectors that moved recently
+	// enough to be somewhere else in the history window.
+	std::vector<size_t> moved_sectors;
+
+	// stores an index into the sector_history vector, keyed by sector
+	std::unordered_map<sector_t*, size_t> sector_index_map;
+
+	bool reconciled;
 
-	Unlag() : reconciled(false) {}  // private contsructor (part of Singleton)
+	Unlag();  // private contsructor (part of Singleton)
 	Unlag(const Unlag &rhs);		// private copy constructor
 	Unlag& operator=(const Unlag &rhs);	//private assignment operator
 
@@ -949,6 +949,9 @@ static void LinkPolyobj (polyobj_t *po)
 	polyblock_t *tempLink;
 	int i, j;
 
+	// the polyobj has moved, so cached sight checks through it are stale
+	P_InvalidateSightCache();
+
 	// calculate the polyobj bbox
 	tempSeg = po->segs;
 	rightX = leftX = (*tempSeg)->v1->x;
@@ -1055,7 +1058,7 @@ static bool CheckMobjBlocking (seg_t *seg, polyobj_t *po)
 	{
 		for (i = left; i <= right; i++)
 		{
-			for (mobj = blocklinks[j+i]; mobj; mobj = mobj->bmapnode.Next(i, j/bmapwidth))
+			for (mobj = P_BlockFirstThing(i, j/bmapwidth); mobj; mobj = mobj->bmapnode.Next(i, j/bmapwidth))
 			{
 				if ((mobj->flags&MF_SOLID) && !(mobj->flags&MF_NOCLIP))
 				{
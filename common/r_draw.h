@@ -54,7 +54,8 @@ typedef struct
 	palindex_t			color;				// for r_drawflat
 } drawcolumn_t;
 
-extern "C" drawcolumn_t dcol;
+// each render thread has its own column state (see R_DrawDeferredPass)
+extern "C" thread_local drawcolumn_t dcol;
 
 typedef struct
 {
@@ -88,7 +89,8 @@ typedef struct
 	palindex_t			color;
 } drawspan_t;
 
-extern "C" drawspan_t dspan;
+// each render thread has its own span state (see R_DrawPlanes)
+extern "C" thread_local drawspan_t dspan;
 
 
 // [RH] Temporary buffer for column drawing
@@ -131,6 +133,20 @@ extern void (*R_FillTranslucentSpan)(void);
 // [RH] Initialize the above function pointers
 void R_InitColumnDrawers ();
 
+// Column batching for 32bpp surfaces (see r_columnbatch)
+bool R_BeginColumnBatch(void (*drawfunc)());
+void R_BatchColumn();
+void R_EndColumnBatch();
+void R_SetColumnBatchMode(int mode);
+
+// No more than this many column spans are queued at once, so a caller that
+// builds posts in scratch buffers needs one buffer more than this.
+constexpr int COLUMNBATCH_MAXQUEUED = 7;
+
+int R_GetFuzzPosition();
+void R_SetFuzzPosition(int pos);
+void R_SkipFuzzColumn();
+
 void R_InitVectorizedDrawers();
 
 void	R_DrawColumnP (void);
@@ -140,9 +156,7 @@ void	R_DrawTranslatedColumnP (void);
 void	R_DrawSpanP (void);
 void	R_DrawSlopeSpanIdealP_C (void);
 
-void	R_DrawColumnD (void);
 void	R_DrawFuzzColumnD (void);
-void	R_DrawTranslucentColumnD (void);
 void	R_DrawTranslatedColumnD (void);
 
 void	R_DrawTlatedLucentColumnP (void);
@@ -155,6 +169,9 @@ void	R_BlankSpan (void);
 void	R_FillSpanP (void);
 void	R_FillSpanD (void);
 
+void R_DrawColumnD_c(void);
+void R_DrawTranslucentColumnD_c(void);
+void R_DrawTlatedLucentColumnD_c(void);
 void R_DrawSpanD_c(void);
 void R_DrawSlopeSpanD_c(void);
 
@@ -171,6 +188,13 @@ void R_DrawSlopeSpanD_SSE2(void);
 void r_dimpatchD_SSE2(IWindowSurface*, argb_t color, int alpha, int x1, int y1, int w, int h);
 #endif
 
+#ifdef NOVADOOM_AVX2
+void R_DrawColumnD_AVX2(void);
+void R_DrawTranslucentColumnD_AVX2(void);
+void R_DrawTlatedLucentColumnD_AVX2(void);
+void R_DrawSpanD_AVX2(void);
+#endif
+
 #ifdef __MMX__
 void R_DrawSpanD_MMX(void);
 void R_DrawSlopeSpanD_MMX(void);
@@ -184,6 +208,9 @@ void r_dimpatchD_ALTIVEC(IWindowSurface*, argb_t color, int alpha, int x1, int y
 #endif
 
 // Vectorizable function pointers:
+extern void (*R_DrawColumnD)(void);
+extern void (*R_DrawTranslucentColumnD)(void);
+extern void (*R_DrawTlatedLucentColumnD)(void);
 extern void (*R_DrawSpanD)(void);
 extern void (*R_DrawSlopeSpanD)(void);
 extern void (*r_dimpatchD)(IWindowSurface* surface, argb_t color, int alpha, int x1, int y1, int w, int h);
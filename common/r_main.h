@@ -59,7 +59,7 @@ inline fixed_t			centerxfrac;
 inline fixed_t			centeryfrac;
 inline fixed_t			yaspectmul;
 
-extern shaderef_t		basecolormap;	// [RH] Colormap for sector currently being drawn
+extern thread_local shaderef_t basecolormap;	// [RH] Colormap for sector currently being drawn
 
 // increment every time a check is made
 inline int				validcount = 1;
@@ -223,6 +223,8 @@ void R_SetTranslatedDrawFuncs();
 void R_SetTranslatedLucentDrawFuncs();
 void R_SetSkyForegroundDrawFuncs();
 
+bool R_ColumnBatchTestPassed();
+
 inline byte shaderef_t::ramp() const
 {
 	if (m_mapnum >= NUMCOLORMAPS)
@@ -110,6 +110,7 @@ static void InitMap()
 	MapProto(svc_maplist_index, odaproto::svc::MaplistIndex::descriptor());
 	MapProto(svc_toast, odaproto::svc::Toast::descriptor());
 	MapProto(svc_hordeinfo, odaproto::svc::HordeInfo::descriptor());
+	MapProto(svc_worldsnapshot, odaproto::svc::WorldSnapshot::descriptor());
 	MapProto(svc_netdemocap, odaproto::svc::NetdemoCap::descriptor());
 	MapProto(svc_netdemostop, odaproto::svc::NetDemoStop::descriptor());
 	MapProto(svc_netdemoloadsnap, odaproto::svc::NetDemoLoadSnap::descriptor());
@@ -0,0 +1,273 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//   World snapshot delta encoding, shared by the server which writes
+//   snapshots and the client which reads them.
+//
+//   The "actors" field of the message is a flat list of zigzag varints.
+//   Each actor contributes one record:
+//
+//   - netid, as the difference from the previous record's netid.
+//   - baseline_t field flags.  0 means the actor left the snapshot.
+//   - One value for each flag set, in flag order, as the difference from
+//     the base snapshot's value (or from zero if the base lacks the actor).
+//
+//   Actors whose state matches the base snapshot are left out entirely.
+//
+//-----------------------------------------------------------------------------
+
+
+#include "novadoom.h"
+
+#include "svc_snapshot.h"
+
+#include "server.pb.h"
+
+namespace
+{
+
+const uint32_t SNAPSHOT_FIELDS[] = {
+    baseline_t::POSX,      baseline_t::POSY,     baseline_t::POSZ,   baseline_t::ANGLE,
+    baseline_t::MOVEDIR,   baseline_t::MOVECOUNT, baseline_t::RNDINDEX, baseline_t::TARGET,
+    baseline_t::TRACER,    baseline_t::MOMX,     baseline_t::MOMY,   baseline_t::MOMZ,
+};
+
+uint32_t GetField(const baseline_t& state, const uint32_t field)
+{
+	switch (field)
+	{
+	case baseline_t::POSX:
+		return state.pos.x;
+	case baseline_t::POSY:
+		return state.pos.y;
+	case baseline_t::POSZ:
+		return state.pos.z;
+	case baseline_t::ANGLE:
+		return state.angle;
+	case baseline_t::MOVEDIR:
+		return state.movedir;
+	case baseline_t::MOVECOUNT:
+		return state.movecount;
+	case baseline_t::RNDINDEX:
+		return state.rndindex;
+	case baseline_t::TARGET:
+		return state.targetid;
+	case baseline_t::TRACER:
+		return state.tracerid;
+	case baseline_t::MOMX:
+		return state.mom.x;
+	case baseline_t::MOMY:
+		return state.mom.y;
+	case baseline_t::MOMZ:
+		return state.mom.z;
+	default:
+		return 0;
+	}
+}
+
+void SetField(baseline_t& state, const uint32_t field, const uint32_t value)
+{
+	switch (field)
+	{
+	case baseline_t::POSX:
+		state.pos.x = value;
+		break;
+	case baseline_t::POSY:
+		state.pos.y = value;
+		break;
+	case baseline_t::POSZ:
+		state.pos.z = value;
+		break;
+	case baseline_t::ANGLE:
+		state.angle = value;
+		break;
+	case baseline_t::MOVEDIR:
+		state.movedir = static_cast<byte>(value);
+		break;
+	case baseline_t::MOVECOUNT:
+		state.movecount = value;
+		break;
+	case baseline_t::RNDINDEX:
+		state.rndindex = static_cast<byte>(value);
+		break;
+	case baseline_t::TARGET:
+		state.targetid = value;
+		break;
+	case baseline_t::TRACER:
+		state.tracerid = value;
+		break;
+	case baseline_t::MOMX:
+		state.mom.x = value;
+		break;
+	case baseline_t::MOMY:
+		state.mom.y = value;
+		break;
+	case baseline_t::MOMZ:
+		state.mom.z = value;
+		break;
+	default:
+		break;
+	}
+}
+
+void WriteRecord(odaproto::svc::WorldSnapshot& msg, uint32_t& lastid, const uint32_t netid,
+                 const baseline_t& from, const baseline_t* to)
+{
+	msg.add_actors(static_cast<int32_t>(netid - lastid));
+	lastid = netid;
+
+	if (to == NULL)
+	{
+		msg.add_actors(0);
+		return;
+	}
+
+	uint32_t flags = 0;
+	for (const uint32_t field : SNAPSHOT_FIELDS)
+	{
+		if (GetField(from, field) != GetField(*to, field))
+			flags |= field;
+	}
+
+	// A flags value of 0 means removal, so an actor that is new to the
+	// client always carries at least one field.
+	if (flags == 0)
+		flags = baseline_t::POSX;
+
+	msg.add_actors(static_cast<int32_t>(flags));
+	for (const uint32_t field : SNAPSHOT_FIELDS)
+	{
+		if (flags & field)
+			msg.add_actors(static_cast<int32_t>(GetField(*to, field) - GetField(from, field)));
+	}
+}
+
+} // namespace
+
+/**
+ * @brief Write the difference between two snapshots into a message.
+ *
+ * @param msg Message to fill in.
+ * @param base Snapshot the client already has, or an empty one.
+ * @param snap Snapshot to send.
+ */
+void SVC_EncodeWorldSnapshot(odaproto::svc::WorldSnapshot& msg, const WorldSnapshot& base,
+                             const WorldSnapshot& snap)
+{
+	static const baseline_t zero;
+
+	msg.set_tic(snap.tic);
+	msg.set_base_tic(base.tic);
+	msg.clear_actors();
+
+	uint32_t lastid = 0;
+	auto bit = base.actors.begin();
+	auto sit = snap.actors.begin();
+	while (bit != base.actors.end() || sit != snap.actors.end())
+	{
+		if (sit == snap.actors.end() ||
+		    (bit != base.actors.end() && bit->netid < sit->netid))
+		{
+			// Actor left the snapshot.
+			WriteRecord(msg, lastid, bit->netid, bit->state, NULL);
+			++bit;
+		}
+		else if (bit == base.actors.end() || sit->netid < bit->netid)
+		{
+			// Actor is new to the snapshot.
+			WriteRecord(msg, lastid, sit->netid, zero, &sit->state);
+			++sit;
+		}
+		else
+		{
+			if (bit->state != sit->state)
+				WriteRecord(msg, lastid, sit->netid, bit->state, &sit->state);
+			++bit;
+			++sit;
+		}
+	}
+}
+
+/**
+ * @brief Rebuild a snapshot from a message and the base it was encoded
+ *        against.
+ *
+ * @return false if the message is malformed.
+ */
+bool SVC_DecodeWorldSnapshot(const odaproto::svc::WorldSnapshot& msg,
+                             const WorldSnapshot& base, WorldSnapshot& out)
+{
+	out.tic = msg.tic();
+	out.actors.clear();
+	out.actors.reserve(base.actors.size());
+
+	const int count = msg.actors_size();
+	auto bit = base.actors.begin();
+	uint32_t netid = 0;
+	int i = 0;
+	while (i < count)
+	{
+		if (i + 2 > count)
+			return false;
+
+		// Records are in strictly increasing netid order.
+		const uint32_t delta = static_cast<uint32_t>(msg.actors(i++));
+		if (delta == 0 && i > 1)
+			return false;
+		netid += delta;
+
+		const uint32_t flags = static_cast<uint32_t>(msg.actors(i++));
+
+		// Carry over everything from the base up to this actor.
+		for (; bit != base.actors.end() && bit->netid < netid; ++bit)
+			out.actors.push_back(*bit);
+
+		WorldSnapshot::Entry entry;
+		entry.netid = netid;
+		if (bit != base.actors.end() && bit->netid == netid)
+		{
+			entry.state = bit->state;
+			++bit;
+		}
+
+		if (flags == 0)
+			continue;
+
+		for (const uint32_t field : SNAPSHOT_FIELDS)
+		{
+			if (!(flags & field))
+				continue;
+
+			if (i >= count)
+				return false;
+
+			const uint32_t diff = static_cast<uint32_t>(msg.actors(i++));
+			SetField(entry.state, field, GetField(entry.state, field) + diff);
+		}
+
+		out.actors.push_back(entry);
+	}
+
+	for (; bit != base.actors.end(); ++bit)
+		out.actors.push_back(*bit);
+
+	return true;
+}
+
+VERSION_CONTROL (svc_snapshot_cpp, "$Id$")
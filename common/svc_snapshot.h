@@ -0,0 +1,58 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//   World snapshots - the state of every actor the server keeps a client
+//   up to date on at a given tic, delta-encoded against a snapshot the
+//   client has already acknowledged.
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "actor.h"
+
+namespace odaproto::svc
+{
+class WorldSnapshot;
+}
+
+struct WorldSnapshot
+{
+	struct Entry
+	{
+		uint32_t netid;
+		baseline_t state;
+	};
+
+	int tic;
+	std::vector<Entry> actors; // Sorted by netid.
+
+	WorldSnapshot() : tic(0) { }
+
+	void clear()
+	{
+		tic = 0;
+		actors.clear();
+	}
+};
+
+void SVC_EncodeWorldSnapshot(odaproto::svc::WorldSnapshot& msg, const WorldSnapshot& base,
+                             const WorldSnapshot& snap);
+bool SVC_DecodeWorldSnapshot(const odaproto::svc::WorldSnapshot& msg,
+                             const WorldSnapshot& base, WorldSnapshot& out);
@@ -0,0 +1,365 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Persistent cache of resource file hashes.
+//
+//  Hashing a large PWAD means reading all of it, and the same files are
+//  hashed again on every startup and every change of WAD set.  The MD5 and
+//  CRC32 of each file are remembered in the write directory, keyed by the
+//  file's canonical path, size and modification time, so a file is only
+//  read again once it has changed.
+//
+//-----------------------------------------------------------------------------
+
+#include "novadoom.h"
+
+#include "w_hashcache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include "crc32.h"
+#include "md5.h"
+#include "m_fileio.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+const char* HASH_CACHE_FILENAME = "wadhashes.cache";
+
+// Upper bound on threads hashing files in the background.
+const size_t MAX_HASH_THREADS = 4;
+
+struct fileKey_t
+{
+	std::string path;
+	uintmax_t size;
+	int64_t mtime;
+};
+
+struct cacheEntry_t
+{
+	uintmax_t size;
+	int64_t mtime;
+	fileHashes_t hashes;
+};
+
+struct hashCache_t
+{
+	std::mutex mutex;
+	bool loaded;
+	std::unordered_map<std::string, cacheEntry_t> entries;
+	std::unordered_map<std::string, std::shared_future<fileHashes_t> > pending;
+
+	hashCache_t() : loaded(false) { }
+};
+
+// Never destroyed, since background hashing threads may still be using it
+// while the program exits.
+hashCache_t& HashCache()
+{
+	static hashCache_t* cache = new hashCache_t;
+	return *cache;
+}
+
+std::string CacheFilename()
+{
+	return M_GetUserFileName(HASH_CACHE_FILENAME);
+}
+
+/**
+ * @brief Identify a file by its canonical path, size and modification time.
+ */
+bool StatFile(const std::string& filename, fileKey_t& out)
+{
+	std::error_code ec;
+
+	const fs::path path = fs::canonical(filename, ec);
+	if (ec)
+		return false;
+
+	const uintmax_t size = fs::file_size(path, ec);
+	if (ec)
+		return false;
+
+	const fs::file_time_type mtime = fs::last_write_time(path, ec);
+	if (ec)
+		return false;
+
+	out.path = path.string();
+	out.size = size;
+	out.mtime = mtime.time_since_epoch().count();
+	return true;
+}
+
+/**
+ * @brief Read a file once, computing both of its hashes.
+ */
+bool HashContents(const std::string& filename, fileHashes_t& out)
+{
+	FILE* fp = fopen(filename.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	md5_state_t state;
+	md5_init(&state);
+	uint32_t crc = 0;
+
+	static const size_t file_chunk_size = 65536;
+	std::vector<unsigned char> buf(file_chunk_size);
+
+	size_t n = 0;
+	while ((n = fread(buf.data(), 1, buf.size(), fp)))
+	{
+		md5_append(&state, buf.data(), n);
+		crc = crc32_fast(buf.data(), n, crc);
+	}
+
+	fclose(fp);
+
+	md5_byte_t digest[16];
+	md5_finish(&state, digest);
+
+	std::string md5str;
+	for (int i = 0; i < 16; i++)
+		md5str += fmt::format("{:02X}", digest[i]);
+
+	OMD5Hash::makeFromHexStr(out.md5, md5str);
+	OCRC32Sum::makeFromHexStr(out.crc32, fmt::sprintf("%08X", crc));
+	return !out.md5.empty() && !out.crc32.empty();
+}
+
+/**
+ * @brief Read the cache file.  Must be called with the cache locked.
+ *
+ * Entries are appended as files are hashed, so later lines replace earlier
+ * ones for the same path.  The file is replaced by a compacted copy once it
+ * is mostly stale.
+ */
+void LoadCache(hashCache_t& cache)
+{
+	if (cache.loaded)
+		return;
+	cache.loaded = true;
+
+	std::ifstream in(CacheFilename().c_str());
+	if (!in.is_open())
+		return;
+
+	size_t lines = 0;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		std::istringstream fields(line);
+		cacheEntry_t entry;
+		std::string md5, crc32, path;
+
+		if (!(fields >> entry.size >> entry.mtime >> md5 >> crc32))
+			continue;
+
+		fields.get(); // separating space
+		std::getline(fields, path);
+
+		if (path.empty() || !OMD5Hash::makeFromHexStr(entry.hashes.md5, md5) ||
+		    !OCRC32Sum::makeFromHexStr(entry.hashes.crc32, crc32))
+			continue;
+
+		cache.entries[path] = entry;
+		lines++;
+	}
+	in.close();
+
+	if (lines <= cache.entries.size() * 2 + 16)
+		return;
+
+	// Other processes may be reading or appending to the cache, so write the
+	// compacted copy to a file of our own and move it into place.
+	const std::string filename = CacheFilename();
+	const std::string tmpname = fmt::format("{}.{:08x}.tmp", filename, std::random_device()());
+
+	std::ofstream out(tmpname.c_str(), std::ios::trunc);
+	if (!out.is_open())
+		return;
+
+	for (const auto& [path, entry] : cache.entries)
+	{
+		out << entry.size << ' ' << entry.mtime << ' ' << entry.hashes.md5.getHexStr()
+		    << ' ' << entry.hashes.crc32.getHexStr() << ' ' << path << '\n';
+	}
+	out.close();
+
+	std::error_code ec;
+	if (out.fail())
+		fs::remove(tmpname, ec);
+	else
+		fs::rename(tmpname, filename, ec);
+	if (ec)
+		fs::remove(tmpname, ec);
+}
+
+/**
+ * @brief Remember the hashes of a file, in memory and on disk.
+ */
+void StoreHashes(const fileKey_t& key, const fileHashes_t& hashes)
+{
+	hashCache_t& cache = HashCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+
+	LoadCache(cache);
+
+	cacheEntry_t entry = {key.size, key.mtime, hashes};
+	cache.entries[key.path] = entry;
+
+	std::ofstream out(CacheFilename().c_str(), std::ios::app);
+	if (out.is_open())
+	{
+		out << key.size << ' ' << key.mtime << ' ' << hashes.md5.getHexStr() << ' '
+		    << hashes.crc32.getHexStr() << ' ' << key.path << '\n';
+	}
+}
+
+/**
+ * @brief Look a file up in the cache.  Must be called with the cache locked.
+ */
+bool FindHashes(hashCache_t& cache, const fileKey_t& key, fileHashes_t& out)
+{
+	LoadCache(cache);
+
+	const auto it = cache.entries.find(key.path);
+	if (it == cache.entries.end() || it->second.size != key.size ||
+	    it->second.mtime != key.mtime)
+		return false;
+
+	out = it->second.hashes;
+	return true;
+}
+
+} // namespace
+
+/**
+ * @brief Get the MD5 and CRC32 of a file, reading it only if it changed
+ *        since it was last hashed.
+ *
+ * @param filename File to hash.
+ * @param out Output hashes, untouched on failure.
+ * @return True if the file could be hashed.
+ */
+bool W_GetFileHashes(const std::string& filename, fileHashes_t& out)
+{
+	fileKey_t key;
+	if (!StatFile(filename, key))
+		return false;
+
+	std::shared_future<fileHashes_t> inflight;
+	{
+		hashCache_t& cache = HashCache();
+		std::lock_guard<std::mutex> lock(cache.mutex);
+
+		if (FindHashes(cache, key, out))
+			return true;
+
+		const auto it = cache.pending.find(key.path);
+		if (it != cache.pending.end())
+		{
+			inflight = it->second;
+			cache.pending.erase(it);
+		}
+	}
+
+	// Being hashed in the background already, wait for it.  The file could
+	// have changed since, in which case it is hashed again below.
+	if (inflight.valid())
+	{
+		inflight.wait();
+
+		hashCache_t& cache = HashCache();
+		std::lock_guard<std::mutex> lock(cache.mutex);
+		if (FindHashes(cache, key, out))
+			return true;
+	}
+
+	fileHashes_t hashes;
+	if (!HashContents(key.path, hashes))
+		return false;
+
+	StoreHashes(key, hashes);
+	out = hashes;
+	return true;
+}
+
+/**
+ * @brief Start hashing files that are about to be asked for on background
+ *        threads, so W_GetFileHashes finds them done or in progress.
+ *
+ * @param filenames Files to hash.  Unchanged files already in the cache
+ *                  are skipped.
+ */
+void W_PrefetchFileHashes(const std::vector<std::string>& filenames)
+{
+	typedef std::pair<fileKey_t, std::promise<fileHashes_t> > job_t;
+	std::vector<std::vector<job_t> > queues(
+	    std::max<size_t>(1, std::min<size_t>(MAX_HASH_THREADS,
+	                                         std::thread::hardware_concurrency())));
+
+	{
+		hashCache_t& cache = HashCache();
+		std::lock_guard<std::mutex> lock(cache.mutex);
+
+		size_t next = 0;
+		for (const auto& filename : filenames)
+		{
+			fileKey_t key;
+			fileHashes_t hashes;
+			if (!StatFile(filename, key) || FindHashes(cache, key, hashes) ||
+			    cache.pending.find(key.path) != cache.pending.end())
+				continue;
+
+			std::promise<fileHashes_t> promise;
+			cache.pending[key.path] = promise.get_future().share();
+			queues[next].push_back(job_t(key, std::move(promise)));
+			next = (next + 1) % queues.size();
+		}
+	}
+
+	for (auto& queue : queues)
+	{
+		if (queue.empty())
+			continue;
+
+		std::thread([jobs = std::move(queue)]() mutable {
+			for (auto& [key, promise] : jobs)
+			{
+				fileHashes_t hashes;
+				if (HashContents(key.path, hashes))
+					StoreHashes(key, hashes);
+				promise.set_value(hashes);
+			}
+		}).detach();
+	}
+}
+
+VERSION_CONTROL (w_hashcache_cpp, "$Id$")
@@ -0,0 +1,38 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Persistent cache of resource file hashes.
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "ohash.h"
+
+/**
+ * @brief Hashes of a file's contents.
+ */
+struct fileHashes_t
+{
+	OMD5Hash md5;
+	OCRC32Sum crc32;
+};
+
+bool W_GetFileHashes(const std::string& filename, fileHashes_t& out);
+void W_PrefetchFileHashes(const std::vector<std::string>& filenames);
@@ -40,7 +40,9 @@
 
 #include <fcntl.h>
 
-#include "crc32.h"
+#ifdef UNIX
+#include <sys/mman.h>
+#endif
 
 #include "m_fileio.h"
 #include "i_system.h"
@@ -48,11 +50,11 @@
 #include "z_zone.h"
 #include "cmdlib.h"
 #include "m_argv.h"
-#include "md5.h"
 
 #include "farmhash.h"
 
 #include "w_wad.h"
+#include "w_hashcache.h"
 
 #include <sstream>
 #include <algorithm>
@@ -80,6 +82,18 @@ void**			lumpcache;
 
 static unsigned	stdisk_lumpnum;
 
+// Memory mappings of the open WAD files, so lumps can be read without a
+// seek and read syscall each, and so servers on the same host share the
+// page cache for them.
+struct wadMapping_t
+{
+	FILE* handle;
+	void* base;
+	size_t length;
+};
+
+static std::vector<wadMapping_t> wadmappings;
+
 //
 // W_LumpNameHash
 //
@@ -152,63 +166,17 @@ void uppercopy (char *to, const char *from)
  */
 OCRC32Sum W_CRC32(const std::string& filename)
 {
-	OCRC32Sum rvo;
-
-	const int file_chunk_size = 8192;
-	FILE* fp = fopen(filename.c_str(), "rb");
-
-	if (!fp)
-		return rvo;
-
-	size_t n = 0;
-	unsigned char buf[file_chunk_size];
-	uint32_t crc = 0;
-
-	while ((n = fread(buf, 1, sizeof(buf), fp)))
-	{
-		crc = crc32_fast(buf, n, crc);
-	}
-
-	std::string hashStr;
-
-	hashStr = fmt::sprintf("%08X", crc);
-
-	OCRC32Sum::makeFromHexStr(rvo, hashStr);
-	return rvo; // bubble up failure
+	fileHashes_t hashes;
+	W_GetFileHashes(filename, hashes);
+	return hashes.crc32; // bubble up failure
 }
 
 // denis - Standard MD5SUM
 OMD5Hash W_MD5(const std::string& filename)
 {
-	OMD5Hash rvo;
-
-	const int file_chunk_size = 8192;
-	FILE *fp = fopen(filename.c_str(), "rb");
-
-	if(!fp)
-		return rvo;
-
-	md5_state_t state;
-	md5_init(&state);
-
-	size_t n = 0;
-	unsigned char buf[file_chunk_size];
-
-	while((n = fread(buf, 1, sizeof(buf), fp)))
-		md5_append(&state, (unsigned char *)buf, n);
-
-	md5_byte_t digest[16];
-	md5_finish(&state, digest);
-
-	fclose(fp);
-
-	std::stringstream hashStr;
-
-	for(int i = 0; i < 16; i++)
-		hashStr << std::setw(2) << std::setfill('0') << std::hex << std::uppercase << (short)digest[i];
-
-	OMD5Hash::makeFromHexStr(rvo, hashStr.str());
-	return rvo; // bubble up failure
+	fileHashes_t hashes;
+	W_GetFileHashes(filename, hashes);
+	return hashes.md5; // bubble up failure
 }
 
 /*
@@ -255,6 +223,32 @@ fhfprint_t W_FarmHash128(const byte* lumpdata, int length)
 // LUMP BASED ROUTINES.
 //
 
+//
+// W_MapFile
+//
+// Map an opened file into memory.  Returns NULL if the platform or the file
+// doesn't allow it, in which case lumps are read with stdio instead.
+//
+static const byte* W_MapFile(FILE* handle)
+{
+#ifdef UNIX
+	const SDWORD length = M_FileLength(handle);
+	if (length <= 0)
+		return NULL;
+
+	void* base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fileno(handle), 0);
+	if (base == MAP_FAILED)
+		return NULL;
+
+	wadMapping_t mapping = {handle, base, static_cast<size_t>(length)};
+	wadmappings.push_back(mapping);
+
+	return static_cast<const byte*>(base);
+#else
+	return NULL;
+#endif
+}
+
 //
 // W_AddLumps
 //
@@ -270,6 +264,9 @@ void W_AddLumps(FILE* handle, filelump_t* fileinfo, size_t newlumps, bool client
 	lumpinfo_t* lump = &lumpinfo[numlumps];
 	filelump_t* info = &fileinfo[0];
 
+	const byte* mapped = W_MapFile(handle);
+	const size_t mappedlen = mapped ? wadmappings.back().length : 0;
+
 	for (size_t i = 0; i < newlumps; i++, info++)
 	{
 		lump->handle = handle;
@@ -277,6 +274,14 @@ void W_AddLumps(FILE* handle, filelump_t* fileinfo, size_t newlumps, bool client
 		lump->size = info->size;
 		lump->name = info->name;
 
+		// Lumps that claim to extend past the end of the file are left to
+		// W_ReadLump to complain about.
+		if (mapped && info->filepos >= 0 && info->size >= 0 &&
+		    static_cast<size_t>(info->filepos) + info->size <= mappedlen)
+			lump->data = mapped + info->filepos;
+		else
+			lump->data = NULL;
+
 		lump++;
 		numlumps++;
 	}
@@ -455,6 +460,7 @@ void W_MergeLumps (const char *start, const char *end, int space)
 					newlumps++;
 					newlumpinfos[0].name = ustart;
 					newlumpinfos[0].handle = NULL;
+					newlumpinfos[0].data = NULL;
 					newlumpinfos[0].position =
 						newlumpinfos[0].size = 0;
 					newlumpinfos[0].namespc = ns_global;
@@ -726,6 +732,12 @@ void W_ReadLump(unsigned int lump, void* dest)
 
 	l = lumpinfo + lump;
 
+	if (l->data)
+	{
+		memcpy(dest, l->data, l->size);
+		return;
+	}
+
 	if (lump != stdisk_lumpnum)
     	I_BeginRead();
 
@@ -739,27 +751,44 @@ void W_ReadLump(unsigned int lump, void* dest)
     	I_EndRead();
 }
 
+OLumpView::OLumpView(unsigned lump) : m_data(NULL), m_copy(NULL), m_size(0)
+{
+	if (lump >= numlumps)
+		I_Error("OLumpView: {} >= numlumps", lump);
+
+	m_size = lumpinfo[lump].size;
+
+	if (lumpinfo[lump].data)
+	{
+		m_data = lumpinfo[lump].data;
+	}
+	else
+	{
+		m_copy = new byte[m_size];
+		W_ReadLump(lump, m_copy);
+		m_data = m_copy;
+	}
+}
+
+OLumpView::~OLumpView()
+{
+	delete[] m_copy;
+}
+
 //
 // W_ReadChunk
 //
 // denis - for wad downloading
 //
-unsigned W_ReadChunk (const char *file, unsigned offs, unsigned len, void *dest, unsigned &filelen)
+// Reads from a handle the caller keeps open for the whole transfer, so
+// serving a file doesn't reopen it for every chunk.
+//
+unsigned W_ReadChunk (FILE *fp, unsigned offs, unsigned len, void *dest)
 {
-	FILE *fp = fopen(file, "rb");
-	unsigned read = 0;
-
-	if(fp)
-	{
-		filelen = M_FileLength(fp);
-
-		fseek(fp, offs, SEEK_SET);
-		read = fread(dest, 1, len, fp);
-		fclose(fp);
-	}
-	else filelen = 0;
+	if (!fp || fseek(fp, offs, SEEK_SET) != 0)
+		return 0;
 
-	return read;
+	return fread(dest, 1, len, fp);
 }
 
 
@@ -872,11 +901,9 @@ patch_t* W_CachePatch(unsigned lumpnum, const zoneTag_e tag)
 
 	if (!lumpcache[lumpnum])
 	{
-		// temporary storage of the raw patch in the old format
-		byte *rawlumpdata = new byte[W_LumpLength(lumpnum)];
-
-		W_ReadLump(lumpnum, rawlumpdata);
-		patch_t *rawpatch = (patch_t*)(rawlumpdata);
+		// the raw patch in the old format, only read from during conversion
+		OLumpView rawlump(lumpnum);
+		patch_t *rawpatch = (patch_t*)(rawlump.data());
 
 		size_t newlumplen = R_CalculateNewPatchSize(rawpatch, W_LumpLength(lumpnum));
 
@@ -895,8 +922,6 @@ patch_t* W_CachePatch(unsigned lumpnum, const zoneTag_e tag)
 			lumpcache[lumpnum] = Z_Malloc(sizeof(patch_t), tag, &lumpcache[lumpnum]);
 			memset(lumpcache[lumpnum], 0, sizeof(patch_t));
 		}
-
-		delete [] rawlumpdata;
 	}
 	else
 	{
@@ -1009,9 +1034,16 @@ void W_Close ()
 			fclose(lump_p->handle);
 			handles.push_back(lump_p->handle);
 		}
+		lump_p->data = NULL;
 		lump_p++;
 	}
 
+#ifdef UNIX
+	for (size_t i = 0; i < wadmappings.size(); i++)
+		munmap(wadmappings[i].base, wadmappings[i].length);
+#endif
+	wadmappings.clear();
+
 	::handleGen = (::handleGen + 1) & HANDLE_GEN_MASK;
 	if (::handleGen == 0)
 	{
@@ -70,6 +70,7 @@ typedef struct lumpinfo_s
 	FILE		*handle;
 	int			position;
 	int			size;
+	const byte	*data;	// Lump contents in the mapped file, or NULL.
 
 	// [RH] Hashing stuff
 	int			next;
@@ -108,6 +109,32 @@ struct lumpHandle_t
 	}
 };
 
+/**
+ * @brief Read-only access to the contents of a lump.
+ *
+ * When the lump's WAD is memory-mapped this points straight into the
+ * mapping and costs nothing; otherwise the lump is read into a temporary
+ * buffer that is freed along with the view.  Use this instead of
+ * W_CacheLumpNum for lumps that are parsed once and thrown away.
+ */
+class OLumpView
+{
+  public:
+	explicit OLumpView(unsigned lump);
+	~OLumpView();
+
+	const byte* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+  private:
+	OLumpView(const OLumpView&);
+	OLumpView& operator=(const OLumpView&);
+
+	const byte* m_data;
+	byte* m_copy;
+	size_t m_size;
+};
+
 extern	void**		lumpcache;
 extern	lumpinfo_t*	lumpinfo;
 extern	size_t	numlumps;
@@ -127,7 +154,7 @@ inline int W_GetNumForName(const OLumpName& name, int ns = ns_global) { return W
 OLumpName W_LumpName(unsigned lump);
 unsigned	W_LumpLength (unsigned lump);
 void		W_ReadLump (unsigned lump, void *dest);
-unsigned	W_ReadChunk (const char *file, unsigned offs, unsigned len, void *dest, unsigned &filelen);
+unsigned	W_ReadChunk (FILE *fp, unsigned offs, unsigned len, void *dest);
 
 void* W_CacheLumpNum(unsigned lump, const zoneTag_e tag);
 void* W_CacheLumpName(const char* name, const zoneTag_e tag);
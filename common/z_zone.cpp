@@ -300,6 +300,220 @@ class OZone
 	}
 } g_zone;
 
+//
+// OSlab
+//
+// A size-classed free-list allocator for the objects a level creates and
+// destroys by the thousand, such as thinkers and actors.  Objects are carved
+// out of large chunks owned by one tag and size class, so freeing an object
+// just pushes it on a free list and Z_FreeTags releases a tag's chunks
+// wholesale instead of walking every allocation.
+//
+// Allocation sites are only recorded in debug builds.
+//
+class OSlab
+{
+	static const size_t GRANULARITY = 16;
+	static const size_t MAXSIZE = 1024;
+	static const size_t NUMCLASSES = MAXSIZE / GRANULARITY;
+	static const size_t CHUNKSIZE = 64 * 1024;
+	static const uint32_t SLABID = 0x534C4142; // 'SLAB'
+
+	// 16 bytes, or 32 in debug builds where the allocation site is kept
+	struct alignas(16) SlabHeader
+	{
+		uint32_t id;        // SLABID while the object is live
+		uint16_t sizeclass; // index into SlabTag::classes
+		uint8_t tag;        // PU_* tag
+#if defined(NOVADOOM_DEBUG)
+		OFileLine fileLine; // __FILE__, __LINE__
+#endif
+	};
+
+#if !defined(NOVADOOM_DEBUG)
+	static_assert(sizeof(SlabHeader) == 16, "slab header should be 16 bytes");
+#endif
+
+	struct FreeObject
+	{
+		FreeObject* next;
+	};
+
+	struct SizeClass
+	{
+		FreeObject* freelist;
+		std::vector<void*> chunks;
+		size_t live;
+	};
+
+	struct SlabTag
+	{
+		zoneTag_e tag;
+		SizeClass classes[NUMCLASSES];
+	};
+
+	// only a handful of tags ever use the slab, so a linear search is fine
+	std::vector<SlabTag*> m_tags;
+
+	static size_t stride(size_t sizeclass)
+	{
+		return sizeof(SlabHeader) + (sizeclass + 1) * GRANULARITY;
+	}
+
+	SlabTag* findTag(zoneTag_e tag, bool create)
+	{
+		for (SlabTag* slabtag : m_tags)
+			if (slabtag->tag == tag)
+				return slabtag;
+
+		if (!create)
+			return NULL;
+
+		SlabTag* slabtag = new SlabTag();
+		slabtag->tag = tag;
+		for (SizeClass& sc : slabtag->classes)
+		{
+			sc.freelist = NULL;
+			sc.live = 0;
+		}
+		m_tags.push_back(slabtag);
+		return slabtag;
+	}
+
+	static void releaseTag(SlabTag* slabtag)
+	{
+		for (SizeClass& sc : slabtag->classes)
+		{
+			for (void* chunk : sc.chunks)
+				free(chunk);
+			sc.chunks.clear();
+			sc.freelist = NULL;
+			sc.live = 0;
+		}
+	}
+
+	static void grow(SizeClass& sc, size_t sizeclass, const OFileLine& info)
+	{
+		const size_t objsize = stride(sizeclass);
+		const size_t count = CHUNKSIZE / objsize;
+
+		byte* chunk = static_cast<byte*>(malloc(count * objsize));
+		if (chunk == NULL)
+		{
+			I_Error("{}: Could not allocate {} bytes at {}:{}.\n{}", __FUNCTION__,
+			        count * objsize, info.shortFile(), info.line, M_GetStacktrace());
+		}
+		sc.chunks.push_back(chunk);
+
+		// thread the new objects onto the free list in address order
+		for (size_t i = count; i-- > 0;)
+		{
+			SlabHeader* header = reinterpret_cast<SlabHeader*>(chunk + i * objsize);
+			header->id = 0;
+			FreeObject* obj = reinterpret_cast<FreeObject*>(header + 1);
+			obj->next = sc.freelist;
+			sc.freelist = obj;
+		}
+	}
+
+  public:
+	~OSlab()
+	{
+		clear();
+	}
+
+	static bool fits(size_t size)
+	{
+		return size > 0 && size <= MAXSIZE;
+	}
+
+	void clear()
+	{
+		for (SlabTag* slabtag : m_tags)
+		{
+			releaseTag(slabtag);
+			delete slabtag;
+		}
+		m_tags.clear();
+	}
+
+	void* alloc(size_t size, zoneTag_e tag, const OFileLine& info)
+	{
+		const size_t sizeclass = (size - 1) / GRANULARITY;
+		SizeClass& sc = findTag(tag, true)->classes[sizeclass];
+
+		if (sc.freelist == NULL)
+			grow(sc, sizeclass, info);
+
+		FreeObject* obj = sc.freelist;
+		sc.freelist = obj->next;
+		sc.live++;
+
+		SlabHeader* header = reinterpret_cast<SlabHeader*>(obj) - 1;
+		header->id = SLABID;
+		header->sizeclass = static_cast<uint16_t>(sizeclass);
+		header->tag = static_cast<uint8_t>(tag);
+#if defined(NOVADOOM_DEBUG)
+		header->fileLine = info;
+#endif
+
+		return obj;
+	}
+
+	void dealloc(void* ptr, const OFileLine& info)
+	{
+		if (ptr == NULL)
+			return;
+
+		SlabHeader* header = static_cast<SlabHeader*>(ptr) - 1;
+		SlabTag* slabtag = NULL;
+		if (header->id == SLABID)
+			slabtag = findTag(static_cast<zoneTag_e>(header->tag), false);
+
+		if (slabtag == NULL)
+		{
+			I_Error("{}: Address 0x{:p} is not a live slab object at {}:{}.\n{}",
+			        __FUNCTION__, ptr, info.shortFile(), info.line, M_GetStacktrace());
+			return;
+		}
+
+		SizeClass& sc = slabtag->classes[header->sizeclass];
+		header->id = 0;
+
+		FreeObject* obj = static_cast<FreeObject*>(ptr);
+		obj->next = sc.freelist;
+		sc.freelist = obj;
+		sc.live--;
+	}
+
+	void deallocTags(const int lowtag, const int hightag)
+	{
+		for (SlabTag* slabtag : m_tags)
+		{
+			if (slabtag->tag >= lowtag && slabtag->tag <= hightag)
+				releaseTag(slabtag);
+		}
+	}
+
+	void dump()
+	{
+		for (const SlabTag* slabtag : m_tags)
+		{
+			size_t live = 0, chunks = 0;
+			for (const SizeClass& sc : slabtag->classes)
+			{
+				live += sc.live;
+				chunks += sc.chunks.size();
+			}
+
+			std::string buf;
+			StrFormatBytes(buf, chunks * CHUNKSIZE);
+			PrintFmt("  slab {}: {} objects in {} chunks ({})\n", TagStr(slabtag->tag),
+			         live, chunks, buf);
+		}
+	}
+} g_slab;
+
 
 //
 // Z_Close
@@ -307,6 +521,7 @@ class OZone
 void STACK_ARGS Z_Close()
 {
 	g_zone.clear();
+	g_slab.clear();
 }
 
 //
@@ -315,6 +530,7 @@ void STACK_ARGS Z_Close()
 void Z_Init()
 {
 	g_zone.clear();
+	g_slab.clear();
 }
 
 
@@ -346,12 +562,38 @@ void* Z_Realloc2(void* ptr, size_t size, const zoneTag_e tag, void* user, const
 	return g_zone.realloc(ptr, size, tag, user, OFileLine::create(file, line));
 }
 
+//
+// Z_MallocSlab
+// Allocates a small object of a level-lifetime tag from the slab allocator.
+// Sizes the slab does not handle fall back to the ordinary zone.
+//
+void* Z_MallocSlab2(size_t size, const zoneTag_e tag, const char* file, const int line)
+{
+	if (!OSlab::fits(size))
+		return g_zone.alloc(size, tag, NULL, OFileLine::create(file, line));
+
+	return g_slab.alloc(size, tag, OFileLine::create(file, line));
+}
+
+//
+// Z_FreeSlab
+// Frees an object allocated with Z_MallocSlab of the same size.
+//
+void Z_FreeSlab2(void* ptr, size_t size, const char* file, int line)
+{
+	if (!OSlab::fits(size))
+		g_zone.deallocPtr(ptr, OFileLine::create(file, line));
+	else
+		g_slab.dealloc(ptr, OFileLine::create(file, line));
+}
+
 //
 // Z_FreeTags
 //
 void Z_FreeTags(const zoneTag_e lowtag, const zoneTag_e hightag)
 {
-	return ::g_zone.deallocTags(lowtag, hightag);
+	::g_slab.deallocTags(lowtag, hightag);
+	::g_zone.deallocTags(lowtag, hightag);
 }
 
 //
@@ -389,6 +631,7 @@ char* Z_StrDup2(const char* s, const zoneTag_e tag, const char* file, int line)
 void Z_DumpHeap(const zoneTag_e lowtag, const zoneTag_e hightag)
 {
 	::g_zone.dump();
+	::g_slab.dump();
 }
 
 BEGIN_COMMAND(dumpheap)
@@ -61,6 +61,8 @@ void Z_Discard2(void** ptr, const char* file, int line);
 void Z_ChangeTag2(void* ptr, const zoneTag_e tag, const char* file, int line);
 void Z_ChangeOwner2(void* ptr, void* user, const char* file, int line);
 char* Z_StrDup2(const char* s, const zoneTag_e tag, const char* file, int line);
+void* Z_MallocSlab2(size_t size, const zoneTag_e tag, const char* file, const int line);
+void Z_FreeSlab2(void* ptr, size_t size, const char* file, int line);
 
 typedef struct memblock_s
 {
@@ -115,3 +117,5 @@ inline void Z_Discard2(P ptr, const char* file, int line)
 #define Z_ChangeTag(p,t) Z_ChangeTag2(p,t,__FILE__,__LINE__)
 #define Z_ChangeOwner(p,u) Z_ChangeOwner2(p,u,__FILE__,__LINE__)
 #define Z_StrDup(s, t) Z_StrDup2(s,t, __FILE__,__LINE__)
+#define Z_MallocSlab(s,t) Z_MallocSlab2(s,t,__FILE__,__LINE__)
+#define Z_FreeSlab(p,s) Z_FreeSlab2(p,s,__FILE__,__LINE__)
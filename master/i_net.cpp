@@ -38,6 +38,12 @@
 #include <netdb.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
+#include <sys/select.h>
+#endif
+
+#ifdef __linux__
+#define NET_EPOLL_WAIT
+#include <sys/epoll.h>
 #endif
 
 #include "i_net.h"
@@ -60,6 +66,12 @@ netadr_t net_from;   // address of who sent the packet
 
 buf_t net_message(MAX_UDP_PACKET);
 
+#ifdef NET_EPOLL_WAIT
+// Waits on the socket, see NET_WaitForPacket.
+static int wait_epoll = -1;
+static bool wait_select = false;	// epoll could not be set up
+#endif
+
 //
 // UDPsocket
 //
@@ -96,6 +108,11 @@ void BindToLocalPort(SOCKET s, u_short port)
 
 void CloseNetwork(void)
 {
+#ifdef NET_EPOLL_WAIT
+	if (wait_epoll != -1)
+		close(wait_epoll);
+	wait_epoll = -1;
+#endif
 	closesocket(net_socket);
 #ifdef _WIN32
 	WSACleanup();
@@ -220,6 +237,62 @@ int NET_GetPacket(void)
     return ret;
 }
 
+//
+// NET_WaitForPacket
+//
+// Sleeps until a packet arrives or timeout milliseconds have passed.  Returns
+// true if there is a packet waiting to be read.
+//
+bool NET_WaitForPacket(int timeout)
+{
+#ifdef NET_EPOLL_WAIT
+	if (wait_epoll == -1 && !wait_select)
+	{
+		wait_epoll = epoll_create(1);
+		if (wait_epoll == -1)
+			printf("NET_WaitForPacket: %s\n", strerror(errno));
+		else
+		{
+			struct epoll_event ev;
+			memset(&ev, 0, sizeof(ev));
+			ev.events = EPOLLIN;
+			ev.data.fd = net_socket;
+			if (epoll_ctl(wait_epoll, EPOLL_CTL_ADD, net_socket, &ev) == -1)
+			{
+				printf("NET_WaitForPacket: epoll_ctl: %s\n", strerror(errno));
+				close(wait_epoll);
+				wait_epoll = -1;
+			}
+		}
+
+		// without epoll, keep waiting with select
+		if (wait_epoll == -1)
+			wait_select = true;
+	}
+
+	if (wait_epoll != -1)
+	{
+		struct epoll_event event;
+		int count = epoll_wait(wait_epoll, &event, 1, timeout);
+		if (count == -1 && errno != EINTR)
+			printf("NET_WaitForPacket: %s\n", strerror(errno));
+
+		return count > 0;
+	}
+#endif
+
+	fd_set readfds;
+	struct timeval tv;
+
+	FD_ZERO(&readfds);
+	FD_SET((SOCKET)net_socket, &readfds);
+
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = (timeout % 1000) * 1000;
+
+	return select(net_socket + 1, &readfds, NULL, NULL, &tv) > 0;
+}
+
 void NET_SendPacket(int length, byte *data, netadr_t to)
 {
     int ret;
@@ -309,6 +309,7 @@ char *NET_AdrToString(netadr_t a, bool displayport = true);
 bool NET_StringToAdr(char *s, netadr_t *a);
 bool NET_CompareAdr(netadr_t a, netadr_t b);
 int  NET_GetPacket(void);
+bool NET_WaitForPacket(int timeout);
 void NET_SendPacket(int length, byte *data, netadr_t to);
 
 #endif
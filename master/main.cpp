@@ -31,7 +31,8 @@
 
 #include <string>
 #include <vector>
-#include <list>
+#include <deque>
+#include <map>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -54,10 +55,20 @@
 
 using namespace std;
 
-#define MAX_SERVERS					1024
+#define MAX_SERVERS					4096
 #define MAX_SERVERS_PER_IP			64
-#define MAX_SERVER_AGE				5000
-#define MAX_UNVERIFIED_SERVER_AGE	1000
+#define MAX_SERVER_AGE				250		// seconds
+#define MAX_UNVERIFIED_SERVER_AGE	50		// seconds
+
+#define TICK_TIME					50		// milliseconds between ticks
+#define DUMP_TIME					5000	// milliseconds between dumps
+#define PINGS_PER_TICK				32
+
+// the launcher reply is split into packets of at most this many servers
+#define SERVERS_PER_PACKET			200
+
+// one wheel slot per second, covering more than the longest server age
+#define WHEEL_SLOTS					256
 
 #define LOGFILE "master_log.txt"
 
@@ -66,7 +77,9 @@ buf_t message(MAX_UDP_PACKET);
 typedef struct server
 {
 	netadr_t addr;
-	int age;
+
+	// time in ms after which the server is dropped
+	uint64_t deadline;
 
 	// from server itself
 	string hostname;
@@ -80,44 +93,95 @@ typedef struct server
 	vector<int> playerteams;
 
 	unsigned int key_sent;
-	bool pinged, verified;
+	bool pinged, verified, ping_queued;
 
-	server() : age(0), players(0), maxplayers(0), gametype(0), skill(0), teamplay(0), ctfmode(0), key_sent(0), pinged(0), verified(0) { memset(&addr, 0, sizeof(addr)); }
+	server() : deadline(0), players(0), maxplayers(0), gametype(0), skill(0), teamplay(0), ctfmode(0), key_sent(0), pinged(0), verified(0), ping_queued(0) { memset(&addr, 0, sizeof(addr)); }
 
 } SServer;
 
-list<SServer> servers;
-list<SServer>::iterator ping_itr = servers.begin(); // this iterator must be updated when servers is changed
+// servers keyed by ip:port, see serverKey
+typedef map<uint64_t, SServer> servermap_t;
+servermap_t servers;
 
-bool ipReachedLimit(netadr_t addr)
+// number of verified servers per ip
+map<uint32_t, int> verified_per_ip;
+
+// servers waiting to be pinged
+deque<uint64_t> ping_queue;
+
+// timer wheel of server deadlines.  Each server has exactly one entry, in the
+// slot of a second at or before its deadline.  A server whose deadline was
+// pushed back is moved to a later slot when its old slot comes up.
+vector<uint64_t> timer_wheel[WHEEL_SLOTS];
+uint64_t wheel_second;
+
+// launcher replies, rebuilt only when the verified servers change
+vector<vector<byte> > list_packets;
+bool list_dirty = true;
+
+// the ./latest file is only rewritten when a server changes
+bool latest_dirty = true;
+
+// milliseconds since an arbitrary point, 64 bits so it never wraps
+uint64_t getTimeMs(void)
+{
+#ifdef _WIN32
+	return GetTickCount64();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+uint32_t ipKey(const netadr_t &addr)
+{
+	return ((uint32_t)addr.ip[0] << 24) | ((uint32_t)addr.ip[1] << 16) |
+	       ((uint32_t)addr.ip[2] << 8) | (uint32_t)addr.ip[3];
+}
+
+uint64_t serverKey(const netadr_t &addr)
+{
+	return ((uint64_t)ipKey(addr) << 16) | addr.port;
+}
+
+void scheduleServer(uint64_t key, uint64_t deadline)
+{
+	timer_wheel[(deadline / 1000) % WHEEL_SLOTS].push_back(key);
+}
+
+void refreshServer(SServer &s, uint64_t now)
+{
+	s.deadline = now + 1000 * (s.verified ? MAX_SERVER_AGE : MAX_UNVERIFIED_SERVER_AGE);
+}
+
+void queuePing(uint64_t key, SServer &s)
 {
-	list<SServer>::iterator itr;
-	int verifiedservers = 0;
+	if (s.ping_queued)
+		return;
 
-	// count verified servers
-	for (itr = servers.begin(); itr != servers.end(); ++itr)
-		if ((*itr).verified && memcmp(&(*itr).addr.ip, &addr.ip, 4) == 0)
-			verifiedservers++;
+	s.ping_queued = true;
+	ping_queue.push_back(key);
+}
 
-	return verifiedservers >= MAX_SERVERS_PER_IP;
+bool ipReachedLimit(netadr_t addr)
+{
+	map<uint32_t, int>::iterator itr = verified_per_ip.find(ipKey(addr));
+
+	return itr != verified_per_ip.end() && itr->second >= MAX_SERVERS_PER_IP;
 }
 
-void addServer(netadr_t addr)
+void addServer(netadr_t addr, uint64_t now)
 {
-	list<SServer>::iterator itr;
-	SServer temp;
+	uint64_t key = serverKey(addr);
+	servermap_t::iterator itr = servers.find(key);
 
-	for (itr = servers.begin(); itr != servers.end(); ++itr)
+	if (itr != servers.end())
 	{
-		if (memcmp(&(*itr).addr.ip, &addr.ip, 4) == 0)
-		{
-			if ((*itr).addr.port == addr.port)
-			{
-				(*itr).age = 0;
-				(*itr).pinged = false;
-				return;
-			}
-		}
+		refreshServer(itr->second, now);
+		itr->second.pinged = false;
+		queuePing(key, itr->second);
+		return;
 	}
 
 	if (servers.size() < MAX_SERVERS)
@@ -125,9 +189,11 @@ void addServer(netadr_t addr)
 		if(ipReachedLimit(addr))
 			return;
 
+		SServer &temp = servers[key];
 		memcpy(&temp.addr, &addr, sizeof(addr));
-		temp.age = 0;
-		servers.push_back(temp);
+		refreshServer(temp, now);
+		scheduleServer(key, temp.deadline);
+		queuePing(key, temp);
 
 		printf("Added new server: %s, %d total\n", NET_AdrToString(temp.addr), (int)servers.size());
 		FILE *fp = fopen(LOGFILE, "a");
@@ -145,114 +211,129 @@ void addServer(netadr_t addr)
 	printf("Failed to add server: %s, no slots left\n", NET_AdrToString(addr));
 }
 
-void addServerInfo(netadr_t addr)
+void addServerInfo(netadr_t addr, uint64_t now)
 {
-	list<SServer>::iterator itr;
 	size_t i;
 
-	for (itr = servers.begin(); itr != servers.end(); ++itr)
-	{
-		if (memcmp(&(*itr).addr.ip, &addr.ip, 4) != 0)
-			continue;
+	servermap_t::iterator itr = servers.find(serverKey(addr));
+	if (itr == servers.end())
+		return;
 
-		if ((*itr).addr.port != addr.port)
-			continue;
+	SServer &s = itr->second;
 
-		SServer &s = *itr;
+	if(!s.key_sent)
+		return;
 
-		if(!s.key_sent)
-			continue;
+	net_message.ReadLong();
 
-		net_message.ReadLong();
+	// check key against one we issued
+	if((unsigned)net_message.ReadLong() != s.key_sent)
+		return;
 
-		// check key against one we issued
-		if((unsigned)net_message.ReadLong() != s.key_sent)
-			continue;
+	// do not allow too many servers
+	if(!s.verified)
+	{
+		if(ipReachedLimit(s.addr))
+			return;
 
-		// do not allow too many servers
-		if(ipReachedLimit((*itr).addr))
-			continue;
+		verified_per_ip[ipKey(s.addr)]++;
+		list_dirty = true;
+	}
 
-		printf("Server info, IP = %s\n", NET_AdrToString(addr));
+	printf("Server info, IP = %s\n", NET_AdrToString(addr));
 
-		s.verified = true;
-		s.age = 0;
+	s.verified = true;
+	refreshServer(s, now);
+	latest_dirty = true;
 
-		s.hostname = net_message.ReadString();
-		s.players = net_message.ReadByte();
-		s.maxplayers = net_message.ReadByte();
-		s.map = net_message.ReadString();
+	s.hostname = net_message.ReadString();
+	s.players = net_message.ReadByte();
+	s.maxplayers = net_message.ReadByte();
+	s.map = net_message.ReadString();
 
-		int pwadcount = net_message.ReadByte();
-		if(pwadcount < 0)
-			pwadcount = 0;
+	int pwadcount = net_message.ReadByte();
+	if(pwadcount < 0)
+		pwadcount = 0;
 
-		s.pwads.resize(pwadcount);
+	s.pwads.resize(pwadcount);
 
-		for(i = 0; i < s.pwads.size(); i++)
-			s.pwads[i] = net_message.ReadString();
+	for(i = 0; i < s.pwads.size(); i++)
+		s.pwads[i] = net_message.ReadString();
 
-		s.gametype = net_message.ReadByte();
-		s.skill = net_message.ReadByte();
-		s.teamplay = net_message.ReadByte();
-		s.ctfmode = net_message.ReadByte();
+	s.gametype = net_message.ReadByte();
+	s.skill = net_message.ReadByte();
+	s.teamplay = net_message.ReadByte();
+	s.ctfmode = net_message.ReadByte();
 
-		byte playercount = net_message.ReadByte();
+	byte playercount = net_message.ReadByte();
 
-		s.playernames.resize(playercount);
-		s.playerfrags.resize(playercount);
-		s.playerpings.resize(playercount);
-		s.playerteams.resize(playercount);
+	s.playernames.resize(playercount);
+	s.playerfrags.resize(playercount);
+	s.playerpings.resize(playercount);
+	s.playerteams.resize(playercount);
 
-		for(i = 0; i < playercount; i++)
-		{
-			s.playernames[i] = net_message.ReadString();
-			s.playerfrags[i] = net_message.ReadShort();
-			s.playerpings[i] = net_message.ReadLong();
-			s.playerteams[i] = net_message.ReadByte();
-		}
+	for(i = 0; i < playercount; i++)
+	{
+		s.playernames[i] = net_message.ReadString();
+		s.playerfrags[i] = net_message.ReadShort();
+		s.playerpings[i] = net_message.ReadLong();
+		s.playerteams[i] = net_message.ReadByte();
+	}
+}
+
+void removeServer(servermap_t::iterator itr)
+{
+	SServer &s = itr->second;
+
+	if (s.verified)
+	{
+		map<uint32_t, int>::iterator count = verified_per_ip.find(ipKey(s.addr));
+		if (count != verified_per_ip.end() && --count->second <= 0)
+			verified_per_ip.erase(count);
 
-		break;
+		list_dirty = true;
+		latest_dirty = true;
 	}
 
-	return;
+	servers.erase(itr);
 }
 
-void ageServers(void)
+//
+// ageServers
+//
+// Drops the servers whose deadline has passed, visiting only the wheel slots
+// of the seconds that have gone by since the last call.
+//
+void ageServers(uint64_t now)
 {
-	list<SServer>::iterator itr;
+	uint64_t second = now / 1000;
 
-	itr = servers.begin();
+	// after a long stall every slot is due, so visit each of them only once
+	if (second - wheel_second > WHEEL_SLOTS)
+		wheel_second = second - WHEEL_SLOTS;
 
-	while (itr != servers.end())
+	while (wheel_second != second)
 	{
-		(*itr).age++;
+		vector<uint64_t> slot;
+		slot.swap(timer_wheel[wheel_second % WHEEL_SLOTS]);
+		wheel_second++;
 
-		if((*itr).verified)
+		for (size_t i = 0; i < slot.size(); i++)
 		{
-			if ((*itr).age > MAX_SERVER_AGE)
-			{
-				printf("Remote server timed out: %s, ", NET_AdrToString((*itr).addr));
-				if(ping_itr == itr)
-					++ping_itr;
-				itr = servers.erase(itr);
-				printf("%d total\n", (int)servers.size());
-			}
-			else
-				++itr;
-		}
-		else
-		{
-			if ((*itr).age > MAX_UNVERIFIED_SERVER_AGE)
+			servermap_t::iterator itr = servers.find(slot[i]);
+			if (itr == servers.end())
+				continue;
+
+			if (itr->second.deadline > now)
 			{
-				printf("Remote server timed out: %s, ", NET_AdrToString((*itr).addr));
-				if(ping_itr == itr)
-					++ping_itr;
-				itr = servers.erase(itr);
-				printf("%d total\n", (int)servers.size());
+				// heard from it since, check again later
+				scheduleServer(slot[i], itr->second.deadline);
+				continue;
 			}
-			else
-				++itr;
+
+			printf("Remote server timed out: %s, ", NET_AdrToString(itr->second.addr));
+			removeServer(itr);
+			printf("%d total\n", (int)servers.size());
 		}
 	}
 }
@@ -260,19 +341,23 @@ void ageServers(void)
 void dumpServersToFile(const char *file = "./latest")
 {
 	static bool file_error = false;
-	FILE *fp = fopen(file, "w");
+
+	// write to a temporary file and move it into place, so readers never see
+	// a partially written list
+	string tmpfile = string(file) + ".tmp";
+	FILE *fp = fopen(tmpfile.c_str(), "w");
 
 	if(!fp)
 	{
 		if(!file_error)
-			printf("error opening file %s for writing\n", file);
+			printf("error opening file %s for writing\n", tmpfile.c_str());
 		file_error = true;
 		return;
 	}
 
 	file_error = false;
 
-	list<SServer>::iterator itr;
+	servermap_t::iterator itr;
 
 	itr = servers.begin();
 
@@ -280,60 +365,86 @@ void dumpServersToFile(const char *file = "./latest")
 
 	while (itr != servers.end())
 	{
-		if(!(*itr).verified)
+		SServer &s = itr->second;
+
+		if(!s.verified)
 		{
 			++itr;
 			continue;
 		}
 
         string detectgametype = "ERROR";
-		if((*itr).gametype == 0)
+		if(s.gametype == 0)
 			detectgametype = "COOP";
 		else
 			detectgametype = "DM";
-		if((*itr).gametype == 1 && (*itr).teamplay == 1)
+		if(s.gametype == 1 && s.teamplay == 1)
 			detectgametype = "TEAM DM";
-		if((*itr).ctfmode == 1)
+		if(s.ctfmode == 1)
 			detectgametype = "CTF";
 
 		string str_wads;
-		for(size_t j = 0; j < (*itr).pwads.size(); j++)
+		for(size_t j = 0; j < s.pwads.size(); j++)
 		{
-			str_wads += (*itr).pwads[j];
+			str_wads += s.pwads[j];
 			str_wads += " ";
 		}
 		if(!str_wads.length())
 			str_wads = " ";
 
-		fprintf(fp, "\"%s\",\"%s\",\"%d/%d\",\"%s\",\"%s\",\"%s\"\n", (*itr).hostname.c_str(), (*itr).map.c_str(), (*itr).players, (*itr).maxplayers, str_wads.c_str(), detectgametype.c_str(), NET_AdrToString((*itr).addr, true));
+		fprintf(fp, "\"%s\",\"%s\",\"%d/%d\",\"%s\",\"%s\",\"%s\"\n", s.hostname.c_str(), s.map.c_str(), s.players, s.maxplayers, str_wads.c_str(), detectgametype.c_str(), NET_AdrToString(s.addr, true));
 
 		++itr;
 	}
 
     fclose(fp);
+
+#ifdef _WIN32
+	remove(file);
+#endif
+	if (rename(tmpfile.c_str(), file) != 0)
+		printf("error replacing file %s\n", file);
 }
 
+//
+// writeServerData
+//
+// Serializes the verified servers into launcher replies.  Every packet
+// carries its own count, so a list too long for one packet is split.
+//
 void writeServerData(void)
 {
-	list<SServer>::iterator itr;
-	size_t num_verified = 0;
+	servermap_t::iterator itr = servers.begin();
 
-	// count verified servers
-	for (itr = servers.begin(); itr != servers.end(); ++itr)
-		if((*itr).verified)
-			num_verified++;
+	list_packets.clear();
 
-	message.WriteShort(num_verified);
-
-	for (itr = servers.begin(); itr != servers.end(); ++itr)
+	do
 	{
-		if(!(*itr).verified)
-			continue;
+		message.clear();
+		message.WriteLong(LAUNCHER_CHALLENGE);
 
-		for (int i = 0; i < 4; ++i)
-			message.WriteByte((*itr).addr.ip[i]);
-		message.WriteShort(htons((*itr).addr.port));
-	}
+		size_t countpos = message.cursize;
+		message.WriteShort(0);
+
+		short count = 0;
+		for (; itr != servers.end() && count < SERVERS_PER_PACKET; ++itr)
+		{
+			if(!itr->second.verified)
+				continue;
+
+			for (int i = 0; i < 4; ++i)
+				message.WriteByte(itr->second.addr.ip[i]);
+			message.WriteShort(htons(itr->second.addr.port));
+			count++;
+		}
+
+		message.data[countpos] = count & 0xff;
+		message.data[countpos + 1] = count >> 8;
+
+		list_packets.push_back(vector<byte>(message.data, message.data + message.cursize));
+	} while (itr != servers.end());
+
+	list_dirty = false;
 }
 
 void daemon_init(void)
@@ -377,80 +488,111 @@ void pingServer(SServer &s)
 	s.pinged = true;
 }
 
-int main()
+void pingServers(void)
 {
-	int challenge;
-	localport = MASTERPORT;
-	InitNetCommon();
+	for (int i = 0; i < PINGS_PER_TICK && !ping_queue.empty(); i++)
+	{
+		servermap_t::iterator itr = servers.find(ping_queue.front());
+		ping_queue.pop_front();
 
-	daemon_init();
+		if (itr == servers.end())
+			continue;
 
-	printf("NovaDoom Master Started\n");
+		itr->second.ping_queued = false;
+		pingServer(itr->second);
+	}
+}
 
-	while (true)
+void readPackets(uint64_t now)
+{
+	int challenge;
+
+	while (NET_GetPacket())
 	{
-		while (NET_GetPacket())
-		{
-			challenge = net_message.ReadLong();
+		challenge = net_message.ReadLong();
 
-			switch (challenge)
+		switch (challenge)
+		{
+		case 0:
+		case SERVER_CHALLENGE:
+			if(net_message.BytesLeftToRead() > 2)
 			{
-			case 0:
-			case SERVER_CHALLENGE:
-				if(net_message.BytesLeftToRead() > 2)
-				{
-					// full reply with deathmatch, wad, etc
-					addServerInfo(net_from);
-				}
-				else
-				{
-					// plain contact
-					if(net_message.BytesLeftToRead() == 2)
-					{
-						unsigned short use_port = net_message.ReadShort();
-						net_from.port = htons(use_port);
-					}
-
-					addServer(net_from);
-				}
-			    break;
-			case LAUNCHER_CHALLENGE:
-				if(net_message.BytesLeftToRead() > 0)
+				// full reply with deathmatch, wad, etc
+				addServerInfo(net_from, now);
+			}
+			else
+			{
+				// plain contact
+				if(net_message.BytesLeftToRead() == 2)
 				{
-					printf("Master syncing server list (ignored), IP = %s\n", NET_AdrToString(net_from));
+					unsigned short use_port = net_message.ReadShort();
+					net_from.port = htons(use_port);
 				}
-				else
-				{
-					printf("Client request IP = %s\n", NET_AdrToString(net_from));
-					message.clear();
-					message.WriteLong(LAUNCHER_CHALLENGE);
+
+				addServer(net_from, now);
+			}
+		    break;
+		case LAUNCHER_CHALLENGE:
+			if(net_message.BytesLeftToRead() > 0)
+			{
+				printf("Master syncing server list (ignored), IP = %s\n", NET_AdrToString(net_from));
+			}
+			else
+			{
+				printf("Client request IP = %s\n", NET_AdrToString(net_from));
+
+				if (list_dirty)
 					writeServerData();
-					NET_SendPacket(message.cursize, message.data, net_from);
-				}
-			    break;
-			default:
-				break;
+
+				for (size_t i = 0; i < list_packets.size(); i++)
+					NET_SendPacket(list_packets[i].size(), &list_packets[i][0], net_from);
 			}
+		    break;
+		default:
+			break;
 		}
+	}
+}
 
-		static int counter = 0;
+int main()
+{
+	localport = MASTERPORT;
+	InitNetCommon();
 
-		usleep(50*1000); // every 50ms // denis - fixme - use proper timer, age of servers should increase even during packet sending
+	daemon_init();
 
-		ageServers();
+	printf("NovaDoom Master Started\n");
 
-		if(!(counter%100))
-		{
-			dumpServersToFile();
+	uint64_t now = getTimeMs();
+	uint64_t next_tick = now + TICK_TIME;
+	uint64_t next_dump = now;
+	wheel_second = now / 1000;
+
+	while (true)
+	{
+		// sleep until a packet arrives or the next tick is due
+		int timeout = next_tick > now ? (int)(next_tick - now) : 0;
 
-			if (ping_itr == servers.end())
-				ping_itr = servers.begin();
+		if (NET_WaitForPacket(timeout))
+			readPackets(getTimeMs());
 
-			if(ping_itr != servers.end())
-				pingServer(*(ping_itr++));
-		}
+		now = getTimeMs();
+		if (now < next_tick)
+			continue;
+
+		next_tick += TICK_TIME;
+		if (now >= next_tick)
+			next_tick = now + TICK_TIME;
 
-		counter++;
+		ageServers(now);
+		pingServers();
+
+		if (latest_dirty && now >= next_dump)
+		{
+			dumpServersToFile();
+			latest_dirty = false;
+			next_dump = now + DUMP_TIME;
+		}
 	}
 
 	servers.clear();
@@ -83,6 +83,7 @@ void C_DoCommand(std::string_view cmd, uint32_t key = 0);
 
 #ifdef UNIX
 void daemon_init();
+int I_SpawnInstances(int count);
 #endif
 
 void D_DoomLoop (void);
@@ -108,7 +109,7 @@ void D_DoomLoop (void)
 	{
 		try
 		{
-			D_RunTics(SV_RunTics, SV_DisplayTics);
+			D_RunTics(SV_RunTics, SV_DisplayTics, SV_GetPackets);
 		}
 		catch (CRecoverableError &error)
 		{
@@ -322,6 +323,25 @@ void D_DoomMain()
 	D_Init();
 	atterm(D_Shutdown);
 
+#ifdef UNIX
+	// Run several game instances from this one process image, each on its
+	// own port.  Forking here lets them share the WADs and tables loaded
+	// above.  Daemonize first so the instances follow the host into the
+	// background.
+	bool daemonized = false;
+	const char* instances = Args.CheckValue("-instances");
+	if (instances && atoi(instances) > 1)
+	{
+		if (Args.CheckParm("-fork"))
+		{
+			daemon_init();
+			daemonized = true;
+		}
+
+		::server_instance = I_SpawnInstances(atoi(instances));
+	}
+#endif
+
 	PrintFmt(PRINT_HIGH, "SV_InitNetwork: Checking network game status.\n");
 	SV_InitNetwork();
 
@@ -388,7 +408,7 @@ void D_DoomMain()
 	PrintFmt(PRINT_HIGH, "========== NovaDoom Server Initialized ==========\n");
 
 	#ifdef UNIX
-	if (Args.CheckParm("-fork"))
+	if (Args.CheckParm("-fork") && !daemonized)
 		daemon_init();
 	#endif
 
@@ -29,12 +29,12 @@
 
 #include "d_netinf.h"
 #include "sv_main.h"
+#include "sv_sqp.h"
 #include "v_textcolors.h"
 
 bool SetServerVar (std::string_view name, const char *value)
 {
-	cvar_t *dummy;
-	cvar_t *var = cvar_t::FindCVar (name, &dummy);
+	cvar_t *var = cvar_t::FindCVar (name);
 
 	if (var)
 	{
@@ -53,6 +53,7 @@ void D_SendServerInfoChange (const cvar_t *cvar, const char *value)
 	SetServerVar(cvar->name().c_str(), value);
 	SV_BroadcastPrintFmt("{}{} has been modified to {}!\n", TEXTCOLOR_YELLOW, cvar->name(), value);
 	SV_ServerSettingChange ();
+	SV_QryInvalidate();
 }
 
 FArchive &operator<< (FArchive &arc, UserInfo &info)
@@ -36,6 +36,10 @@
 #ifdef UNIX
 #include <unistd.h>
 #include <signal.h>
+#include <fcntl.h>
+#endif
+#ifdef __linux__
+#include <sys/prctl.h>
 #endif
 
 #include <stdlib.h>
@@ -260,6 +264,67 @@ void daemon_init(void)
     fclose(fpid);
 }
 
+//
+// I_SpawnInstances
+//
+// Fork count - 1 additional game instances.  Everything loaded up to this
+// point (WADs, lump cache, object tables) is shared copy-on-write between
+// them, while the level and player state each instance goes on to build is
+// its own.  Returns the index of the instance this process runs, 0 being
+// the host.
+//
+int I_SpawnInstances(int count)
+{
+	for (int i = 1; i < count; i++)
+	{
+		const pid_t pid = fork();
+		if (pid == -1)
+		{
+			PrintFmt(PRINT_WARNING, "I_SpawnInstances: could not fork instance {}: {}\n",
+			         i, strerror(errno));
+			break;
+		}
+
+		if (pid != 0)
+			continue;
+
+#ifdef __linux__
+		// Instances go away with their host.
+		prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+
+		// Only the host reads console input.
+		const int devnull = open("/dev/null", O_RDONLY);
+		if (devnull != -1)
+		{
+			dup2(devnull, STDIN_FILENO);
+			close(devnull);
+		}
+
+		// Give every instance its own log next to the host's.
+		if (LOG.is_open())
+		{
+			std::string logname = LOG_FILE;
+			const size_t dot = logname.find_last_of('.');
+			const size_t slash = logname.find_last_of("/\\");
+			const std::string suffix = fmt::format("-{}", i);
+			if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+				logname.insert(dot, suffix);
+			else
+				logname += suffix;
+
+			LOG.close();
+			LOG_FILE = logname;
+			LOG.open(LOG_FILE.c_str(), std::ios::app);
+		}
+
+		PrintFmt(PRINT_HIGH, "Running as game instance {} of {}\n", i, count);
+		return i;
+	}
+
+	return 0;
+}
+
 int main (int argc, char **argv)
 {
 	// [AM] Set crash callbacks, so we get something useful from crashes.
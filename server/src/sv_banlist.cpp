@@ -25,7 +25,9 @@
 
 #include "novadoom.h"
 
+#include <algorithm>
 #include <ctime>
+#include <functional>
 #include <sstream>
 
 #include "win32inc.h"
@@ -181,8 +183,173 @@ std::string IPRange::string() const
 	return buffer.str();
 }
 
+//// IPRangeTrie ////
+
+// Constructor, the root node is always present.
+IPRangeTrie::IPRangeTrie() : nodes(1)
+{
+}
+
+// Remove every range from the trie.
+void IPRangeTrie::clear()
+{
+	nodes.assign(1, Node());
+}
+
+// Return the child of node that the given range follows at depth, or 0 if
+// there is no such child.
+size_t IPRangeTrie::child(size_t node, const IPRange &range, size_t depth) const
+{
+	if (range.masked(depth))
+		return nodes[node].wildcard;
+
+	const byte octet = range.octet(depth);
+	const std::vector<std::pair<byte, size_t> > &children = nodes[node].children;
+	std::vector<std::pair<byte, size_t> >::const_iterator it =
+	    std::lower_bound(children.begin(), children.end(),
+	                     std::make_pair(octet, (size_t)0));
+
+	if (it == children.end() || it->first != octet)
+		return 0;
+
+	return it->second;
+}
+
+// Add the list index of a range to the trie.
+void IPRangeTrie::insert(const IPRange &range, size_t index)
+{
+	size_t node = 0;
+	for (size_t depth = 0; depth < 4; depth++)
+	{
+		size_t next = child(node, range, depth);
+		if (next == 0)
+		{
+			next = nodes.size();
+			nodes.push_back(Node());
+
+			if (range.masked(depth))
+			{
+				nodes[node].wildcard = next;
+			}
+			else
+			{
+				std::vector<std::pair<byte, size_t> > &children = nodes[node].children;
+				const std::pair<byte, size_t> entry(range.octet(depth), next);
+				children.insert(std::lower_bound(children.begin(), children.end(), entry),
+				                entry);
+			}
+		}
+		node = next;
+	}
+
+	std::vector<size_t> &indices = nodes[node].indices;
+	std::vector<size_t>::iterator it = std::lower_bound(indices.begin(), indices.end(), index);
+	if (it == indices.end() || *it != index)
+		indices.insert(it, index);
+}
+
+// Remove the list index of a range from the trie.
+void IPRangeTrie::erase(const IPRange &range, size_t index)
+{
+	size_t node = 0;
+	for (size_t depth = 0; depth < 4; depth++)
+	{
+		node = child(node, range, depth);
+		if (node == 0)
+			return;
+	}
+
+	std::vector<size_t> &indices = nodes[node].indices;
+	std::vector<size_t>::iterator it = std::lower_bound(indices.begin(), indices.end(), index);
+	if (it != indices.end() && *it == index)
+		indices.erase(it);
+}
+
+// Renumber the indices that follow an entry removed from the list.
+void IPRangeTrie::shift(size_t removed)
+{
+	for (auto& node : nodes)
+	{
+		for (auto& index : node.indices)
+		{
+			if (index > removed)
+				index--;
+		}
+	}
+}
+
+// Find the lowest list index whose range matches the given address.
+bool IPRangeTrie::match(const netadr_t &address, size_t &index) const
+{
+	size_t best = (size_t)-1;
+	match(0, address, 0, best);
+
+	if (best == (size_t)-1)
+		return false;
+
+	index = best;
+	return true;
+}
+
+void IPRangeTrie::match(size_t node, const netadr_t &address, size_t depth,
+                        size_t &best) const
+{
+	if (depth == 4)
+	{
+		if (!nodes[node].indices.empty())
+			best = std::min(best, nodes[node].indices.front());
+		return;
+	}
+
+	const std::vector<std::pair<byte, size_t> > &children = nodes[node].children;
+	std::vector<std::pair<byte, size_t> >::const_iterator it =
+	    std::lower_bound(children.begin(), children.end(),
+	                     std::make_pair(address.ip[depth], (size_t)0));
+
+	if (it != children.end() && it->first == address.ip[depth])
+		match(it->second, address, depth + 1, best);
+
+	if (nodes[node].wildcard)
+		match(nodes[node].wildcard, address, depth + 1, best);
+}
+
 //// Banlist ////
 
+// Add a ban that is already in the banlist to the lookup structures, unless
+// it has already expired.
+void Banlist::index_ban(size_t index, time_t now)
+{
+	const Ban &ban = this->banlist[index];
+	if (ban.expire != 0 && ban.expire <= now)
+	{
+		return;
+	}
+
+	this->bantrie.insert(ban.range, index);
+
+	if (ban.expire != 0)
+	{
+		this->expireheap.emplace_back(ban.expire, index);
+		std::push_heap(this->expireheap.begin(), this->expireheap.end(),
+		               std::greater<std::pair<time_t, size_t> >());
+	}
+}
+
+// Take bans that have expired out of the lookup structures.  They stay in
+// the banlist itself.
+void Banlist::expire_bans(time_t now)
+{
+	while (!this->expireheap.empty() && this->expireheap.front().first <= now)
+	{
+		std::pop_heap(this->expireheap.begin(), this->expireheap.end(),
+		              std::greater<std::pair<time_t, size_t> >());
+		const size_t index = this->expireheap.back().second;
+		this->expireheap.pop_back();
+
+		this->bantrie.erase(this->banlist[index].range, index);
+	}
+}
+
 size_t Banlist::size()
 {
 	return this->banlist.size();
@@ -206,6 +373,7 @@ bool Banlist::add(const std::string &address, const time_t expire,
 
 	// Add the ban to the banlist
 	this->banlist.push_back(ban);
+	this->index_ban(this->banlist.size() - 1, time(NULL));
 
 	return true;
 }
@@ -229,6 +397,7 @@ bool Banlist::add(player_t &player, const time_t expire,
 
 	// Add the ban to the banlist
 	this->banlist.push_back(ban);
+	this->index_ban(this->banlist.size() - 1, time(NULL));
 
 	return true;
 }
@@ -247,6 +416,7 @@ bool Banlist::add_exception(const std::string &address, const std::string &name)
 	// Add the exception to the banlist.
 	exception.name = name;
 	this->exceptionlist.push_back(exception);
+	this->exceptiontrie.insert(exception.range, this->exceptionlist.size() - 1);
 
 	return true;
 }
@@ -267,6 +437,7 @@ bool Banlist::add_exception(player_t &player)
 
 	// Add the exception to the banlist.
 	this->exceptionlist.push_back(exception);
+	this->exceptiontrie.insert(exception.range, this->exceptionlist.size() - 1);
 
 	return true;
 }
@@ -276,24 +447,21 @@ bool Banlist::add_exception(player_t &player)
 // returns false.
 bool Banlist::check(const netadr_t &address, Ban &baninfo)
 {
+	size_t index;
+
 	// Check against exception list.
-	for (const auto& exception : this->exceptionlist)
+	if (this->exceptiontrie.match(address, index))
 	{
-		if (exception.range.check(address))
-		{
-			return false;
-		}
+		return false;
 	}
 
-	// Check against banlist.
-	for (const auto& ban : this->banlist)
+	// Check against banlist.  The first matching ban that hasn't expired
+	// wins, as the trie only holds bans that haven't expired.
+	this->expire_bans(time(NULL));
+	if (this->bantrie.match(address, index))
 	{
-		if (ban.range.check(address) && (ban.expire == 0 ||
-		                                 ban.expire > time(NULL)))
-		{
-			baninfo = ban;
-			return true;
-		}
+		baninfo = this->banlist[index];
+		return true;
 	}
 
 	return false;
@@ -411,7 +579,27 @@ bool Banlist::remove(size_t index)
 		return false;
 	}
 
+	this->bantrie.erase(this->banlist[index].range, index);
 	this->banlist.erase(this->banlist.begin() + index);
+	this->bantrie.shift(index);
+
+	// Renumber the expiry heap, which keeps its order since expire times
+	// don't change.
+	for (size_t i = 0; i < this->expireheap.size();)
+	{
+		if (this->expireheap[i].second == index)
+		{
+			this->expireheap[i] = this->expireheap.back();
+			this->expireheap.pop_back();
+			continue;
+		}
+		if (this->expireheap[i].second > index)
+			this->expireheap[i].second--;
+		i++;
+	}
+	std::make_heap(this->expireheap.begin(), this->expireheap.end(),
+	               std::greater<std::pair<time_t, size_t> >());
+
 	return true;
 }
 
@@ -430,7 +618,9 @@ bool Banlist::remove_exception(size_t index)
 		return false;
 	}
 
+	this->exceptiontrie.erase(this->exceptionlist[index].range, index);
 	this->exceptionlist.erase(this->exceptionlist.begin() + index);
+	this->exceptiontrie.shift(index);
 	return true;
 }
 
@@ -438,12 +628,15 @@ bool Banlist::remove_exception(size_t index)
 void Banlist::clear()
 {
 	this->banlist.clear();
+	this->bantrie.clear();
+	this->expireheap.clear();
 }
 
 // Clear the exceptionlist.
 void Banlist::clear_exceptions()
 {
 	this->exceptionlist.clear();
+	this->exceptiontrie.clear();
 }
 
 // Fills a JSON array with bans.
@@ -492,6 +685,9 @@ bool Banlist::json_replace(const Json::Value &json_bans)
 	if (json_bans.isNull() || json_bans.empty())
 		return true;
 
+	const time_t now = time(NULL);
+	this->banlist.reserve(json_bans.size());
+
 	for (const auto& json_ban : json_bans)
 	{
 		Ban ban;
@@ -523,6 +719,7 @@ bool Banlist::json_replace(const Json::Value &json_bans)
 			ban.reason = value.asString();
 
 		this->banlist.push_back(ban);
+		this->index_ban(this->banlist.size() - 1, now);
 	}
 
 	return true;
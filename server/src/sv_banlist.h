@@ -44,6 +44,37 @@ public:
 	void set(const netadr_t &address);
 	bool set(const std::string &input);
 	std::string string() const;
+	[[nodiscard]] byte octet(size_t i) const { return ip[i]; }
+	[[nodiscard]] bool masked(size_t i) const { return mask[i]; }
+};
+
+// A trie over the four octets of an IPv4 address, where each node has a
+// child per octet value plus a wildcard child for masked octets.  The leaves
+// hold the indices of the list entries whose range ends there, so an address
+// is checked by following at most 16 paths instead of every range.
+class IPRangeTrie
+{
+public:
+	IPRangeTrie();
+	void clear();
+	void insert(const IPRange &range, size_t index);
+	void erase(const IPRange &range, size_t index);
+	void shift(size_t removed);
+	[[nodiscard]] bool match(const netadr_t &address, size_t &index) const;
+private:
+	struct Node
+	{
+		Node() : wildcard(0) { }
+		std::vector<std::pair<byte, size_t> > children; // sorted by octet
+		size_t wildcard;                                 // 0 if none
+		std::vector<size_t> indices;                     // sorted, leaves only
+	};
+
+	std::vector<Node> nodes;
+
+	size_t child(size_t node, const IPRange &range, size_t depth) const;
+	void match(size_t node, const netadr_t &address, size_t depth,
+	           size_t &best) const;
 };
 
 struct Ban
@@ -94,6 +125,15 @@ public:
 private:
 	std::vector<Ban> banlist;
 	std::vector<Exception> exceptionlist;
+
+	// Lookup structures mirroring banlist and exceptionlist.  Bans leave the
+	// trie when they expire, using a min-heap of (expire, index).
+	IPRangeTrie bantrie;
+	IPRangeTrie exceptiontrie;
+	std::vector<std::pair<time_t, size_t> > expireheap;
+
+	void index_ban(size_t index, time_t now);
+	void expire_bans(time_t now);
 };
 
 void SV_InitBanlist();
@@ -111,6 +111,33 @@ CVAR_RANGE(		sv_flooddelay, "1.5", "Chat flood protection time (in seconds)",
 CVAR_RANGE_FUNC_DECL(sv_maxrate, "200", "Forces clients to be on or below this rate",
 				CVARTYPE_INT, CVAR_SERVERARCHIVE | CVAR_NOENABLEDISABLE, 7.0f, 100000.0f)
 
+CVAR(			sv_interest, "0", "Rank monster and missile updates by relevance and send them within a per-tic byte budget",
+				CVARTYPE_BOOL, CVAR_SERVERARCHIVE)
+
+CVAR_RANGE(		sv_interestbudget, "0", "Bytes of actor updates each client may receive per tic when sv_interest is enabled, 0 derives it from sv_maxrate",
+				CVARTYPE_INT, CVAR_SERVERARCHIVE | CVAR_NOENABLEDISABLE, 0.0f, 65536.0f)
+
+CVAR(			sv_snapshots, "0", "Send monster and missile state to clients that support it as delta-compressed world snapshots",
+				CVARTYPE_BOOL, CVAR_SERVERARCHIVE)
+
+CVAR_RANGE(		sv_snapshotrate, "2", "Tics between world snapshots when sv_snapshots is enabled",
+				CVARTYPE_INT, CVAR_SERVERARCHIVE | CVAR_NOENABLEDISABLE, 1.0f, 7.0f)
+
+CVAR(			sv_waddownload, "0", "Allow clients to download the server's non-commercial WAD files directly from the server",
+				CVARTYPE_BOOL, CVAR_SERVERARCHIVE | CVAR_SERVERINFO)
+
+CVAR_RANGE(		sv_waddownloadrate, "256", "Maximum rate in KiB/s at which each client may download WAD files from the server",
+				CVARTYPE_INT, CVAR_SERVERARCHIVE | CVAR_NOENABLEDISABLE, 8.0f, 100000.0f)
+
+CVAR_RANGE(		sv_waddownloadtotal, "1024", "Maximum rate in KiB/s at which the server sends WAD files to all downloading clients combined",
+				CVARTYPE_INT, CVAR_SERVERARCHIVE | CVAR_NOENABLEDISABLE, 8.0f, 1000000.0f)
+
+CVAR_RANGE(		sv_qryrate, "4", "Maximum rate in queries per second at which each address may query the server, 0 to disable",
+				CVARTYPE_FLOAT, CVAR_SERVERARCHIVE | CVAR_NOENABLEDISABLE, 0.0f, 1000.0f)
+
+CVAR_RANGE(		sv_qryburst, "8", "Number of queries an address may send in a burst before sv_qryrate applies",
+				CVARTYPE_FLOAT, CVAR_SERVERARCHIVE | CVAR_NOENABLEDISABLE, 1.0f, 1000.0f)
+
 #ifdef ODA_HAVE_MINIUPNP
 CVAR(			sv_upnp, "1", "Enable UPnP support",
 				CVARTYPE_BOOL, CVAR_SERVERARCHIVE)
@@ -0,0 +1,445 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//  Serving WAD files to clients that are missing them.
+//
+//  A client that can't load the server's WADs never gets as far as a player
+//  slot, so downloads are connectionless, like RCON sessions.  The client
+//  asks for a file by MD5 with the token from the launcher reply and the
+//  number of bytes it already has, which doubles as the acknowledgement of
+//  everything before it:
+//
+//    [long DOWNLOAD_CHALLENGE][long token][string md5][long offset][byte resend]
+//
+//  and the server answers with a window of chunks past that offset:
+//
+//    [long DOWNLOAD_CHALLENGE][long offset][long filesize][long crc32]
+//    [short length][length bytes]
+//
+//  or with an offset of -1 followed by a message string if it won't serve
+//  the file.  A client that notices a gap asks for a resend, and the server
+//  also goes back to the acknowledged offset when nothing has been
+//  acknowledged for a while.  Starting over from the bytes already on disk
+//  is just a request with a larger offset, so transfers are resumable.
+//
+//-----------------------------------------------------------------------------
+
+#include "novadoom.h"
+
+#include "sv_download.h"
+
+#include <algorithm>
+
+#include "c_cvars.h"
+#include "crc32.h"
+#include "i_net.h"
+#include "i_system.h"
+#include "m_fileio.h"
+#include "sv_main.h"
+#include "w_ident.h"
+#include "w_wad.h"
+
+EXTERN_CVAR(sv_waddownload)
+EXTERN_CVAR(sv_waddownloadrate)
+EXTERN_CVAR(sv_waddownloadtotal)
+
+bool SV_IsValidToken(DWORD token);
+
+namespace
+{
+
+// Payload of a single chunk.  Small enough not to be fragmented on any
+// sensible network.
+const size_t CHUNK_SIZE = 1024;
+
+// Bytes of a chunk packet that aren't payload.
+const size_t CHUNK_OVERHEAD = 18;
+
+// Chunks that may be in flight to a client before it acknowledges them.
+const size_t WINDOW_CHUNKS = 32;
+
+// Go back to the last acknowledged offset if nothing new has been
+// acknowledged for this long.
+const dtime_t RESEND_TIMEOUT = 1000;
+
+// Ignore repeated resend requests for this long after acting on one, since
+// every chunk that arrives past a gap asks again.
+const dtime_t RESEND_HOLDOFF = 100;
+
+// Forget clients that haven't sent a request for this long.
+const dtime_t SESSION_TIMEOUT = 10000;
+
+struct servedFile_t
+{
+	OMD5Hash md5;
+	std::string basename;
+	FILE* fp;
+	uint32_t length;
+};
+
+struct downloadSession_t
+{
+	netadr_t address;
+	OMD5Hash md5;
+	uint32_t acked;
+	uint32_t next;
+	double budget;
+	dtime_t lastrequest;
+	dtime_t lastprogress;
+	dtime_t lastresend;
+};
+
+std::vector<servedFile_t> servedfiles;
+std::vector<downloadSession_t> sessions;
+
+double totalbudget = 0.0;
+dtime_t lastrefill = 0;
+
+buf_t dl_message(MAX_UDP_PACKET);
+
+/**
+ * @brief Close any open files the server no longer has loaded.
+ */
+void PurgeServedFiles()
+{
+	for (std::vector<servedFile_t>::iterator it = servedfiles.begin();
+	     it != servedfiles.end();)
+	{
+		bool loaded = false;
+		for (const auto& wadfile : ::wadfiles)
+		{
+			if (wadfile.getMD5() == it->md5)
+			{
+				loaded = true;
+				break;
+			}
+		}
+
+		if (loaded)
+		{
+			++it;
+			continue;
+		}
+
+		fclose(it->fp);
+		it = servedfiles.erase(it);
+	}
+}
+
+/**
+ * @brief Find a loaded file that may be handed out, opening it on first use.
+ *
+ * @return The file, or NULL if it isn't loaded or mustn't be distributed.
+ */
+servedFile_t* FindServedFile(const OMD5Hash& md5)
+{
+	for (auto& file : servedfiles)
+	{
+		if (file.md5 == md5)
+			return &file;
+	}
+
+	if (W_IsFilehashCommercialWAD(md5))
+		return NULL;
+
+	for (const auto& wadfile : ::wadfiles)
+	{
+		if (wadfile.getMD5() != md5)
+			continue;
+
+		if (W_IsFilenameCommercialWAD(wadfile.getBasename()))
+			return NULL;
+
+		FILE* fp = fopen(wadfile.getFullpath().c_str(), "rb");
+		if (!fp)
+			return NULL;
+
+		const SDWORD length = M_FileLength(fp);
+		if (length <= 0)
+		{
+			fclose(fp);
+			return NULL;
+		}
+
+		servedFile_t file = {md5, wadfile.getBasename(), fp,
+		                     static_cast<uint32_t>(length)};
+		servedfiles.push_back(file);
+		return &servedfiles.back();
+	}
+
+	return NULL;
+}
+
+downloadSession_t* FindSession(const netadr_t& address)
+{
+	for (auto& session : sessions)
+	{
+		if (NET_CompareAdr(session.address, address))
+			return &session;
+	}
+
+	return NULL;
+}
+
+void SendError(netadr_t& to, const char* message)
+{
+	SZ_Clear(&dl_message);
+	MSG_WriteLong(&dl_message, DOWNLOAD_CHALLENGE);
+	MSG_WriteLong(&dl_message, -1);
+	MSG_WriteString(&dl_message, message);
+	NET_SendPacket(dl_message, to);
+}
+
+/**
+ * @brief Refill the per-client and total bandwidth budgets.
+ *
+ * Budgets are capped at one window, so a client that has been idle can't
+ * save up for a burst.
+ */
+void RefillBudgets(dtime_t now)
+{
+	if (lastrefill == 0)
+		lastrefill = now;
+
+	const double seconds = (now - lastrefill) / 1000.0;
+	lastrefill = now;
+
+	const double cap = WINDOW_CHUNKS * (CHUNK_SIZE + CHUNK_OVERHEAD);
+
+	totalbudget = std::min(totalbudget + sv_waddownloadtotal * 1024.0 * seconds,
+	                       std::max(cap, sv_waddownloadtotal * 1024.0 / TICRATE));
+
+	for (auto& session : sessions)
+	{
+		session.budget =
+		    std::min(session.budget + sv_waddownloadrate * 1024.0 * seconds, cap);
+	}
+}
+
+/**
+ * @brief Send a client as much of its window as its budget allows.
+ *
+ * @return False if the file went away and the session should be dropped.
+ */
+bool ServeSession(downloadSession_t& session, dtime_t now)
+{
+	servedFile_t* file = FindServedFile(session.md5);
+	if (file == NULL)
+	{
+		SendError(session.address, "File is no longer available for download");
+		return false;
+	}
+
+	// Nothing acknowledged for a while, the rest of the window was lost.
+	if (session.next > session.acked && now - session.lastprogress >= RESEND_TIMEOUT)
+	{
+		session.next = session.acked;
+		session.lastprogress = now;
+	}
+
+	const uint32_t windowend = session.acked + WINDOW_CHUNKS * CHUNK_SIZE;
+	const double cost = CHUNK_SIZE + CHUNK_OVERHEAD;
+
+	byte chunk[CHUNK_SIZE];
+	while (session.next < file->length && session.next < windowend &&
+	       session.budget >= cost && totalbudget >= cost)
+	{
+		const unsigned len =
+		    std::min<uint32_t>(CHUNK_SIZE, file->length - session.next);
+		if (W_ReadChunk(file->fp, session.next, len, chunk) != len)
+		{
+			SendError(session.address, "Server could not read file");
+			return false;
+		}
+
+		SZ_Clear(&dl_message);
+		MSG_WriteLong(&dl_message, DOWNLOAD_CHALLENGE);
+		MSG_WriteLong(&dl_message, session.next);
+		MSG_WriteLong(&dl_message, file->length);
+		MSG_WriteLong(&dl_message, crc32_fast(chunk, len));
+		MSG_WriteShort(&dl_message, len);
+		MSG_WriteChunk(&dl_message, chunk, len);
+		NET_SendPacket(dl_message, session.address);
+
+		session.next += len;
+		session.budget -= cost;
+		totalbudget -= cost;
+	}
+
+	return true;
+}
+
+} // namespace
+
+/**
+ * @brief Handle a connectionless request for a chunk of a file.
+ */
+void SV_DownloadRequest()
+{
+	if (!SV_IsValidToken(MSG_ReadLong()))
+		return;
+
+	const std::string md5str = MSG_ReadString();
+	const int offset = MSG_ReadLong();
+	const bool resend = MSG_ReadByte() != 0;
+
+	if (!sv_waddownload)
+	{
+		SendError(net_from, "Downloading is disabled on this server");
+		return;
+	}
+
+	OMD5Hash md5;
+	if (!OMD5Hash::makeFromHexStr(md5, md5str))
+		return;
+
+	servedFile_t* file = FindServedFile(md5);
+	if (file == NULL)
+	{
+		SendError(net_from, "File is not available for download");
+		return;
+	}
+
+	if (offset < 0 || static_cast<uint32_t>(offset) > file->length)
+	{
+		SendError(net_from, "Requested offset is out of range");
+		return;
+	}
+
+	const dtime_t now = I_MSTime();
+
+	downloadSession_t* session = FindSession(net_from);
+	if (session == NULL || session->md5 != md5)
+	{
+		if (session == NULL)
+		{
+			downloadSession_t newsession;
+			newsession.address = net_from;
+			newsession.budget = 0.0;
+			sessions.push_back(newsession);
+			session = &sessions.back();
+		}
+
+		session->md5 = md5;
+		session->acked = session->next = offset;
+		session->lastprogress = session->lastresend = now;
+
+		PrintFmt("{} is downloading {} from offset {}.\n", NET_AdrToString(net_from),
+		         file->basename, offset);
+	}
+
+	session->lastrequest = now;
+
+	if (static_cast<uint32_t>(offset) > session->acked)
+	{
+		session->acked = offset;
+		session->lastprogress = now;
+		if (session->next < session->acked)
+			session->next = session->acked;
+	}
+	else if (static_cast<uint32_t>(offset) < session->acked)
+	{
+		// The client started over, e.g. after losing its partial file.
+		session->acked = session->next = offset;
+		session->lastprogress = now;
+	}
+
+	if (resend && now - session->lastresend >= RESEND_HOLDOFF)
+	{
+		session->next = session->acked;
+		session->lastresend = now;
+	}
+
+	if (session->acked == file->length)
+	{
+		// An empty chunk at the end tells a client that already had the
+		// whole file how long it is.
+		SZ_Clear(&dl_message);
+		MSG_WriteLong(&dl_message, DOWNLOAD_CHALLENGE);
+		MSG_WriteLong(&dl_message, file->length);
+		MSG_WriteLong(&dl_message, file->length);
+		MSG_WriteLong(&dl_message, 0); // CRC32 of nothing
+		MSG_WriteShort(&dl_message, 0);
+		NET_SendPacket(dl_message, net_from);
+
+		PrintFmt("{} finished downloading {}.\n", NET_AdrToString(net_from),
+		         file->basename);
+		sessions.erase(sessions.begin() + (session - &sessions[0]));
+		return;
+	}
+
+	// Answer right away rather than on the next tic, so the window keeps
+	// moving at the rate acknowledgements come in.
+	RefillBudgets(now);
+	if (!ServeSession(*session, now))
+		sessions.erase(sessions.begin() + (session - &sessions[0]));
+}
+
+/**
+ * @brief Keep downloads moving and expire idle ones.  Runs even while the
+ *        server is frozen, since a downloading client isn't a player yet.
+ */
+void SV_DownloadTick()
+{
+	if (sessions.empty())
+	{
+		if (!servedfiles.empty())
+			PurgeServedFiles();
+		return;
+	}
+
+	const dtime_t now = I_MSTime();
+
+	sessions.erase(std::remove_if(sessions.begin(), sessions.end(),
+	                              [now](const downloadSession_t& session) {
+		                              return now - session.lastrequest >=
+		                                     SESSION_TIMEOUT;
+	                              }),
+	               sessions.end());
+
+	PurgeServedFiles();
+
+	if (!sv_waddownload)
+	{
+		sessions.clear();
+		return;
+	}
+
+	RefillBudgets(now);
+
+	NET_BeginSendBatch();
+
+	// Take turns at being served first, so one client can't starve the
+	// others of the total budget.
+	if (sessions.size() > 1)
+		std::rotate(sessions.begin(), sessions.begin() + 1, sessions.end());
+
+	for (std::vector<downloadSession_t>::iterator it = sessions.begin();
+	     it != sessions.end();)
+	{
+		if (ServeSession(*it, now))
+			++it;
+		else
+			it = sessions.erase(it);
+	}
+
+	NET_EndSendBatch();
+}
+
+VERSION_CONTROL(sv_download_cpp, "$Id$")
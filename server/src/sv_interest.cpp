@@ -0,0 +1,280 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 1998-2006 by Randy Heit (ZDoom).
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+// Server-side interest management for actor updates.
+//
+// Instead of every visible monster and missile being sent on a fixed
+// modulo of the gametic, each client gets a per-tic byte budget which is
+// spent on the most relevant stale actors first.  Relevance is derived
+// from distance, the REJECT table and whether the actor is after the
+// client.
+//
+//-----------------------------------------------------------------------------
+
+
+
+#include "novadoom.h"
+
+#include "sv_interest.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "c_cvars.h"
+#include "d_player.h"
+#include "p_local.h"
+#include "p_tick.h"
+#include "sv_main.h"
+#include "svc_message.h"
+
+EXTERN_CVAR(sv_interestbudget)
+
+namespace
+{
+
+// Update intervals in tics for actors of ordinary relevance, matching the
+// fixed modulo used by SV_UpdateMonsters and SV_UpdateMissiles.
+const int MONSTER_INTERVAL = 7;
+const int MISSILE_INTERVAL = 30;
+const int SEEKER_INTERVAL = 5;
+
+// Distances, in map units, that change how often an actor is refreshed.
+const int NEAR_DISTANCE = 1024;
+const int FAR_DISTANCE = 4096;
+
+// Never shrink the budget below this, so a client at its rate limit still
+// receives the occasional correction.
+const size_t MIN_BUDGET = 256;
+
+// Forget about actors a client has not been sent in this many tics.
+const int FORGET_TICS = 10 * TICRATE;
+
+struct InterestCandidate
+{
+	AActor* mo;
+	int score;
+};
+
+// Gametic each actor, by netid, was last sent to each client.
+std::unordered_map<uint32_t, int> lastSent[MAXPLAYERS + 1];
+
+std::vector<InterestCandidate> candidates;
+
+/**
+ * @brief Return the base update interval for an actor, or 0 if the actor is
+ *        not something this pass keeps clients up to date on.
+ */
+int BaseInterval(const AActor* mo)
+{
+	if (mo->flags & MF_MISSILE)
+	{
+		if (mo->flags & MF_SKULLFLY || mo->type == MT_PLASMA)
+			return 0;
+
+		if (mo->type == MT_TRACER || mo->type == MT_FATSHOT ||
+		    mo->flags2 & MF2_SEEKERMISSILE)
+			return SEEKER_INTERVAL;
+
+		return MISSILE_INTERVAL;
+	}
+
+	if (mo->flags & MF_CORPSE)
+		return 0;
+
+	if (!(mo->flags & MF_COUNTKILL || mo->type == MT_SKULL) || !mo->target)
+		return 0;
+
+	return MONSTER_INTERVAL;
+}
+
+/**
+ * @brief Check the REJECT table to see if two sectors can possibly see each
+ *        other.  Works as a coarse PVS.
+ */
+bool SectorsMaySee(const sector_t* s1, const sector_t* s2)
+{
+	if (rejectempty || s1 == s2)
+		return true;
+
+	const int pnum = (s1 - sectors) * numsectors + (s2 - sectors);
+	return !(rejectmatrix[pnum >> 3] & (1 << (pnum & 7)));
+}
+
+/**
+ * @brief Work out how often an actor should reach a client and how much it
+ *        matters compared to the others.
+ *
+ * @param interval Base interval, adjusted in place.
+ * @return Relevance weight, higher is more relevant.
+ */
+int Relevance(const AActor* viewer, const AActor* mo, int& interval)
+{
+	int weight = 4;
+
+	const bool visible = viewer->subsector && mo->subsector &&
+	                     SectorsMaySee(viewer->subsector->sector, mo->subsector->sector);
+	const int dist = P_AproxDistance(mo->x - viewer->x, mo->y - viewer->y) >> FRACBITS;
+
+	if (!visible)
+	{
+		interval *= 4;
+		weight = 1;
+	}
+	else if (dist < NEAR_DISTANCE)
+	{
+		interval = std::max(1, interval / 2);
+		weight = 8;
+	}
+	else if (dist > FAR_DISTANCE)
+	{
+		interval *= 2;
+		weight = 2;
+	}
+
+	// Anything chasing or homing in on this client is what they care about most.
+	if (mo->target == viewer || mo->tracer == viewer)
+	{
+		interval = std::min(interval, MONSTER_INTERVAL);
+		weight *= 2;
+	}
+
+	return weight;
+}
+
+/**
+ * @brief Bytes this client may spend on actor updates this tic.
+ */
+size_t UpdateBudget(const client_t* cl)
+{
+	size_t budget;
+	if (sv_interestbudget.asInt() > 0)
+		budget = sv_interestbudget.asInt();
+	else
+		budget = static_cast<size_t>(cl->rate) * 1000 / TICRATE;
+
+	if (cl->netbuf.cursize >= budget)
+		return MIN_BUDGET;
+
+	return std::max(MIN_BUDGET, budget - cl->netbuf.cursize);
+}
+
+} // namespace
+
+//
+// SV_InterestUpdateActors
+//
+// Replacement for SV_UpdateMissiles and SV_UpdateMonsters that ranks every
+// due actor and sends the most relevant ones until the client's budget for
+// this tic runs out.  Actors that miss out become more stale and so rank
+// higher the next tic.
+//
+void SV_InterestUpdateActors(player_t& pl)
+{
+	const AActor* viewer = pl.mo;
+	player_t& target = idplayer(pl.spying);
+	if (validplayer(target) && &target != &pl && target.mo)
+		viewer = target.mo;
+
+	if (!viewer)
+		return;
+
+	std::unordered_map<uint32_t, int>& sent = lastSent[pl.id];
+	client_t* cl = &pl.client;
+
+	if (P_AtInterval(TICRATE))
+	{
+		for (auto it = sent.begin(); it != sent.end();)
+		{
+			if (::gametic - it->second > FORGET_TICS)
+				it = sent.erase(it);
+			else
+				++it;
+		}
+	}
+
+	candidates.clear();
+
+	AActor* mo;
+	TThinkerIterator<AActor> iterator;
+	while ((mo = iterator.Next()))
+	{
+		int interval = BaseInterval(mo);
+		if (!interval || !SV_IsPlayerAllowedToSee(pl, mo))
+			continue;
+
+		const int weight = Relevance(viewer, mo, interval);
+
+		// Actors the client has never been sent are considered due on the
+		// same staggered tic the fixed modulo would have picked.
+		int age;
+		auto it = sent.find(mo->netid);
+		if (it != sent.end())
+			age = ::gametic - it->second;
+		else
+			age = ((::gametic + mo->netid) % interval) ? 0 : interval;
+
+		if (age < interval)
+			continue;
+
+		InterestCandidate candidate = {mo, weight * age / interval};
+		candidates.push_back(candidate);
+	}
+
+	if (candidates.empty())
+		return;
+
+	std::stable_sort(candidates.begin(), candidates.end(),
+	                 [](const InterestCandidate& a, const InterestCandidate& b) {
+		                 return a.score > b.score;
+	                 });
+
+	size_t budget = UpdateBudget(cl);
+	for (const InterestCandidate& candidate : candidates)
+	{
+		const size_t before = cl->netbuf.cursize;
+		MSG_WriteSVC(&cl->netbuf, SVC_UpdateMobj(*candidate.mo));
+		sent[candidate.mo->netid] = ::gametic;
+
+		const size_t written = cl->netbuf.cursize - before;
+		budget = written < budget ? budget - written : 0;
+
+		if (cl->netbuf.cursize >= 1024)
+		{
+			if (!SV_SendPacket(pl))
+				return;
+		}
+
+		if (budget == 0)
+			break;
+	}
+}
+
+//
+// SV_InterestClearPlayer
+//
+// Forget everything that has been sent to a client, so the next pass treats
+// every actor as new.  Called when a client is given a full update.
+//
+void SV_InterestClearPlayer(player_t& pl)
+{
+	lastSent[pl.id].clear();
+}
+
+VERSION_CONTROL (sv_interest_cpp, "$Id$")
@@ -49,6 +49,7 @@
 #include "s_sound.h"
 #include "sv_main.h"
 #include "sv_maplist.h"
+#include "sv_sqp.h"
 #include "w_wad.h"
 #include "z_zone.h"
 #include "g_levelstate.h"
@@ -832,6 +833,7 @@ void G_DoLoadLevel (int position)
 		lastposition = position;
 
 	G_InitLevelLocals ();
+	SV_QryInvalidate();
 
 	if (firstmapinit) {
 		PrintFmt_Bold ("--- {}: \"{}\" ---\n", level.mapname, level.level_name);
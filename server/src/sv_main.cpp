@@ -63,6 +63,9 @@
 #include "g_levelstate.h"
 #include "g_gametype.h"
 #include "sv_banlist.h"
+#include "sv_interest.h"
+#include "sv_snapshot.h"
+#include "sv_download.h"
 #include "d_main.h"
 #include "m_fileio.h"
 #include "v_textcolors.h"
@@ -96,6 +99,9 @@ extern int mapchange;
 
 bool step_mode = false;
 
+// Index of this game instance when started with -instances, 0 otherwise.
+int server_instance = 0;
+
 std::set<byte> free_player_ids;
 
 // RCON-only sessions (no player slot consumed)
@@ -110,6 +116,7 @@ EXTERN_CVAR(sv_motd)
 EXTERN_CVAR(sv_hostname)
 EXTERN_CVAR(sv_email)
 EXTERN_CVAR(sv_maxrate)
+EXTERN_CVAR(sv_interest)
 EXTERN_CVAR(sv_emptyreset)
 EXTERN_CVAR(sv_emptyfreeze)
 EXTERN_CVAR(sv_clientcount)
@@ -502,6 +509,13 @@ void SV_InitNetwork (void)
 	else
 	   localport = SERVERPORT;
 
+	// Instances started with -instances take consecutive ports.
+	if (::server_instance > 0)
+	{
+		localport += ::server_instance;
+		PrintFmt(PRINT_HIGH, "instance {} using port {}\n", ::server_instance, localport);
+	}
+
 	// set up a socket and net_message buffer
 	InitNetCommon();
 
@@ -540,6 +554,7 @@ Players::iterator SV_GetFreeClient(void)
 
 	players.emplace_back();
 	players.back().playerstate = PST_CONTACT;
+	SV_QryInvalidate();
 
 	// generate player id
 	std::set<byte>::iterator id = free_player_ids.begin();
@@ -757,6 +772,7 @@ Players::iterator SV_RemoveDisconnectedPlayer(Players::iterator it)
 	Players::iterator next;
 	next = players.erase(it);
 	free_player_ids.insert(player_id);
+	SV_QryInvalidate();
 
 	Unlag::getInstance().unregisterPlayer(player_id);
 
@@ -874,12 +890,14 @@ void SV_Sound (AActor *mo, byte channel, const char *name, byte attenuation)
 		return;
 	}
 
+	const EncodedSVC sound(
+	    SVC_PlaySound(PlaySoundType(mo), channel, sfx_id, 1.0f, attenuation));
+
 	for (auto& player : players)
 	{
 		client_t* cl = &(player.client);
 
-		MSG_WriteSVC(&cl->reliablebuf, SVC_PlaySound(PlaySoundType(mo), channel, sfx_id,
-		                                             1.0f, attenuation));
+		MSG_WriteSVC(&cl->reliablebuf, sound);
 	}
 }
 
@@ -919,6 +937,9 @@ void UV_SoundAvoidPlayer (AActor *mo, byte channel, const char *name, byte atten
 		return;
 	}
 
+	const EncodedSVC sound(
+	    SVC_PlaySound(PlaySoundType(mo), channel, sfx_id, 1.0f, attenuation));
+
 	for (auto& player : players)
 	{
 		if(&pl == &player)
@@ -926,8 +947,7 @@ void UV_SoundAvoidPlayer (AActor *mo, byte channel, const char *name, byte atten
 
 		client_t* cl = &(player.client);
 
-		MSG_WriteSVC(&cl->reliablebuf, SVC_PlaySound(PlaySoundType(mo), channel, sfx_id,
-		                                             1.0f, attenuation));
+		MSG_WriteSVC(&cl->reliablebuf, sound);
 	}
 }
 
@@ -945,14 +965,16 @@ void SV_SoundTeam (byte channel, const char* name, byte attenuation, int team)
 		return;
 	}
 
+	const EncodedSVC sound(
+	    SVC_PlaySound(PlaySoundType(), channel, sfx_id, 1.0f, attenuation));
+
 	for (auto& player : players)
 	{
 		if (player.ingame() && player.userinfo.team == team)
 		{
 			client_t* cl = &(player.client);
 
-			MSG_WriteSVC(&cl->reliablebuf, SVC_PlaySound(PlaySoundType(), channel, sfx_id,
-			                                             1.0f, attenuation));
+			MSG_WriteSVC(&cl->reliablebuf, sound);
 		}
 	}
 }
@@ -967,6 +989,9 @@ void SV_Sound (fixed_t x, fixed_t y, byte channel, const char *name, byte attenu
 		return;
 	}
 
+	const EncodedSVC sound(
+	    SVC_PlaySound(PlaySoundType(x, y), channel, sfx_id, 1.0f, attenuation));
+
 	for (auto& player : players)
 	{
 		if (!(player.ingame()))
@@ -974,8 +999,7 @@ void SV_Sound (fixed_t x, fixed_t y, byte channel, const char *name, byte attenu
 
 		client_t* cl = &(player.client);
 
-		MSG_WriteSVC(&cl->reliablebuf, SVC_PlaySound(PlaySoundType(x, y), channel, sfx_id,
-		                                             1.0f, attenuation));
+		MSG_WriteSVC(&cl->reliablebuf, sound);
 	}
 }
 
@@ -984,6 +1008,8 @@ void SV_Sound (fixed_t x, fixed_t y, byte channel, const char *name, byte attenu
 //
 void SV_UpdateFrags(player_t &player)
 {
+	SV_QryInvalidate();
+
 	for (Players::iterator it = players.begin();it != players.end();++it)
 	{
 		client_t *cl = &(it->client);
@@ -1019,6 +1045,8 @@ void SV_BroadcastUserInfo(player_t &player)
  */
 bool SV_SetupUserInfo(player_t &player)
 {
+	SV_QryInvalidate();
+
 	// read in userinfo from packet
 	std::string old_netname(player.userinfo.netname);
 	std::string new_netname(MSG_ReadString());
@@ -1659,6 +1687,9 @@ void SV_ClientFullUpdate(player_t &pl)
 {
 	client_t *cl = &pl.client;
 
+	SV_InterestClearPlayer(pl);
+	SV_SnapshotReset(pl);
+
 	MSG_WriteSVC(&cl->reliablebuf, odaproto::svc::FullUpdateStart());
 
 	// Send the player all level locals.
@@ -1932,7 +1963,8 @@ void SV_ConnectClient()
 
 	if (challenge == LAUNCHER_CHALLENGE)  // for Launcher
 	{
-		SV_SendServerInfo();
+		if (!SV_QryRateLimited())
+			SV_SendServerInfo();
 		return;
 	}
 
@@ -1943,6 +1975,13 @@ void SV_ConnectClient()
 		return;
 	}
 
+	// WAD download (no player slot consumed)
+	if (challenge == DOWNLOAD_CHALLENGE)
+	{
+		SV_DownloadRequest();
+		return;
+	}
+
 	if (challenge != PROTO_CHALLENGE && challenge != MSG_CHALLENGE)
 		return;
 
@@ -2012,7 +2051,11 @@ void SV_ConnectClient()
 	player->JoinTime = time(NULL);
 
 	cl->version = MSG_ReadShort();
-	MSG_ReadByte(); //connection_type (unused)
+
+	// Connection type used to be unused and is always 0 from older clients.
+	// Newer clients use it to advertise optional protocol features.
+	const byte capabilities = MSG_ReadByte();
+	SV_SnapshotConnect(*player, capabilities & CONNECT_SNAPSHOTS);
 
 	// [SL] 2011-05-11 - Register the player with the reconciliation system
 	// for unlagging
@@ -2824,6 +2867,8 @@ void SV_UpdateMobj(AActor* mo)
 	if (mo->player)
 		return;
 
+	const EncodedSVC update(SVC_UpdateMobj(*mo));
+
 	for (auto& player : players)
 	{
 		if (!(player.ingame()))
@@ -2832,7 +2877,7 @@ void SV_UpdateMobj(AActor* mo)
 		if (SV_IsPlayerAllowedToSee(player, mo))
 		{
 			client_t* cl = &(player.client);
-			MSG_WriteSVC(&cl->reliablebuf, SVC_UpdateMobj(*mo));
+			MSG_WriteSVC(&cl->reliablebuf, update);
 		}
 	}
 }
@@ -2840,6 +2885,8 @@ void SV_UpdateMobj(AActor* mo)
 // Update the given actors state immediately.
 void SV_UpdateMobjState(AActor* mo)
 {
+	const EncodedSVC state(SVC_MobjState(mo));
+
 	for (auto& player : players)
 	{
 		if (!(player.ingame()))
@@ -2848,7 +2895,7 @@ void SV_UpdateMobjState(AActor* mo)
 		if (SV_IsPlayerAllowedToSee(player, mo))
 		{
 			client_t* cl = &(player.client);
-			MSG_WriteSVC(&cl->reliablebuf, SVC_MobjState(mo));
+			MSG_WriteSVC(&cl->reliablebuf, state);
 		}
 	}
 }
@@ -2922,6 +2969,8 @@ void SV_ActorTarget(AActor *actor)
 	if (actor->player)
 		return;
 
+	const EncodedSVC update(SVC_UpdateMobj(*actor));
+
 	for (auto& player : players)
 	{
 		if (!(player.ingame()))
@@ -2932,7 +2981,7 @@ void SV_ActorTarget(AActor *actor)
 		if(!SV_IsPlayerAllowedToSee(player, actor))
 			continue;
 
-		MSG_WriteSVC(&cl->reliablebuf, SVC_UpdateMobj(*actor));
+		MSG_WriteSVC(&cl->reliablebuf, update);
 	}
 }
 
@@ -2941,6 +2990,8 @@ void SV_ActorTarget(AActor *actor)
 //
 void SV_ActorTracer(AActor *actor)
 {
+	const EncodedSVC update(SVC_UpdateMobj(*actor));
+
 	for (auto& player : players)
 	{
 		if (!(player.ingame()))
@@ -2948,7 +2999,7 @@ void SV_ActorTracer(AActor *actor)
 
 		client_t *cl = &(player.client);
 
-		MSG_WriteSVC(&cl->reliablebuf, SVC_UpdateMobj(*actor));
+		MSG_WriteSVC(&cl->reliablebuf, update);
 	}
 }
 
@@ -3112,7 +3163,10 @@ void SV_SendPackets()
 	for (size_t i = 0;i < fair_send;i++)
 		++begin;
 
-	// Loop through all players in a staggered fashion.
+	// Loop through all players in a staggered fashion, handing every
+	// packet to the network layer in one batch.
+	NET_BeginSendBatch();
+
 	Players::iterator it = begin;
 	do
 	{
@@ -3126,6 +3180,8 @@ void SV_SendPackets()
 	}
 	while (it != begin);
 
+	NET_EndSendBatch();
+
 	// Advance the send index.
 	fair_send++;
 }
@@ -3196,9 +3252,19 @@ void SV_WriteCommands(void)
 
 		SV_UpdateConsolePlayer(*it);
 
-		SV_UpdateMissiles(*it);
-
-		SV_UpdateMonsters(*it);
+		if (SV_SnapshotEnabled(*it))
+		{
+			SV_WriteSnapshot(*it);
+		}
+		else if (sv_interest)
+		{
+			SV_InterestUpdateActors(*it);
+		}
+		else
+		{
+			SV_UpdateMissiles(*it);
+			SV_UpdateMonsters(*it);
+		}
 
 		SV_UpdateGametype(*it);     // update gametype stuff
 
@@ -3477,6 +3543,8 @@ void SV_SetPlayerSpec(player_t &player, bool setting, bool silent)
 	if (player.ingame() == false)
 		return;
 
+	SV_QryInvalidate();
+
 	if (!setting && player.spectator)
 	{
 		// Join delay means they're mashing buttons too fast.
@@ -4300,6 +4368,7 @@ void SV_RunTics()
 
 	SV_BanlistTics();
 	SV_UpdateMaster();
+	SV_DownloadTick();
 
 	// only run game-related tickers if the server isn't frozen
 	// (sv_emptyfreeze enabled and no clients)
@@ -4712,11 +4781,13 @@ void OnChangedSwitchTexture (line_t *line, int useAgain)
 	unsigned state = 0, time = 0;
 	P_GetButtonInfo(line, state, time);
 
+	const EncodedSVC change(SVC_Switch(*line, state, time));
+
 	for (auto& player : players)
 	{
 		client_t *cl = &(player.client);
 
-		MSG_WriteSVC(&cl->reliablebuf, SVC_Switch(*line, state, time));
+		MSG_WriteSVC(&cl->reliablebuf, change);
 	}
 }
 
@@ -4726,6 +4797,8 @@ void SV_OnActivatedLine(line_t* line, AActor* mo, const int side,
 	if (P_LineSpecialMovesSector(line->special))
 		return;
 
+	const EncodedSVC activate(SVC_ActivateLine(line, mo, side, activationType));
+
 	for (auto& player : players)
 	{
 		if (!(player.ingame()))
@@ -4733,18 +4806,20 @@ void SV_OnActivatedLine(line_t* line, AActor* mo, const int side,
 
 		client_t *cl = &(player.client);
 
-		MSG_WriteSVC(&cl->reliablebuf, SVC_ActivateLine(line, mo, side, activationType));
+		MSG_WriteSVC(&cl->reliablebuf, activate);
 	}
 }
 
 void SV_SendDamagePlayer(player_t *player, AActor* inflictor, int healthDamage, int armorDamage)
 {
+	const EncodedSVC damage(
+	    SVC_DamagePlayer(*player, inflictor, healthDamage, armorDamage));
+
 	for (Players::iterator it = players.begin();it != players.end();++it)
 	{
 		client_t *cl = &(it->client);
 
-		MSG_WriteSVC(&cl->reliablebuf,
-		             SVC_DamagePlayer(*player, inflictor, healthDamage, armorDamage));
+		MSG_WriteSVC(&cl->reliablebuf, damage);
 	}
 }
 
@@ -4753,13 +4828,17 @@ void SV_SendDamageMobj(AActor *target, int pain)
 	if (!target)
 		return;
 
+	const EncodedSVC damage(SVC_DamageMobj(target, pain));
+	const EncodedSVC update =
+	    target->player ? EncodedSVC() : EncodedSVC(SVC_UpdateMobj(*target));
+
 	for (auto& player : players)
 	{
 		client_t *cl = &(player.client);
 
-		MSG_WriteSVC(&cl->reliablebuf, SVC_DamageMobj(target, pain));
+		MSG_WriteSVC(&cl->reliablebuf, damage);
 		if (!target->player)
-			MSG_WriteSVC(&cl->netbuf, SVC_UpdateMobj(*target));
+			MSG_WriteSVC(&cl->netbuf, update);
 	}
 }
 
@@ -4769,6 +4848,9 @@ void SV_SendKillMobj(AActor *source, AActor *target, AActor *inflictor,
 	if (!target)
 		return;
 
+	const EncodedSVC kill(
+	    SVC_KillMobj(source, target, inflictor, ::MeansOfDeath, joinkill));
+
 	for (auto& player : players)
 	{
 		client_t *cl = &(player.client);
@@ -4776,8 +4858,7 @@ void SV_SendKillMobj(AActor *source, AActor *target, AActor *inflictor,
 		if (!SV_IsPlayerAllowedToSee(player, target))
 			continue;
 
-		MSG_WriteSVC(&cl->reliablebuf,
-		             SVC_KillMobj(source, target, inflictor, ::MeansOfDeath, joinkill));
+		MSG_WriteSVC(&cl->reliablebuf, kill);
 	}
 }
 
@@ -4786,6 +4867,8 @@ void SV_SendRaiseMobj(AActor* source, AActor* corpse)
 	if (!corpse)
 		return;
 
+	const EncodedSVC raise(SVC_RaiseMobj(source, corpse));
+
 	for (auto& player : players)
 	{
 		client_t* cl = &(player.client);
@@ -4793,7 +4876,7 @@ void SV_SendRaiseMobj(AActor* source, AActor* corpse)
 		if (!SV_IsPlayerAllowedToSee(player, corpse))
 			continue;
 
-		MSG_WriteSVC(&cl->reliablebuf, SVC_RaiseMobj(source, corpse));
+		MSG_WriteSVC(&cl->reliablebuf, raise);
 	}
 }
 
@@ -4802,6 +4885,8 @@ void SV_SendDestroyActor(AActor *mo)
 {
 	if (mo->netid && mo->type != MT_PUFF)
 	{
+		const EncodedSVC remove(SVC_RemoveMobj(*mo));
+
 		for (auto& player : players)
 		{
 			if (mo->players_aware.get(player.id))
@@ -4811,7 +4896,7 @@ void SV_SendDestroyActor(AActor *mo)
 				// denis - todo - need a queue for destroyed (lost awareness)
 				// objects, as a flood of destroyed things could easily overflow a
 				// buffer
-				MSG_WriteSVC(&cl->reliablebuf, SVC_RemoveMobj(*mo));
+				MSG_WriteSVC(&cl->reliablebuf, remove);
 			}
 		}
 	}
@@ -4820,6 +4905,9 @@ void SV_SendDestroyActor(AActor *mo)
 // Missile exploded so tell clients about it
 void SV_ExplodeMissile(AActor *mo)
 {
+	const EncodedSVC update(SVC_UpdateMobj(*mo));
+	const EncodedSVC explode(SVC_ExplodeMissile(*mo));
+
 	for (auto& player : players)
 	{
 		client_t *cl = &(player.client);
@@ -4827,8 +4915,8 @@ void SV_ExplodeMissile(AActor *mo)
 		if (!SV_IsPlayerAllowedToSee(player, mo))
 			continue;
 
-		MSG_WriteSVC(&cl->reliablebuf, SVC_UpdateMobj(*mo));
-		MSG_WriteSVC(&cl->reliablebuf, SVC_ExplodeMissile(*mo));
+		MSG_WriteSVC(&cl->reliablebuf, update);
+		MSG_WriteSVC(&cl->reliablebuf, explode);
 	}
 }
 
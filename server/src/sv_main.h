@@ -131,6 +131,7 @@ bool SV_SendPacket(player_t &pl);
 void SV_AcknowledgePacket(player_t &player);
 void SV_DisplayTics();
 void SV_RunTics();
+void SV_GetPackets();
 void SV_ParseCommands(player_t &player);
 void SV_UpdateFrags (player_t &player);
 void SV_RemoveCorpses (void);
@@ -154,6 +155,7 @@ void SV_SoundTeam (byte channel, const char* name, byte attenuation, int t);
 void SV_MidPrint (const char *msg, player_t *p, int msgtime=0);
 
 extern std::vector<std::string> wadnames;
+extern int server_instance;
 
 void SV_SendPlayerInfo(player_t& player);
 void SV_SendKillMobj(AActor *source, AActor *target, AActor *inflictor, bool joinkill);
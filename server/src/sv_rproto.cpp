@@ -27,6 +27,7 @@
 
 #include "p_local.h"
 #include "sv_main.h"
+#include "sv_snapshot.h"
 #include "i_net.h"
 
 #ifdef SIMULATE_LATENCY
@@ -175,6 +176,7 @@ bool SV_SendPacket(player_t &pl)
 	                 // to use &0xff. Cool, eh? ;-)
 
 	// copy sequence
+	const int sequence = cl->sequence;
 	MSG_WriteLong(&sendd, cl->sequence++);
 	MSG_WriteByte(&sendd, 0); // Flags, filled out later.
 
@@ -190,14 +192,18 @@ bool SV_SendPacket(player_t &pl)
 	if (gametic % 35)
 	    bps = (int)((double)( (cl->unreliable_bps + cl->reliable_bps) * TICRATE)/(double)(gametic%35));
 
+	bool unreliable = false;
     if (bps < cl->rate*1000)
 
 	  if (cl->netbuf.cursize && (sendd.maxsize() - sendd.cursize > cl->netbuf.cursize) )
 	  {
          SZ_Write (&sendd, cl->netbuf.data, cl->netbuf.cursize);
 	     cl->unreliable_bps += cl->netbuf.cursize;
+	     unreliable = true;
 	  }
 
+	SV_SnapshotPacketSent(pl, sequence, unreliable);
+
 	SZ_Clear(&cl->netbuf);
 	SZ_Clear(&cl->reliablebuf);
 
@@ -288,6 +294,8 @@ void SV_AcknowledgePacket(player_t &player)
 
 	cl->last_sequence = sequence;
 
+	SV_SnapshotAcknowledge(player, sequence);
+
 	if (cl->last_sequence == 0)
 	{
 		// [AM] Finish our connection sequence.
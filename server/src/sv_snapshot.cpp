@@ -0,0 +1,376 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 1998-2006 by Randy Heit (ZDoom).
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+// Per-client world snapshots.
+//
+// Clients that advertise CONNECT_SNAPSHOTS in the connect challenge get the
+// position and momentum of nearby monsters and missiles as one
+// svc_worldsnapshot every few tics instead of a stream of svc_updatemobj.
+// Each snapshot is encoded against the newest snapshot the client has
+// acknowledged, so anything that has not changed since costs nothing.
+//
+//-----------------------------------------------------------------------------
+
+
+
+#include "novadoom.h"
+
+#include "sv_snapshot.h"
+
+#include <algorithm>
+
+#include "c_cvars.h"
+#include "i_net.h"
+#include "p_local.h"
+#include "sv_main.h"
+#include "svc_snapshot.h"
+
+#include "server.pb.h"
+
+EXTERN_CVAR(sv_snapshots)
+EXTERN_CVAR(sv_snapshotrate)
+
+namespace
+{
+
+// Number of sent snapshots kept around to be used as a delta base.
+const size_t SNAPSHOT_HISTORY = 16;
+
+// Send a snapshot against an empty base at least this often, so netdemos
+// and clients that lose track can recover.
+const int KEYFRAME_TICS = 10 * TICRATE;
+
+// Rough upper bound on the encoded size of a snapshot, which keeps one
+// snapshot inside a single packet.
+const size_t SNAPSHOT_BYTES = MAX_UDP_SIZE - 200;
+
+const size_t PACKET_MASK = 0xFF;
+
+struct ClientSnapshots
+{
+	bool capable;
+	WorldSnapshot history[SNAPSHOT_HISTORY];
+	size_t next;
+	int acked_tic;
+	int pending_tic;
+	int keyframe_tic;
+	int packet_seq[PACKET_MASK + 1];
+	int packet_tic[PACKET_MASK + 1];
+
+	void reset()
+	{
+		for (WorldSnapshot& snap : history)
+			snap.clear();
+		next = 0;
+		acked_tic = 0;
+		pending_tic = 0;
+		keyframe_tic = 0;
+		std::fill(packet_seq, packet_seq + PACKET_MASK + 1, -1);
+		std::fill(packet_tic, packet_tic + PACKET_MASK + 1, 0);
+	}
+};
+
+ClientSnapshots clientSnapshots[MAXPLAYERS + 1];
+
+struct SnapshotCandidate
+{
+	AActor* mo;
+	fixed_t dist;
+};
+
+std::vector<SnapshotCandidate> candidates;
+
+/**
+ * @brief Actors carried in snapshots - the ones SV_UpdateMonsters and
+ *        SV_UpdateMissiles would otherwise send.
+ */
+bool IsSnapshotActor(const AActor* mo)
+{
+	if (mo->player)
+		return false;
+
+	if (mo->flags & MF_MISSILE)
+		return mo->type != MT_PLASMA;
+
+	if (mo->flags & MF_CORPSE)
+		return false;
+
+	return mo->flags & MF_COUNTKILL || mo->type == MT_SKULL;
+}
+
+baseline_t ActorState(const AActor* mo)
+{
+	baseline_t state;
+	state.pos.x = mo->x;
+	state.pos.y = mo->y;
+	state.pos.z = mo->z;
+	state.mom.x = mo->momx;
+	state.mom.y = mo->momy;
+	state.mom.z = mo->momz;
+	state.angle = mo->angle;
+	state.targetid = mo->target ? mo->target->netid : 0;
+	state.tracerid = mo->tracer ? mo->tracer->netid : 0;
+	state.movecount = mo->movecount;
+	state.movedir = mo->movedir;
+	state.rndindex = mo->rndindex;
+	return state;
+}
+
+/**
+ * @brief Find an actor among the first count entries of a snapshot, which
+ *        must be sorted by netid.
+ */
+const WorldSnapshot::Entry* FindEntry(const WorldSnapshot& snap, const uint32_t netid,
+                                      size_t count)
+{
+	auto end = snap.actors.begin() + std::min(count, snap.actors.size());
+	auto it = std::lower_bound(snap.actors.begin(), end, netid,
+	                           [](const WorldSnapshot::Entry& entry, uint32_t id) {
+		                           return entry.netid < id;
+	                           });
+	if (it == end || it->netid != netid)
+		return NULL;
+	return &*it;
+}
+
+const WorldSnapshot::Entry* FindEntry(const WorldSnapshot& snap, const uint32_t netid)
+{
+	return FindEntry(snap, netid, snap.actors.size());
+}
+
+/**
+ * @brief Guess how many bytes an actor's record will take, without
+ *        encoding it.
+ */
+size_t RecordCost(const baseline_t* from, const baseline_t& to)
+{
+	if (from == NULL)
+		return 2 + 12 * 3;
+
+	size_t cost = 2;
+	if (from->pos.x != to.pos.x)
+		cost += 3;
+	if (from->pos.y != to.pos.y)
+		cost += 3;
+	if (from->pos.z != to.pos.z)
+		cost += 3;
+	if (from->mom.x != to.mom.x)
+		cost += 3;
+	if (from->mom.y != to.mom.y)
+		cost += 3;
+	if (from->mom.z != to.mom.z)
+		cost += 3;
+	if (from->angle != to.angle)
+		cost += 5;
+	if (from->targetid != to.targetid || from->tracerid != to.tracerid)
+		cost += 4;
+	if (from->movecount != to.movecount || from->movedir != to.movedir ||
+	    from->rndindex != to.rndindex)
+		cost += 3;
+	return cost == 2 ? 0 : cost;
+}
+
+} // namespace
+
+/**
+ * @brief Record whether a connecting client can read world snapshots.
+ */
+void SV_SnapshotConnect(player_t& pl, bool capable)
+{
+	ClientSnapshots& cs = clientSnapshots[pl.id];
+	cs.reset();
+	cs.capable = capable;
+}
+
+bool SV_SnapshotEnabled(const player_t& pl)
+{
+	return sv_snapshots && clientSnapshots[pl.id].capable;
+}
+
+/**
+ * @brief Forget every snapshot sent to a client, so the next one is
+ *        encoded against nothing.  Called on a full update.
+ */
+void SV_SnapshotReset(player_t& pl)
+{
+	ClientSnapshots& cs = clientSnapshots[pl.id];
+	const bool capable = cs.capable;
+	cs.reset();
+	cs.capable = capable;
+}
+
+//
+// SV_WriteSnapshot
+//
+// Build this tic's snapshot for a client and write it into their unreliable
+// buffer.  Closer actors are considered first.  Once the size budget is used
+// up, actors that the base snapshot already has keep their old state in the
+// new snapshot, and actors it lacks are left out, so whatever the snapshot
+// claims is always exactly what the client will reconstruct.
+//
+void SV_WriteSnapshot(player_t& pl)
+{
+	if ((::gametic + pl.id) % sv_snapshotrate.asInt())
+		return;
+
+	const AActor* viewer = pl.mo;
+	player_t& target = idplayer(pl.spying);
+	if (validplayer(target) && &target != &pl && target.mo)
+		viewer = target.mo;
+
+	if (!viewer)
+		return;
+
+	ClientSnapshots& cs = clientSnapshots[pl.id];
+
+	static const WorldSnapshot empty;
+	const WorldSnapshot* base = &empty;
+	if (cs.acked_tic && ::gametic - cs.keyframe_tic < KEYFRAME_TICS)
+	{
+		for (const WorldSnapshot& snap : cs.history)
+		{
+			if (snap.tic == cs.acked_tic)
+			{
+				base = &snap;
+				break;
+			}
+		}
+	}
+
+	if (base == &empty)
+		cs.keyframe_tic = ::gametic;
+
+	candidates.clear();
+
+	AActor* mo;
+	TThinkerIterator<AActor> iterator;
+	while ((mo = iterator.Next()))
+	{
+		if (!IsSnapshotActor(mo) || !SV_IsPlayerAllowedToSee(pl, mo))
+			continue;
+
+		SnapshotCandidate candidate = {
+		    mo, P_AproxDistance(mo->x - viewer->x, mo->y - viewer->y)};
+		candidates.push_back(candidate);
+	}
+
+	std::sort(candidates.begin(), candidates.end(),
+	          [](const SnapshotCandidate& a, const SnapshotCandidate& b) {
+		          return a.dist < b.dist;
+	          });
+
+	WorldSnapshot& snap = cs.history[cs.next];
+	cs.next = (cs.next + 1) % SNAPSHOT_HISTORY;
+
+	// The base may be the slot being reused, so build the new snapshot
+	// on the side.
+	static WorldSnapshot building;
+	building.tic = ::gametic;
+	building.actors.clear();
+
+	size_t budget = SNAPSHOT_BYTES;
+	for (const SnapshotCandidate& candidate : candidates)
+	{
+		WorldSnapshot::Entry entry;
+		entry.netid = candidate.mo->netid;
+		entry.state = ActorState(candidate.mo);
+
+		const WorldSnapshot::Entry* old = FindEntry(*base, entry.netid);
+		const size_t cost = RecordCost(old ? &old->state : NULL, entry.state);
+		if (cost > budget)
+		{
+			if (old)
+				building.actors.push_back(*old);
+			continue;
+		}
+
+		budget -= cost;
+		building.actors.push_back(entry);
+	}
+
+	std::sort(building.actors.begin(), building.actors.end(),
+	          [](const WorldSnapshot::Entry& a, const WorldSnapshot::Entry& b) {
+		          return a.netid < b.netid;
+	          });
+
+	// Actors that dropped out cost a couple of bytes to remove.  Without
+	// the budget for that they stay in the snapshot unchanged.
+	const size_t count = building.actors.size();
+	for (const WorldSnapshot::Entry& old : base->actors)
+	{
+		if (FindEntry(building, old.netid, count) != NULL)
+			continue;
+
+		if (budget >= 2)
+			budget -= 2;
+		else
+			building.actors.push_back(old);
+	}
+
+	if (building.actors.size() != count)
+	{
+		std::inplace_merge(building.actors.begin(), building.actors.begin() + count,
+		                   building.actors.end(),
+		                   [](const WorldSnapshot::Entry& a, const WorldSnapshot::Entry& b) {
+			                   return a.netid < b.netid;
+		                   });
+	}
+
+	odaproto::svc::WorldSnapshot msg;
+	SVC_EncodeWorldSnapshot(msg, *base, building);
+
+	snap = building;
+	cs.pending_tic = snap.tic;
+
+	MSG_WriteSVC(&pl.client.netbuf, msg);
+}
+
+/**
+ * @brief Note which snapshot, if any, went out in a packet.
+ *
+ * @param sequence Sequence number of the packet.
+ * @param unreliable True if the unreliable buffer made it into the packet.
+ */
+void SV_SnapshotPacketSent(player_t& pl, int sequence, bool unreliable)
+{
+	ClientSnapshots& cs = clientSnapshots[pl.id];
+
+	cs.packet_seq[sequence & PACKET_MASK] = sequence;
+	cs.packet_tic[sequence & PACKET_MASK] = unreliable ? cs.pending_tic : 0;
+	cs.pending_tic = 0;
+}
+
+/**
+ * @brief A client acknowledged a packet.  If it carried a snapshot newer
+ *        than their current base, that snapshot becomes the new base.
+ */
+void SV_SnapshotAcknowledge(player_t& pl, int sequence)
+{
+	ClientSnapshots& cs = clientSnapshots[pl.id];
+
+	if (cs.packet_seq[sequence & PACKET_MASK] != sequence)
+		return;
+
+	const int tic = cs.packet_tic[sequence & PACKET_MASK];
+	if (tic > cs.acked_tic)
+		cs.acked_tic = tic;
+}
+
+VERSION_CONTROL (sv_snapshot_cpp, "$Id$")
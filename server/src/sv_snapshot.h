@@ -0,0 +1,37 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// $Id$
+//
+// Copyright (C) 1998-2006 by Randy Heit (ZDoom).
+// Copyright (C) 2006-2025 by The Odamex Team
+// Portions Copyright (C) 2025 by The NovaDoom Team.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+// Per-client world snapshots, delta-encoded against the last snapshot
+// each client acknowledged.
+//
+//-----------------------------------------------------------------------------
+
+
+
+#pragma once
+
+#include "d_player.h"
+
+void SV_SnapshotConnect(player_t& pl, bool capable);
+bool SV_SnapshotEnabled(const player_t& pl);
+void SV_SnapshotReset(player_t& pl);
+void SV_WriteSnapshot(player_t& pl);
+void SV_SnapshotPacketSent(player_t& pl, int sequence, bool unreliable);
+void SV_SnapshotAcknowledge(player_t& pl, int sequence);
@@ -24,11 +24,13 @@
 
 #include "novadoom.h"
 
+#include <unordered_map>
 
 #include "sv_sqp.h"
 
 #include "d_main.h"
 #include "d_player.h"
+#include "i_system.h"
 #include "md5.h"
 #include "p_ctf.h"
 #include "g_gametype.h"
@@ -38,6 +40,8 @@ static buf_t ml_message(MAX_UDP_PACKET);
 EXTERN_CVAR(join_password)
 EXTERN_CVAR(sv_timelimit)
 EXTERN_CVAR(sv_teamsinplay)
+EXTERN_CVAR(sv_qryrate)
+EXTERN_CVAR(sv_qryburst)
 
 struct CvarField_t
 {
@@ -69,18 +73,45 @@ struct CvarField_t
 #define QRYRANGEINFO(INTRODUCED,REMOVED) \
     if (EqProtocolVersion >= INTRODUCED && EqProtocolVersion < REMOVED)
 
+// Responses are cached per enquirer protocol version until the server state
+// they describe changes (see SV_QryInvalidate), or until they are older than
+// this, since player pings and times are not tracked.
+#define QRY_CACHE_MS 1000
+
+struct QryCache_t
+{
+	QryCache_t() : Valid(false), Built(0), Data(MAX_UDP_PACKET) { }
+
+	bool Valid;
+	dtime_t Built;
+	buf_t Data;
+};
+
+static QryCache_t QryCache[PROTOCOL_VERSION + 1];
+
+// Token bucket of queries for each source address
+struct QryBucket_t
+{
+	float Tokens;
+	dtime_t Updated;
+};
+
+static std::unordered_map<uint32_t, QryBucket_t> QryBuckets;
+
+// Sources tracked at once.  Past this, queries from new sources are dropped
+// until quiet ones can be forgotten, so a flood of spoofed addresses can't
+// grow the table without bound.
+#define QRY_MAX_BUCKETS 4096
+
 //
 // IntQryBuildInformation()
 //
 // Protocol building routine, the passed parameter is the enquirer version
 static void IntQryBuildInformation(const DWORD& EqProtocolVersion,
-                                   const DWORD& EqTime)
+                                   buf_t& ml_message)
 {
 	std::vector<CvarField_t> Cvars;
 
-	// bond - time
-	MSG_WriteLong(&ml_message, EqTime);
-
 	// The servers real protocol version
 	// bond - real protocol
 	MSG_WriteLong(&ml_message, PROTOCOL_VERSION);
@@ -392,7 +423,22 @@ static DWORD IntQrySendResponse(const WORD& TagId,
 	else
 		MSG_WriteLong(&ml_message, EqProtocolVersion);
 
-	IntQryBuildInformation(EqProtocolVersion, EqTime);
+	// bond - time
+	MSG_WriteLong(&ml_message, EqTime);
+
+	QryCache_t& Cache = QryCache[EqProtocolVersion];
+	const dtime_t Now = I_MSTime();
+
+	if (!Cache.Valid || Now - Cache.Built >= QRY_CACHE_MS)
+	{
+		SZ_Clear(&Cache.Data);
+		IntQryBuildInformation(EqProtocolVersion, Cache.Data);
+
+		Cache.Valid = true;
+		Cache.Built = Now;
+	}
+
+	SZ_Write(&ml_message, Cache.Data.data, Cache.Data.cursize);
 
 	NET_SendPacket(ml_message, net_from);
 
@@ -401,6 +447,71 @@ static DWORD IntQrySendResponse(const WORD& TagId,
 	return 0;
 }
 
+//
+// SV_QryInvalidate()
+//
+// Throws away the cached responses, called whenever something they describe
+// changes
+void SV_QryInvalidate()
+{
+	for (size_t i = 0; i < ARRAY_LENGTH(QryCache); i++)
+		QryCache[i].Valid = false;
+}
+
+//
+// SV_QryRateLimited()
+//
+// Token bucket per source address, refilled at sv_qryrate queries per second
+// up to sv_qryburst.  Returns true if the query in net_message should be
+// dropped.
+bool SV_QryRateLimited()
+{
+	if (sv_qryrate <= 0.0f)
+		return false;
+
+	const dtime_t Now = I_MSTime();
+	const uint32_t Address = (net_from.ip[0] << 24) | (net_from.ip[1] << 16) |
+	                         (net_from.ip[2] << 8) | net_from.ip[3];
+
+	// Forget sources that have been quiet long enough to have refilled, more
+	// often while the table is full
+	static dtime_t LastPrune = 0;
+	if (Now - LastPrune >= 10000 ||
+	    (QryBuckets.size() >= QRY_MAX_BUCKETS && Now - LastPrune >= 1000))
+	{
+		LastPrune = Now;
+		for (auto it = QryBuckets.begin(); it != QryBuckets.end();)
+		{
+			if ((Now - it->second.Updated) * sv_qryrate / 1000.0f >= sv_qryburst)
+				it = QryBuckets.erase(it);
+			else
+				++it;
+		}
+	}
+
+	auto it = QryBuckets.find(Address);
+	if (it == QryBuckets.end())
+	{
+		if (QryBuckets.size() >= QRY_MAX_BUCKETS)
+			return true;
+
+		QryBucket_t Bucket = { sv_qryburst - 1.0f, Now };
+		QryBuckets.emplace(Address, Bucket);
+		return false;
+	}
+
+	QryBucket_t& Bucket = it->second;
+	Bucket.Tokens = MIN<float>(sv_qryburst, Bucket.Tokens + (Now - Bucket.Updated) *
+	                                            sv_qryrate / 1000.0f);
+	Bucket.Updated = Now;
+
+	if (Bucket.Tokens < 1.0f)
+		return true;
+
+	Bucket.Tokens -= 1.0f;
+	return false;
+}
+
 //
 // SV_QryParseEnquiry()
 //
@@ -420,6 +531,12 @@ DWORD SV_QryParseEnquiry(const DWORD& Tag)
 		return 1;
 	}
 
+	// It is ours, but this address is querying too often
+	if(SV_QryRateLimited())
+	{
+		return 0;
+	}
+
 	return IntQrySendResponse(TagId, TagApplication, TagQRId, TagPacketType);
 }
 
@@ -24,3 +24,5 @@
 #pragma once
 
 DWORD SV_QryParseEnquiry(const DWORD &Tag);
+void SV_QryInvalidate();
+bool SV_QryRateLimited();
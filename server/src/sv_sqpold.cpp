@@ -66,6 +66,7 @@ EXTERN_CVAR (sv_teamsinplay)
 EXTERN_CVAR (sv_maxplayers)
 EXTERN_CVAR (join_password)
 EXTERN_CVAR (sv_downloadsites)
+EXTERN_CVAR (sv_waddownload)
 
 EXTERN_CVAR (sv_natport)
 
@@ -234,7 +235,7 @@ void SV_SendServerInfo()
 	MSG_WriteBool(&ml_message, (sv_fastmonsters ? true : false));
 	MSG_WriteBool(&ml_message, (sv_allowjump ? true : false));
 	MSG_WriteBool(&ml_message, (sv_freelook ? true : false));
-	MSG_WriteBool(&ml_message, false);		// used to be sv_waddownload
+	MSG_WriteBool(&ml_message, (sv_waddownload ? true : false));
 	MSG_WriteBool(&ml_message, (sv_emptyreset ? true : false));
 	MSG_WriteBool(&ml_message, false);		// used to be sv_cleanmaps
 	MSG_WriteBool(&ml_message, (sv_fragexitswitch ? true : false));